@@ -0,0 +1,74 @@
+#include "harness.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+/*
+    Replacement of global operator new that counts calls. Lives in its own translation unit, so a benchmark links
+    it in once. Array and nothrow forms call these by default.
+*/
+
+namespace {
+
+std::atomic<uint64_t> allocations { 0 };
+
+void* allocate(size_t size, size_t alignment)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+
+    if (size == 0) {
+        size = 1;
+    }
+
+    void* pointer = nullptr;
+    if (alignment <= alignof(std::max_align_t)) {
+        pointer = std::malloc(size);
+    } else {
+        pointer = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    }
+
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    return pointer;
+}
+
+}
+
+uint64_t bench::allocation_count() noexcept
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t size)
+{
+    return allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    return allocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
@@ -0,0 +1,143 @@
+#include "coroutine.hpp"
+#include "event_loop.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#if defined(COOPERATIVE_HAS_EPOLL)
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+constexpr size_t block_size = 64 * 1024;
+constexpr size_t file_size  = 256 * 1024 * 1024;
+constexpr size_t blocks     = file_size / block_size;
+
+/*
+    Reads the whole file in blocks with pread on a dedicated thread, the way blocking file I/O is usually kept off
+    an event loop.
+*/
+double blocking_pread(int fd)
+{
+    std::vector<std::byte> buffer(block_size);
+
+    auto begin = std::chrono::steady_clock::now();
+
+    std::thread reader([&]() {
+        for (size_t block = 0; block < blocks; ++block) {
+            if (::pread(fd, buffer.data(), block_size, static_cast<off_t>(block * block_size)) <= 0) {
+                std::abort();
+            }
+        }
+    });
+    reader.join();
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+struct read_state {
+    co::ev_loop& loop;
+    int fd;
+    size_t next_block { 0 };
+    size_t active { 0 };
+};
+
+co::coroutine<void> read_blocks(read_state& state, std::byte* buffer)
+{
+    while (state.next_block < blocks) {
+        size_t block = state.next_block++;
+        int count    = co_await state.loop.read(state.fd, std::span(buffer, block_size), block * block_size);
+        if (count <= 0) {
+            std::abort();
+        }
+    }
+
+    if (--state.active == 0) {
+        state.loop.stop();
+    }
+}
+
+/*
+    Reads the whole file from depth coroutines on one event loop, so up to depth reads are in flight.
+*/
+double loop_read(int fd, size_t depth)
+{
+    co::ev_loop loop;
+    read_state state { loop, fd };
+
+    std::vector<std::byte> buffers(depth * block_size);
+    iovec registered { buffers.data(), buffers.size() };
+    loop.register_buffers(std::span(&registered, 1));
+
+    std::vector<co::coroutine<void>> readers(depth);
+
+    auto begin = std::chrono::steady_clock::now();
+
+    loop.post([&]() {
+        state.active = depth;
+        for (size_t index = 0; index < depth; ++index) {
+            readers[index] = read_blocks(state, buffers.data() + index * block_size);
+        }
+    });
+    loop.start();
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+int main()
+{
+    char path[] = "/tmp/cooperative-file-read-XXXXXX";
+    int fd      = ::mkstemp(path);
+    if (fd < 0) {
+        std::perror("mkstemp");
+        return 1;
+    }
+    ::unlink(path);
+
+    std::vector<std::byte> chunk(block_size, std::byte { 0x5a });
+    for (size_t block = 0; block < blocks; ++block) {
+        if (::write(fd, chunk.data(), chunk.size()) != static_cast<ssize_t>(chunk.size())) {
+            std::perror("write");
+            return 1;
+        }
+    }
+
+#if defined(COOPERATIVE_HAS_IO_URING)
+    const char* backend = "io_uring";
+#else
+    const char* backend = "epoll fallback";
+#endif
+
+    std::printf("%zu MiB file in %zu KiB blocks, event loop backend: %s\n", file_size >> 20, block_size >> 10,
+        backend);
+    std::printf("%24s %12s\n", "reader", "MiB/s");
+
+    double megabytes = static_cast<double>(file_size) / (1024.0 * 1024.0);
+
+    std::printf("%24s %12.0f\n", "pread on thread", megabytes / blocking_pread(fd));
+
+    for (size_t depth : { 1, 8, 32 }) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "ev_loop depth %zu", depth);
+        std::printf("%24s %12.0f\n", name, megabytes / loop_read(fd, depth));
+    }
+
+    ::close(fd);
+
+    return 0;
+}
+
+#else
+
+int main()
+{
+    std::printf("file read benchmark needs epoll\n");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+/*
+    Number of calls to global operator new on all threads since start of the program. Counted by
+    allocation_counter.cpp, which has to be linked into the benchmark.
+*/
+uint64_t allocation_count() noexcept;
+
+using clock = std::chrono::steady_clock;
+
+/*
+    Keeps value observable, so the compiler cannot drop the computation that produced it.
+*/
+template <typename T>
+void keep(const T& value) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+/*
+    Latency of single operations in nanoseconds. An operation too short to time on its own is timed in a group,
+    the sample is then the average of the group.
+*/
+class latency_samples {
+public:
+    void reserve(size_t count)
+    {
+        samples_.reserve(count);
+    }
+
+    void add(clock::duration elapsed, size_t operations = 1)
+    {
+        samples_.push_back(std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(operations));
+    }
+
+    void merge(const latency_samples& other)
+    {
+        samples_.insert(samples_.end(), other.samples_.begin(), other.samples_.end());
+    }
+
+    /*
+        Value below which fraction of samples lie, fraction is in (0, 1].
+    */
+    double percentile(double fraction)
+    {
+        if (samples_.empty()) {
+            return 0;
+        }
+
+        if (!sorted_) {
+            std::sort(samples_.begin(), samples_.end());
+            sorted_ = true;
+        }
+
+        size_t rank = static_cast<size_t>(std::ceil(fraction * static_cast<double>(samples_.size())));
+        return samples_[std::clamp<size_t>(rank, 1, samples_.size()) - 1];
+    }
+
+private:
+    std::vector<double> samples_ { };
+    bool sorted_ { false };
+};
+
+struct result {
+    std::string name;
+    size_t operations { 0 };
+    double seconds { 0 };
+    uint64_t allocations { 0 };
+    double p50_ns { 0 };
+    double p99_ns { 0 };
+    double p999_ns { 0 };
+
+    double ns_per_op() const noexcept
+    {
+        return operations == 0 ? 0 : seconds * 1e9 / static_cast<double>(operations);
+    }
+
+    double ops_per_second() const noexcept
+    {
+        return seconds == 0 ? 0 : static_cast<double>(operations) / seconds;
+    }
+
+    double allocations_per_op() const noexcept
+    {
+        return operations == 0 ? 0 : static_cast<double>(allocations) / static_cast<double>(operations);
+    }
+};
+
+/*
+    Wall time and allocations between start and finish.
+*/
+class measurement {
+public:
+    void start() noexcept
+    {
+        allocations_ = allocation_count();
+        begin_       = clock::now();
+    }
+
+    result finish(std::string name, size_t operations, latency_samples& samples) const
+    {
+        std::chrono::duration<double> elapsed = clock::now() - begin_;
+        uint64_t allocations                  = allocation_count() - allocations_;
+
+        return result {
+            .name        = std::move(name),
+            .operations  = operations,
+            .seconds     = elapsed.count(),
+            .allocations = allocations,
+            .p50_ns      = samples.percentile(0.5),
+            .p99_ns      = samples.percentile(0.99),
+            .p999_ns     = samples.percentile(0.999),
+        };
+    }
+
+private:
+    uint64_t allocations_ { 0 };
+    clock::time_point begin_ { };
+};
+
+/*
+    Calls body samples * batch times after a warm-up of a tenth of that, timing each batch of calls as one sample.
+*/
+template <typename Body>
+result measure(std::string name, size_t samples, size_t batch, Body body)
+{
+    for (size_t i = 0; i < samples * batch / 10; ++i) {
+        body();
+    }
+
+    latency_samples latencies;
+    latencies.reserve(samples);
+
+    measurement total;
+    total.start();
+
+    for (size_t sample = 0; sample < samples; ++sample) {
+        clock::time_point begin = clock::now();
+        for (size_t i = 0; i < batch; ++i) {
+            body();
+        }
+        latencies.add(clock::now() - begin, batch);
+    }
+
+    return total.finish(std::move(name), samples * batch, latencies);
+}
+
+/*
+    Prints results as a table while they come and, if the program got --json <path>, writes them there as JSON
+    once finished.
+*/
+class report {
+public:
+    report(int argc, char** argv)
+    {
+        for (int i = 1; i + 1 < argc; ++i) {
+            if (std::strcmp(argv[i], "--json") == 0) {
+                json_path_ = argv[i + 1];
+            }
+        }
+
+        std::printf("%-40s %12s %14s %10s %10s %10s %10s\n", "benchmark", "ns/op", "ops/s", "allocs/op", "p50 ns",
+            "p99 ns", "p999 ns");
+    }
+
+    void add(result measured)
+    {
+        std::printf("%-40s %12.1f %14.0f %10.2f %10.1f %10.1f %10.1f\n", measured.name.c_str(), measured.ns_per_op(),
+            measured.ops_per_second(), measured.allocations_per_op(), measured.p50_ns, measured.p99_ns,
+            measured.p999_ns);
+        std::fflush(stdout);
+
+        results_.push_back(std::move(measured));
+    }
+
+    /*
+        Returns exit code of the benchmark.
+    */
+    int finish() const
+    {
+        if (json_path_.empty()) {
+            return 0;
+        }
+
+        std::FILE* file = std::fopen(json_path_.c_str(), "w");
+        if (file == nullptr) {
+            std::fprintf(stderr, "cannot open %s\n", json_path_.c_str());
+            return 1;
+        }
+
+        std::fprintf(file, "{\n  \"benchmarks\": [\n");
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const result& measured = results_[i];
+            std::fprintf(file,
+                "    {\"name\": \"%s\", \"operations\": %zu, \"seconds\": %.9f, \"ns_per_op\": %.3f, "
+                "\"ops_per_second\": %.3f, \"allocations\": %llu, \"allocations_per_op\": %.6f, "
+                "\"p50_ns\": %.3f, \"p99_ns\": %.3f, \"p999_ns\": %.3f}%s\n",
+                measured.name.c_str(), measured.operations, measured.seconds, measured.ns_per_op(),
+                measured.ops_per_second(), static_cast<unsigned long long>(measured.allocations),
+                measured.allocations_per_op(), measured.p50_ns, measured.p99_ns, measured.p999_ns,
+                i + 1 == results_.size() ? "" : ",");
+        }
+        std::fprintf(file, "  ]\n}\n");
+
+        return std::fclose(file) == 0 ? 0 : 1;
+    }
+
+private:
+    std::string json_path_ { };
+    std::vector<result> results_ { };
+};
+
+}
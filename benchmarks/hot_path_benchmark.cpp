@@ -0,0 +1,276 @@
+#include "harness.hpp"
+
+#include "coroutine.hpp"
+#include "event_loop.hpp"
+#include "function.hpp"
+#include "future.hpp"
+#include "future_awaiter.hpp"
+#include "result.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+    Hot paths of the library one by one: posting, invoke round trips, future chains, awaiting, coroutine frames
+    and move_only_function. Run with --json <path> to keep the numbers for comparison between versions.
+*/
+
+constexpr size_t warmup_round_trips = 1000;
+
+/*
+    Every producer posts tasks_per_producer tasks in groups of post_batch, timing each group. The last task run
+    stops the loop.
+*/
+bench::result post_throughput(size_t producers, size_t tasks_per_producer)
+{
+    constexpr size_t post_batch = 64;
+
+    co::ev_loop loop;
+
+    size_t executed = 0;
+    size_t total    = producers * tasks_per_producer;
+
+    std::vector<bench::latency_samples> samples(producers);
+
+    bench::measurement total_time;
+    total_time.start();
+
+    std::thread consumer([&loop]() { loop.start(); });
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            samples[p].reserve(tasks_per_producer / post_batch);
+
+            for (size_t i = 0; i < tasks_per_producer; i += post_batch) {
+                bench::clock::time_point begin = bench::clock::now();
+                for (size_t j = 0; j < post_batch; ++j) {
+                    loop.post([&]() {
+                        if (++executed == total) {
+                            loop.stop();
+                        }
+                    });
+                }
+                samples[p].add(bench::clock::now() - begin, post_batch);
+            }
+        });
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    consumer.join();
+
+    for (size_t p = 1; p < producers; ++p) {
+        samples[0].merge(samples[p]);
+    }
+
+    return total_time.finish("post/producers:" + std::to_string(producers), total, samples[0]);
+}
+
+/*
+    Sends round_trips requests one after another from a loop, each next one from the continuation of the previous.
+    Send is given the driver and returns the future of a request.
+*/
+template <typename Send>
+struct round_trip_driver {
+    co::ev_loop& loop;
+    size_t round_trips;
+    Send send;
+    size_t sent { 0 };
+    bench::clock::time_point begin { };
+    bench::latency_samples samples { };
+    bench::measurement total { };
+
+    void next()
+    {
+        if (sent == warmup_round_trips) {
+            total.start();
+        }
+
+        if (sent == warmup_round_trips + round_trips) {
+            loop.stop();
+            return;
+        }
+
+        ++sent;
+        begin = bench::clock::now();
+
+        send(*this).then([this](con::result<int> result) {
+            bench::keep(result.value());
+            if (sent > warmup_round_trips) {
+                samples.add(bench::clock::now() - begin);
+            }
+            next();
+            return con::unit { };
+        });
+    }
+};
+
+bench::result invoke_round_trip(size_t round_trips)
+{
+    co::ev_loop loop;
+
+    auto send = [](auto& driver) { return driver.loop.invoke([]() { return 1; }); };
+
+    round_trip_driver<decltype(send)> driver { loop, round_trips, send };
+    driver.samples.reserve(round_trips);
+
+    loop.post([&]() { driver.next(); });
+    loop.start();
+
+    return driver.total.finish("invoke/round_trip", round_trips, driver.samples);
+}
+
+bench::result cross_loop_ping_pong(size_t round_trips)
+{
+    co::ev_loop loop;
+    co::ev_loop other;
+
+    std::thread other_thread([&other]() { other.start(); });
+
+    auto send = [&other](auto& driver) { return driver.loop.invoke(other, []() { return 1; }); };
+
+    round_trip_driver<decltype(send)> driver { loop, round_trips, send };
+    driver.samples.reserve(round_trips);
+
+    loop.post([&]() { driver.next(); });
+    loop.start();
+
+    other.stop();
+    other_thread.join();
+
+    return driver.total.finish("invoke/cross_loop_ping_pong", round_trips, driver.samples);
+}
+
+/*
+    Builds chains of links then() calls on a pending future and resolves them, samples are per link.
+*/
+bench::result then_chain(size_t chains, size_t links)
+{
+    auto run_chain = [links]() {
+        auto [fut, prom] = co::create_future_promise<int>();
+
+        co::future<int> last = std::move(fut);
+        for (size_t i = 0; i < links; ++i) {
+            last = std::move(last).then([](con::result<int> result) { return result.value() + 1; });
+        }
+
+        prom.set_value(0);
+        bench::keep(last.get());
+    };
+
+    bench::result measured = bench::measure("then/link", chains, 1, run_chain);
+    measured.operations *= links;
+    measured.p50_ns /= static_cast<double>(links);
+    measured.p99_ns /= static_cast<double>(links);
+    measured.p999_ns /= static_cast<double>(links);
+    return measured;
+}
+
+struct await_slot {
+    co::promise<int> pending { };
+    int received { 0 };
+};
+
+/*
+    Awaits count futures in a row, each one armed in slot for the driver to resolve.
+*/
+co::coroutine<void> await_futures(await_slot& slot, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        auto [fut, prom] = co::create_future_promise<int>();
+        slot.pending     = std::move(prom);
+        slot.received += co_await co::future_awaiter<int> { std::move(fut) };
+    }
+}
+
+/*
+    Time from resolving the awaited promise until the coroutine has resumed and awaits the next future.
+*/
+bench::result future_awaiter_latency(size_t awaits)
+{
+    await_slot slot;
+
+    co::coroutine<void> coro = await_futures(slot, warmup_round_trips + awaits);
+
+    for (size_t i = 0; i < warmup_round_trips; ++i) {
+        slot.pending.set_value(1);
+    }
+
+    bench::latency_samples samples;
+    samples.reserve(awaits);
+
+    bench::measurement total;
+    total.start();
+
+    for (size_t i = 0; i < awaits; ++i) {
+        bench::clock::time_point begin = bench::clock::now();
+        slot.pending.set_value(1);
+        samples.add(bench::clock::now() - begin);
+    }
+
+    bench::result measured = total.finish("co_await/future_awaiter", awaits, samples);
+    bench::keep(slot.received);
+    return measured;
+}
+
+co::coroutine<int> return_immediately(int value)
+{
+    co_return value;
+}
+
+bench::result coroutine_lifetime(size_t samples)
+{
+    int value = 0;
+
+    return bench::measure("coroutine/create_destroy", samples, 64, [&value]() {
+        co::coroutine<int> coro = return_immediately(value);
+        value                   = coro.get();
+    });
+}
+
+bench::result function_small(size_t samples)
+{
+    int counter = 0;
+
+    return bench::measure("move_only_function/small", samples, 64, [&counter]() {
+        co::move_only_function<void> function = [&counter]() { ++counter; };
+        function();
+        bench::keep(counter);
+    });
+}
+
+bench::result function_large(size_t samples)
+{
+    std::array<size_t, 16> payload { };
+
+    return bench::measure("move_only_function/large", samples, 64, [&payload]() {
+        co::move_only_function<size_t> function = [payload]() { return payload[0] + payload[15]; };
+        bench::keep(function());
+    });
+}
+
+int main(int argc, char** argv)
+{
+    bench::report report(argc, argv);
+
+    size_t max_producers = std::max<size_t>(2, std::thread::hardware_concurrency());
+    for (size_t producers = 1; producers <= max_producers; producers *= 2) {
+        report.add(post_throughput(producers, 200000));
+    }
+
+    report.add(invoke_round_trip(100000));
+    report.add(cross_loop_ping_pong(20000));
+    report.add(then_chain(10000, 16));
+    report.add(future_awaiter_latency(100000));
+    report.add(coroutine_lifetime(10000));
+    report.add(function_small(10000));
+    report.add(function_large(10000));
+
+    return report.finish();
+}
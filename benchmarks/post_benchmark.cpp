@@ -0,0 +1,164 @@
+#include "event_loop.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+    Task wrapper of the old ev_loop queue below. Unlike co::move_only_function, which keeps small callables inline,
+    it puts every callable on the heap.
+*/
+class heap_task {
+public:
+    heap_task() = default;
+
+    template <typename Function>
+    heap_task(Function function)
+        : callable_(std::make_unique<callable<Function>>(std::move(function)))
+    {
+    }
+
+    void operator()() const
+    {
+        callable_->call();
+    }
+
+private:
+    struct callable_base {
+        virtual void call()      = 0;
+        virtual ~callable_base() = default;
+    };
+
+    template <typename Function>
+    struct callable : callable_base {
+        explicit callable(Function&& body)
+            : function(std::move(body))
+        {
+        }
+
+        void call() override
+        {
+            function();
+        }
+
+        Function function;
+    };
+
+    std::unique_ptr<callable_base> callable_ { };
+};
+
+/*
+    Queue that ev_loop used before it switched to the intrusive lock-free queue: a mutex, a std::list node and
+    a heap allocated callable per task. Kept here as the baseline.
+*/
+class mutex_list_loop {
+public:
+    void start()
+    {
+        while (true) {
+            heap_task task { };
+
+            {
+                std::unique_lock lock(mutex_);
+                wakeup_.wait(lock, [this]() { return stop_ || !task_queue_.empty(); });
+                if (stop_) {
+                    break;
+                }
+                task = std::move(task_queue_.front());
+                task_queue_.pop_front();
+            }
+
+            task();
+        }
+    }
+
+    template <typename Function>
+    void post(Function function)
+    {
+        {
+            std::unique_lock lock(mutex_);
+            task_queue_.push_back(std::move(function));
+        }
+
+        wakeup_.notify_one();
+    }
+
+    void stop()
+    {
+        {
+            std::unique_lock lock(mutex_);
+            stop_ = true;
+        }
+
+        wakeup_.notify_one();
+    }
+
+private:
+    std::mutex mutex_ { };
+    std::condition_variable wakeup_ { };
+    std::list<heap_task> task_queue_ { };
+    bool stop_ { false };
+};
+
+/*
+    Every producer posts tasks_per_producer tasks, the last executed task stops the loop. Returns tasks per second.
+*/
+template <typename Loop>
+double run(size_t producers, size_t tasks_per_producer)
+{
+    Loop loop;
+
+    size_t executed = 0;
+    size_t total    = producers * tasks_per_producer;
+
+    auto begin = std::chrono::steady_clock::now();
+
+    std::thread consumer([&loop]() { loop.start(); });
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&]() {
+            for (size_t i = 0; i < tasks_per_producer; ++i) {
+                loop.post([&]() {
+                    if (++executed == total) {
+                        loop.stop();
+                    }
+                });
+            }
+        });
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    consumer.join();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+    return static_cast<double>(total) / elapsed.count();
+}
+
+int main()
+{
+    constexpr size_t tasks_per_producer = 200000;
+
+    size_t max_producers = std::max<size_t>(2, std::thread::hardware_concurrency());
+
+    std::printf("%10s %20s %20s %10s\n", "producers", "mutex_list tasks/s", "ev_loop tasks/s", "speedup");
+
+    for (size_t producers = 1; producers <= max_producers; producers *= 2) {
+        double baseline = run<mutex_list_loop>(producers, tasks_per_producer);
+        double current  = run<co::ev_loop>(producers, tasks_per_producer);
+
+        std::printf("%10zu %20.0f %20.0f %9.2fx\n", producers, baseline, current, current / baseline);
+    }
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <thread>
+
+/*
+    Binary tree fan-out: every inner node posts two children, leaves add their value to a shared sum. Measures how
+    task throughput scales with the number of workers.
+*/
+struct tree_sum {
+    co::thread_pool& pool;
+    std::atomic<size_t> sum { 0 };
+    std::atomic<size_t> leaves { 0 };
+    size_t total_leaves { 0 };
+
+    void spawn(size_t depth, size_t value)
+    {
+        pool.post([this, depth, value]() { visit(depth, value); });
+    }
+
+    void visit(size_t depth, size_t value)
+    {
+        if (depth == 0) {
+            sum.fetch_add(value, std::memory_order_relaxed);
+            leaves.fetch_add(1, std::memory_order_release);
+            return;
+        }
+
+        spawn(depth - 1, value * 2);
+        spawn(depth - 1, value * 2 + 1);
+    }
+};
+
+int main()
+{
+    constexpr size_t depth = 20;
+
+    size_t max_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+    std::printf("%10s %20s %10s\n", "threads", "tasks/s", "speedup");
+
+    double single = 0;
+
+    for (size_t threads = 1;; threads = std::min(threads * 2, max_threads)) {
+        co::thread_pool pool(threads);
+
+        tree_sum tree { pool };
+        tree.total_leaves = size_t { 1 } << depth;
+
+        auto begin = std::chrono::steady_clock::now();
+
+        tree.spawn(depth, 1);
+
+        while (tree.leaves.load(std::memory_order_acquire) != tree.total_leaves) {
+            std::this_thread::yield();
+        }
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+        double tasks_per_second = static_cast<double>(2 * tree.total_leaves - 1) / elapsed.count();
+        if (threads == 1) {
+            single = tasks_per_second;
+        }
+
+        std::printf("%10zu %20.0f %9.2fx\n", threads, tasks_per_second, tasks_per_second / single);
+
+        if (threads == max_threads) {
+            break;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,309 @@
+#pragma once
+
+#include "executor.hpp"
+#include "intrusive_queue.hpp"
+#include "wait_node.hpp"
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <mutex>
+
+namespace co {
+
+/*
+    Manual reset event for coroutines of one thread. co_await wait() suspends until set() is called, or does not
+    suspend at all if the event is already set. set() resumes all waiting coroutines inside it, in the order they
+    started waiting. A waiting coroutine can be destroyed, it leaves the queue. Not thread safe, use
+    concurrent_async_event between threads. Must outlive waiting coroutines.
+*/
+class async_event {
+public:
+    class wait_awaiter {
+    public:
+        explicit wait_awaiter(async_event& owner) noexcept
+            : owner_(owner)
+        {
+        }
+
+        ~wait_awaiter()
+        {
+            if (!owner_.waiters_.remove(&node_)) {
+                owner_.ready_.remove(&node_);
+            }
+        }
+
+        bool await_ready() const noexcept
+        {
+            return owner_.set_;
+        }
+
+        void await_suspend(std::coroutine_handle<> calling) noexcept
+        {
+            node_.handle = calling;
+            owner_.waiters_.push_back(&node_);
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+
+    private:
+        async_event& owner_;
+        detail::wait_node node_ { };
+    };
+
+    explicit async_event(bool set = false) noexcept
+        : set_(set)
+    {
+    }
+
+    async_event(const async_event&)            = delete;
+    async_event& operator=(const async_event&) = delete;
+
+    wait_awaiter wait() noexcept
+    {
+        return wait_awaiter { *this };
+    }
+
+    void set()
+    {
+        if (set_) {
+            return;
+        }
+
+        set_ = true;
+
+        // resumed coroutines may wait again after a reset
+        ready_.append(waiters_);
+        detail::resume_waiters(ready_);
+    }
+
+    void reset() noexcept
+    {
+        set_ = false;
+    }
+
+    bool is_set() const noexcept
+    {
+        return set_;
+    }
+
+private:
+    bool set_;
+    detail::intrusive_queue<detail::wait_node> waiters_ { };
+    detail::intrusive_queue<detail::wait_node> ready_ { };
+};
+
+/*
+    async_event that any number of threads can wait for, set and reset. Checking the event takes no lock, waiting
+    coroutines are queued under a mutex so that a destroyed one can leave the queue. They are resumed by the thread
+    that sets the event, on the executor passed to wait, or right on that thread without one.
+*/
+class concurrent_async_event {
+public:
+    class wait_awaiter {
+    public:
+        wait_awaiter(concurrent_async_event& owner, executor* home) noexcept
+            : owner_(owner)
+        {
+            node_.home = home;
+        }
+
+        ~wait_awaiter()
+        {
+            if (node_.handle) {
+                owner_.cancel(node_);
+            }
+        }
+
+        bool await_ready() const noexcept
+        {
+            return owner_.is_set();
+        }
+
+        bool await_suspend(std::coroutine_handle<> calling)
+        {
+            node_.handle = calling;
+            return owner_.wait(node_);
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+
+    private:
+        concurrent_async_event& owner_;
+        detail::wait_node node_ { };
+    };
+
+    explicit concurrent_async_event(bool set = false) noexcept
+        : set_(set)
+    {
+    }
+
+    concurrent_async_event(const concurrent_async_event&)            = delete;
+    concurrent_async_event& operator=(const concurrent_async_event&) = delete;
+
+    wait_awaiter wait() noexcept
+    {
+        return wait_awaiter { *this, nullptr };
+    }
+
+    wait_awaiter wait(executor& resume_on) noexcept
+    {
+        return wait_awaiter { *this, &resume_on };
+    }
+
+    /*
+        Can be called on any thread.
+    */
+    void set()
+    {
+        if (is_set()) {
+            return;
+        }
+
+        {
+            std::unique_lock lock(mutex_);
+            if (set_.exchange(true, std::memory_order_acq_rel)) {
+                return;
+            }
+            ready_.append(waiters_);
+        }
+
+        detail::resume_waiters(mutex_, ready_);
+    }
+
+    /*
+        Can be called on any thread. Does nothing to coroutines already waiting.
+    */
+    void reset() noexcept
+    {
+        set_.store(false, std::memory_order_release);
+    }
+
+    bool is_set() const noexcept
+    {
+        return set_.load(std::memory_order_acquire);
+    }
+
+private:
+    /*
+        Queues waiter unless the event is set. Returns false if waiter should not suspend.
+    */
+    bool wait(detail::wait_node& waiter)
+    {
+        std::unique_lock lock(mutex_);
+        if (set_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+
+        waiters_.push_back(&waiter);
+        return true;
+    }
+
+    void cancel(detail::wait_node& waiter) noexcept
+    {
+        std::unique_lock lock(mutex_);
+        if (!waiters_.remove(&waiter)) {
+            ready_.remove(&waiter);
+        }
+    }
+
+    std::atomic<bool> set_;
+    std::mutex mutex_ { };
+    detail::intrusive_queue<detail::wait_node> waiters_ { };
+    detail::intrusive_queue<detail::wait_node> ready_ { };
+};
+
+/*
+    Counts down from the count given at construction, co_await wait() suspends until the count reaches zero. Like
+    async_event, for coroutines of one thread.
+*/
+class async_latch {
+public:
+    explicit async_latch(size_t count) noexcept
+        : count_(count)
+        , done_(count == 0)
+    {
+    }
+
+    async_latch(const async_latch&)            = delete;
+    async_latch& operator=(const async_latch&) = delete;
+
+    async_event::wait_awaiter wait() noexcept
+    {
+        return done_.wait();
+    }
+
+    /*
+        Resumes waiting coroutines once the count reaches zero.
+    */
+    void count_down(size_t n = 1)
+    {
+        if (count_ == 0) {
+            return;
+        }
+
+        count_ = n < count_ ? count_ - n : 0;
+        if (count_ == 0) {
+            done_.set();
+        }
+    }
+
+    bool try_wait() const noexcept
+    {
+        return done_.is_set();
+    }
+
+private:
+    size_t count_;
+    async_event done_;
+};
+
+/*
+    async_latch that any number of threads can count down and wait for.
+*/
+class concurrent_async_latch {
+public:
+    explicit concurrent_async_latch(size_t count) noexcept
+        : count_(count)
+        , done_(count == 0)
+    {
+    }
+
+    concurrent_async_latch(const concurrent_async_latch&)            = delete;
+    concurrent_async_latch& operator=(const concurrent_async_latch&) = delete;
+
+    concurrent_async_event::wait_awaiter wait() noexcept
+    {
+        return done_.wait();
+    }
+
+    concurrent_async_event::wait_awaiter wait(executor& resume_on) noexcept
+    {
+        return done_.wait(resume_on);
+    }
+
+    /*
+        Can be called on any thread. Counting down more than the remaining count is an error.
+    */
+    void count_down(size_t n = 1)
+    {
+        if (count_.fetch_sub(n, std::memory_order_acq_rel) == n) {
+            done_.set();
+        }
+    }
+
+    bool try_wait() const noexcept
+    {
+        return done_.is_set();
+    }
+
+private:
+    std::atomic<size_t> count_;
+    concurrent_async_event done_;
+};
+
+}
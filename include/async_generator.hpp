@@ -0,0 +1,337 @@
+#pragma once
+
+#include "coroutine.hpp"
+#include "error.hpp"
+
+#include <concepts>
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace co {
+
+/*
+    Coroutine that produces a sequence of values with co_yield and can co_await between them, like a generator
+    whose values arrive asynchronously. The consuming coroutine awaits each value:
+
+        for (auto it = co_await pages.begin(); it != pages.end(); co_await ++it) { ... }
+
+    or, equivalently:
+
+        while (page* next = co_await pages.next()) { ... }
+
+    Awaiting resumes the body by symmetric transfer and co_yield transfers straight back, so a step costs two
+    coroutine switches and no allocation, and the body may co_await futures, tasks or channels in between. Yielded
+    values are referred to in place in the suspended frame, never copied. The body resumes on whatever thread
+    resumed it last and the consumer on the thread the body yields from. Exceptions thrown by the body are rethrown
+    to the consumer when it awaits the next value.
+*/
+template <typename T>
+class [[nodiscard]] async_generator {
+public:
+    using value_type = std::remove_cvref_t<T>;
+    using reference  = std::conditional_t<std::is_reference_v<T>, T, T&>;
+    using pointer    = std::add_pointer_t<reference>;
+
+    struct promise;
+
+    using handle_type = detail::promise_handle<promise>;
+
+    struct promise : detail::pooled_frame {
+        struct yield_awaiter {
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+
+            template <typename P>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<P> handle) noexcept
+            {
+                return handle.promise().consumer;
+            }
+
+            void await_resume() const noexcept
+            {
+            }
+        };
+
+        pointer value { nullptr };
+        std::exception_ptr exception { };
+        std::coroutine_handle<> consumer { std::noop_coroutine() };
+
+        template <typename Frame = promise>
+        async_generator get_return_object() noexcept
+        {
+            return async_generator { handle_type::from_promise(static_cast<Frame&>(*this)) };
+        }
+
+        std::suspend_always initial_suspend() const noexcept
+        {
+            return { };
+        }
+
+        yield_awaiter final_suspend() const noexcept
+        {
+            return { };
+        }
+
+        yield_awaiter yield_value(std::remove_reference_t<reference>& yielded) noexcept
+        {
+            value = std::addressof(yielded);
+            return { };
+        }
+
+        /*
+            Temporary lives until the end of the co_yield expression, which is after the consumer awaits again.
+        */
+        yield_awaiter yield_value(std::remove_reference_t<reference>&& yielded) noexcept
+        {
+            value = std::addressof(yielded);
+            return { };
+        }
+
+        /*
+            A const lvalue cannot be handed out as a mutable reference, so it is copied into the returned awaiter,
+            which stays in the frame until the consumer awaits again.
+        */
+        class copy_awaiter : public yield_awaiter {
+        public:
+            explicit copy_awaiter(const value_type& yielded)
+                : copy_(yielded)
+            {
+            }
+
+            template <typename P>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<P> handle) noexcept
+            {
+                handle.promise().value = std::addressof(copy_);
+                return yield_awaiter::await_suspend(handle);
+            }
+
+        private:
+            value_type copy_;
+        };
+
+        copy_awaiter yield_value(const value_type& yielded)
+            requires(std::is_same_v<T, value_type> && std::copy_constructible<value_type>)
+        {
+            return copy_awaiter { yielded };
+        }
+
+        void return_void() noexcept
+        {
+            value = nullptr;
+        }
+
+        void unhandled_exception() noexcept
+        {
+            value     = nullptr;
+            exception = std::current_exception();
+        }
+    };
+
+    using promise_type = promise;
+
+    /*
+        Resumes the body up to its next co_yield or its end. Result is the yielded value, or nullptr at the end.
+    */
+    class next_awaiter {
+    public:
+        explicit next_awaiter(handle_type handle) noexcept
+            : handle_(handle)
+        {
+        }
+
+        bool await_ready() const noexcept
+        {
+            return handle_.done();
+        }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> calling) noexcept
+        {
+            handle_.promise().consumer = calling;
+            return handle_;
+        }
+
+        pointer await_resume()
+        {
+            promise& state = handle_.promise();
+            if (state.exception) {
+                std::rethrow_exception(std::exchange(state.exception, nullptr));
+            }
+            return handle_.done() ? nullptr : state.value;
+        }
+
+    private:
+        handle_type handle_;
+    };
+
+    class iterator {
+    public:
+        class advance_awaiter {
+        public:
+            explicit advance_awaiter(iterator& it) noexcept
+                : it_(it)
+                , next_(it.handle_)
+            {
+            }
+
+            bool await_ready() const noexcept
+            {
+                return next_.await_ready();
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> calling) noexcept
+            {
+                return next_.await_suspend(calling);
+            }
+
+            iterator& await_resume()
+            {
+                next_.await_resume();
+                return it_;
+            }
+
+        private:
+            iterator& it_;
+            next_awaiter next_;
+        };
+
+        reference operator*() const noexcept
+        {
+            return static_cast<reference>(*handle_.promise().value);
+        }
+
+        pointer operator->() const noexcept
+        {
+            return handle_.promise().value;
+        }
+
+        /*
+            co_await ++it resumes the body up to its next value.
+        */
+        advance_awaiter operator++() noexcept
+        {
+            return advance_awaiter { *this };
+        }
+
+        friend bool operator==(const iterator& it, std::default_sentinel_t) noexcept
+        {
+            return it.handle_.done();
+        }
+
+    private:
+        friend class async_generator;
+
+        explicit iterator(handle_type handle) noexcept
+            : handle_(handle)
+        {
+        }
+
+        handle_type handle_;
+    };
+
+    class begin_awaiter {
+    public:
+        explicit begin_awaiter(handle_type handle) noexcept
+            : next_(handle)
+            , handle_(handle)
+        {
+        }
+
+        bool await_ready() const noexcept
+        {
+            return next_.await_ready();
+        }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> calling) noexcept
+        {
+            return next_.await_suspend(calling);
+        }
+
+        iterator await_resume()
+        {
+            next_.await_resume();
+            return iterator { handle_ };
+        }
+
+    private:
+        next_awaiter next_;
+        handle_type handle_;
+    };
+
+    async_generator() noexcept = default;
+
+    async_generator(const async_generator&)            = delete;
+    async_generator& operator=(const async_generator&) = delete;
+
+    async_generator(async_generator&& other) noexcept
+        : handle_(std::exchange(other.handle_, nullptr))
+    {
+    }
+
+    async_generator& operator=(async_generator&& other) noexcept
+    {
+        if (this != std::addressof(other)) {
+            std::swap(handle_, other.handle_);
+        }
+        return *this;
+    }
+
+    /*
+        Must not be destroyed while the body runs, only while the consumer holds a value or before the first await.
+    */
+    ~async_generator()
+    {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    next_awaiter next()
+    {
+        if (!handle_) {
+            throw con::error("empty async_generator");
+        }
+
+        return next_awaiter { handle_ };
+    }
+
+    /*
+        co_await begin() runs the body up to its first value. Can be awaited once.
+    */
+    begin_awaiter begin()
+    {
+        if (!handle_) {
+            throw con::error("empty async_generator");
+        }
+
+        return begin_awaiter { handle_ };
+    }
+
+    std::default_sentinel_t end() const noexcept
+    {
+        return std::default_sentinel;
+    }
+
+private:
+    explicit async_generator(handle_type handle) noexcept
+        : handle_(handle)
+    {
+    }
+
+    handle_type handle_ { };
+};
+
+}
+
+template <typename T, typename Alloc, typename... Args>
+struct std::coroutine_traits<co::async_generator<T>, std::allocator_arg_t, Alloc, Args...> {
+    using promise_type = co::detail::allocator_frame<
+        typename co::async_generator<T>::promise_type,
+        std::remove_cvref_t<Alloc>,
+        std::remove_cvref_t<Args>...>;
+};
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "async_semaphore.hpp"
+#include "executor.hpp"
+
+#include <coroutine>
+#include <mutex>
+#include <utility>
+
+namespace co {
+
+/*
+    Owns a locked async_mutex or concurrent_async_mutex and unlocks it when destroyed.
+*/
+template <typename Mutex>
+class async_lock_guard {
+public:
+    async_lock_guard(Mutex& mutex, std::adopt_lock_t) noexcept
+        : mutex_(&mutex)
+    {
+    }
+
+    async_lock_guard(async_lock_guard&& other) noexcept
+        : mutex_(std::exchange(other.mutex_, nullptr))
+    {
+    }
+
+    async_lock_guard& operator=(async_lock_guard&& other) noexcept
+    {
+        if (this != &other) {
+            unlock();
+            mutex_ = std::exchange(other.mutex_, nullptr);
+        }
+        return *this;
+    }
+
+    ~async_lock_guard()
+    {
+        unlock();
+    }
+
+    void unlock()
+    {
+        if (mutex_ != nullptr) {
+            std::exchange(mutex_, nullptr)->unlock();
+        }
+    }
+
+private:
+    Mutex* mutex_;
+};
+
+namespace detail {
+
+    template <typename Mutex, typename Awaiter>
+    class scoped_lock_awaiter {
+    public:
+        scoped_lock_awaiter(Mutex& mutex, Awaiter awaiter) noexcept
+            : mutex_(mutex)
+            , awaiter_(std::move(awaiter))
+        {
+        }
+
+        bool await_ready() noexcept
+        {
+            return awaiter_.await_ready();
+        }
+
+        auto await_suspend(std::coroutine_handle<> calling)
+        {
+            return awaiter_.await_suspend(calling);
+        }
+
+        async_lock_guard<Mutex> await_resume() noexcept
+        {
+            return async_lock_guard<Mutex> { mutex_, std::adopt_lock };
+        }
+
+    private:
+        Mutex& mutex_;
+        Awaiter awaiter_;
+    };
+
+}
+
+/*
+    Mutex for coroutines of one thread, typically of one ev_loop. co_await lock() suspends the coroutine instead of
+    blocking the thread while another coroutine holds the mutex. unlock() hands ownership straight to the longest
+    waiting coroutine and resumes it, so waiters get the mutex in FIFO order and a coroutine that keeps locking can
+    not overtake them. co_await scoped_lock() gives an async_lock_guard. Not thread safe, use
+    concurrent_async_mutex between threads. Must outlive waiting coroutines.
+*/
+class async_mutex {
+public:
+    using lock_awaiter        = async_semaphore::acquire_awaiter;
+    using scoped_lock_awaiter = detail::scoped_lock_awaiter<async_mutex, lock_awaiter>;
+
+    async_mutex() noexcept = default;
+
+    async_mutex(const async_mutex&)            = delete;
+    async_mutex& operator=(const async_mutex&) = delete;
+
+    lock_awaiter lock() noexcept
+    {
+        return semaphore_.acquire();
+    }
+
+    scoped_lock_awaiter scoped_lock() noexcept
+    {
+        return scoped_lock_awaiter { *this, semaphore_.acquire() };
+    }
+
+    bool try_lock() noexcept
+    {
+        return semaphore_.try_acquire();
+    }
+
+    void unlock()
+    {
+        semaphore_.release();
+    }
+
+    bool locked() const noexcept
+    {
+        return semaphore_.available() == 0;
+    }
+
+private:
+    async_semaphore semaphore_ { 1 };
+};
+
+/*
+    async_mutex that coroutines on any threads can lock. Locking a free mutex nobody waits for is a single
+    compare-and-swap. Waiting coroutines get ownership in FIFO order and are resumed by the unlocking thread, on
+    the executor passed to lock, or right on that thread without one.
+*/
+class concurrent_async_mutex {
+public:
+    using lock_awaiter        = concurrent_async_semaphore::acquire_awaiter;
+    using scoped_lock_awaiter = detail::scoped_lock_awaiter<concurrent_async_mutex, lock_awaiter>;
+
+    concurrent_async_mutex() noexcept = default;
+
+    concurrent_async_mutex(const concurrent_async_mutex&)            = delete;
+    concurrent_async_mutex& operator=(const concurrent_async_mutex&) = delete;
+
+    lock_awaiter lock() noexcept
+    {
+        return semaphore_.acquire();
+    }
+
+    lock_awaiter lock(executor& resume_on) noexcept
+    {
+        return semaphore_.acquire(resume_on);
+    }
+
+    scoped_lock_awaiter scoped_lock() noexcept
+    {
+        return scoped_lock_awaiter { *this, semaphore_.acquire() };
+    }
+
+    scoped_lock_awaiter scoped_lock(executor& resume_on) noexcept
+    {
+        return scoped_lock_awaiter { *this, semaphore_.acquire(resume_on) };
+    }
+
+    bool try_lock() noexcept
+    {
+        return semaphore_.try_acquire();
+    }
+
+    /*
+        Can be called on any thread.
+    */
+    void unlock()
+    {
+        semaphore_.release();
+    }
+
+private:
+    concurrent_async_semaphore semaphore_ { 1 };
+};
+
+}
@@ -0,0 +1,393 @@
+#pragma once
+
+#include "executor.hpp"
+#include "intrusive_queue.hpp"
+#include "wait_node.hpp"
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace co {
+
+/*
+    Readers-writer lock for coroutines of one thread. Any number of coroutines can hold it shared, or one holds it
+    exclusively. A waiting writer holds back new readers, and a writer unlocking lets all waiting readers in before
+    the next writer, so neither side starves. Waiting coroutines are resumed inside the unlock that lets them in. A
+    waiting coroutine can be destroyed, it leaves the queue. Not thread safe, use concurrent_async_rwlock between
+    threads. Must outlive waiting coroutines.
+*/
+class async_rwlock {
+public:
+    class lock_awaiter {
+    public:
+        explicit lock_awaiter(async_rwlock& owner) noexcept
+            : owner_(owner)
+        {
+        }
+
+        ~lock_awaiter()
+        {
+            if (owner_.writers_.remove(&node_)) {
+                owner_.admit_readers();
+            }
+        }
+
+        bool await_ready() noexcept
+        {
+            return owner_.try_lock();
+        }
+
+        void await_suspend(std::coroutine_handle<> calling) noexcept
+        {
+            node_.handle = calling;
+            owner_.writers_.push_back(&node_);
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+
+    private:
+        async_rwlock& owner_;
+        detail::wait_node node_ { };
+    };
+
+    class shared_lock_awaiter {
+    public:
+        explicit shared_lock_awaiter(async_rwlock& owner) noexcept
+            : owner_(owner)
+        {
+        }
+
+        ~shared_lock_awaiter()
+        {
+            if (!owner_.readers_.remove(&node_) && owner_.ready_.remove(&node_)) {
+                // let in by an unlock, but destroyed before its turn to run
+                owner_.unlock_shared();
+            }
+        }
+
+        bool await_ready() noexcept
+        {
+            return owner_.try_lock_shared();
+        }
+
+        void await_suspend(std::coroutine_handle<> calling) noexcept
+        {
+            node_.handle = calling;
+            owner_.readers_.push_back(&node_);
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+
+    private:
+        async_rwlock& owner_;
+        detail::wait_node node_ { };
+    };
+
+    async_rwlock() noexcept = default;
+
+    async_rwlock(const async_rwlock&)            = delete;
+    async_rwlock& operator=(const async_rwlock&) = delete;
+
+    lock_awaiter lock() noexcept
+    {
+        return lock_awaiter { *this };
+    }
+
+    shared_lock_awaiter lock_shared() noexcept
+    {
+        return shared_lock_awaiter { *this };
+    }
+
+    bool try_lock() noexcept
+    {
+        if (writer_ || shared_ != 0) {
+            return false;
+        }
+
+        writer_ = true;
+        return true;
+    }
+
+    bool try_lock_shared() noexcept
+    {
+        if (writer_ || !writers_.empty()) {
+            return false;
+        }
+
+        ++shared_;
+        return true;
+    }
+
+    void unlock()
+    {
+        writer_ = false;
+
+        if (!readers_.empty()) {
+            admit_readers();
+        } else if (detail::wait_node* writer = writers_.pop_front()) {
+            writer_ = true;
+            detail::resume_waiter(writer);
+        }
+    }
+
+    void unlock_shared()
+    {
+        if (--shared_ != 0) {
+            return;
+        }
+
+        if (detail::wait_node* writer = writers_.pop_front()) {
+            writer_ = true;
+            detail::resume_waiter(writer);
+        }
+    }
+
+private:
+    /*
+        Lets all waiting readers in at once, unless a writer holds the lock or waits for it.
+    */
+    void admit_readers()
+    {
+        if (writer_ || (shared_ != 0 && !writers_.empty())) {
+            return;
+        }
+
+        while (detail::wait_node* reader = readers_.pop_front()) {
+            ready_.push_back(reader);
+            ++shared_;
+        }
+        detail::resume_waiters(ready_);
+    }
+
+    size_t shared_ { 0 };
+    bool writer_ { false };
+    detail::intrusive_queue<detail::wait_node> readers_ { };
+    detail::intrusive_queue<detail::wait_node> writers_ { };
+    detail::intrusive_queue<detail::wait_node> ready_ { };
+};
+
+/*
+    async_rwlock that coroutines on any threads can lock. Locking while nobody waits is a single compare-and-swap on
+    a state word that is -1 when held exclusively and the number of readers otherwise. Waiting coroutines are queued
+    under a mutex and resumed by the unlocking thread, on the executor passed to lock, or right on that thread
+    without one. A waiting coroutine can be destroyed, it leaves the queue, and a lock handed to it before it was
+    resumed is unlocked again.
+*/
+class concurrent_async_rwlock {
+public:
+    class lock_awaiter {
+    public:
+        lock_awaiter(concurrent_async_rwlock& owner, executor* home) noexcept
+            : owner_(owner)
+        {
+            node_.home = home;
+        }
+
+        ~lock_awaiter()
+        {
+            if (node_.handle) {
+                owner_.cancel(node_, false);
+            }
+        }
+
+        bool await_ready() noexcept
+        {
+            return owner_.waiting_.load(std::memory_order_seq_cst) == 0 && owner_.try_lock();
+        }
+
+        bool await_suspend(std::coroutine_handle<> calling)
+        {
+            node_.handle = calling;
+            return owner_.wait(node_, false);
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+
+    private:
+        concurrent_async_rwlock& owner_;
+        detail::wait_node node_ { };
+    };
+
+    class shared_lock_awaiter {
+    public:
+        shared_lock_awaiter(concurrent_async_rwlock& owner, executor* home) noexcept
+            : owner_(owner)
+        {
+            node_.home = home;
+        }
+
+        ~shared_lock_awaiter()
+        {
+            if (node_.handle) {
+                owner_.cancel(node_, true);
+            }
+        }
+
+        bool await_ready() noexcept
+        {
+            return owner_.waiting_.load(std::memory_order_seq_cst) == 0 && owner_.try_lock_shared();
+        }
+
+        bool await_suspend(std::coroutine_handle<> calling)
+        {
+            node_.handle = calling;
+            return owner_.wait(node_, true);
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+
+    private:
+        concurrent_async_rwlock& owner_;
+        detail::wait_node node_ { };
+    };
+
+    concurrent_async_rwlock() noexcept = default;
+
+    concurrent_async_rwlock(const concurrent_async_rwlock&)            = delete;
+    concurrent_async_rwlock& operator=(const concurrent_async_rwlock&) = delete;
+
+    lock_awaiter lock() noexcept
+    {
+        return lock_awaiter { *this, nullptr };
+    }
+
+    lock_awaiter lock(executor& resume_on) noexcept
+    {
+        return lock_awaiter { *this, &resume_on };
+    }
+
+    shared_lock_awaiter lock_shared() noexcept
+    {
+        return shared_lock_awaiter { *this, nullptr };
+    }
+
+    shared_lock_awaiter lock_shared(executor& resume_on) noexcept
+    {
+        return shared_lock_awaiter { *this, &resume_on };
+    }
+
+    bool try_lock() noexcept
+    {
+        intptr_t expected = 0;
+        return state_.compare_exchange_strong(expected, -1, std::memory_order_seq_cst);
+    }
+
+    bool try_lock_shared() noexcept
+    {
+        intptr_t state = state_.load(std::memory_order_seq_cst);
+        while (state >= 0) {
+            if (state_.compare_exchange_weak(state, state + 1, std::memory_order_seq_cst)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /*
+        Can be called on any thread.
+    */
+    void unlock()
+    {
+        // pairs with wait: either this sees the new waiter or the waiter sees the lock free
+        state_.store(0, std::memory_order_seq_cst);
+        if (waiting_.load(std::memory_order_seq_cst) != 0) {
+            drain(true);
+        }
+    }
+
+    /*
+        Can be called on any thread.
+    */
+    void unlock_shared()
+    {
+        if (state_.fetch_sub(1, std::memory_order_seq_cst) == 1 && waiting_.load(std::memory_order_seq_cst) != 0) {
+            drain(false);
+        }
+    }
+
+private:
+    /*
+        Queues waiter unless it could lock meanwhile. Returns false if waiter should not suspend.
+    */
+    bool wait(detail::wait_node& waiter, bool shared)
+    {
+        std::unique_lock lock(mutex_);
+
+        waiting_.fetch_add(1, std::memory_order_seq_cst);
+        if (shared ? writers_.empty() && try_lock_shared() : try_lock()) {
+            waiting_.fetch_sub(1, std::memory_order_seq_cst);
+            return false;
+        }
+
+        (shared ? readers_ : writers_).push_back(&waiter);
+        return true;
+    }
+
+    /*
+        Lets queued coroutines in after an unlock, readers first if a writer unlocked.
+    */
+    void drain(bool prefer_readers)
+    {
+        {
+            std::unique_lock lock(mutex_);
+
+            if (!readers_.empty() && (prefer_readers || writers_.empty())) {
+                while (!readers_.empty() && try_lock_shared()) {
+                    ready_.push_back(readers_.pop_front());
+                    waiting_.fetch_sub(1, std::memory_order_seq_cst);
+                }
+            } else if (!writers_.empty() && try_lock()) {
+                ready_.push_back(writers_.pop_front());
+                waiting_.fetch_sub(1, std::memory_order_seq_cst);
+            }
+        }
+
+        detail::resume_waiters(mutex_, ready_);
+    }
+
+    /*
+        Unlinks waiter of a destroyed coroutine. A lock it got but was not resumed with yet is unlocked, and
+        readers held back only by a removed writer are let in.
+    */
+    void cancel(detail::wait_node& waiter, bool shared)
+    {
+        bool granted        = false;
+        bool readers_behind = false;
+
+        {
+            std::unique_lock lock(mutex_);
+            if ((shared ? readers_ : writers_).remove(&waiter)) {
+                waiting_.fetch_sub(1, std::memory_order_seq_cst);
+                readers_behind = !shared && writers_.empty() && !readers_.empty();
+            } else {
+                granted = ready_.remove(&waiter);
+            }
+        }
+
+        if (granted) {
+            shared ? unlock_shared() : unlock();
+        } else if (readers_behind) {
+            drain(true);
+        }
+    }
+
+    std::atomic<intptr_t> state_ { 0 };
+    std::atomic<size_t> waiting_ { 0 };
+    std::mutex mutex_ { };
+    detail::intrusive_queue<detail::wait_node> readers_ { };
+    detail::intrusive_queue<detail::wait_node> writers_ { };
+    detail::intrusive_queue<detail::wait_node> ready_ { };
+};
+
+}
@@ -0,0 +1,274 @@
+#pragma once
+
+#include "executor.hpp"
+#include "intrusive_queue.hpp"
+#include "wait_node.hpp"
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <mutex>
+
+namespace co {
+
+/*
+    Counting semaphore for coroutines of one thread, typically of one ev_loop. co_await acquire() takes a unit or
+    suspends the coroutine until one is released, without blocking the thread. A released unit is handed straight
+    to the longest waiting coroutine, which is resumed inside release(). A waiting coroutine can be destroyed, it
+    leaves the queue. Not thread safe, use concurrent_async_semaphore between threads. Must outlive waiting
+    coroutines.
+*/
+class async_semaphore {
+public:
+    class acquire_awaiter {
+    public:
+        explicit acquire_awaiter(async_semaphore& owner) noexcept
+            : owner_(owner)
+        {
+        }
+
+        ~acquire_awaiter()
+        {
+            owner_.waiters_.remove(&node_);
+        }
+
+        bool await_ready() noexcept
+        {
+            return owner_.try_acquire();
+        }
+
+        void await_suspend(std::coroutine_handle<> calling) noexcept
+        {
+            node_.handle = calling;
+            owner_.waiters_.push_back(&node_);
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+
+    private:
+        async_semaphore& owner_;
+        detail::wait_node node_ { };
+    };
+
+    explicit async_semaphore(size_t count) noexcept
+        : count_(count)
+    {
+    }
+
+    async_semaphore(const async_semaphore&)            = delete;
+    async_semaphore& operator=(const async_semaphore&) = delete;
+
+    acquire_awaiter acquire() noexcept
+    {
+        return acquire_awaiter { *this };
+    }
+
+    bool try_acquire() noexcept
+    {
+        if (count_ == 0) {
+            return false;
+        }
+
+        --count_;
+        return true;
+    }
+
+    void release()
+    {
+        if (detail::wait_node* waiter = waiters_.pop_front()) {
+            detail::resume_waiter(waiter);
+        } else {
+            ++count_;
+        }
+    }
+
+    size_t available() const noexcept
+    {
+        return count_;
+    }
+
+private:
+    size_t count_;
+    detail::intrusive_queue<detail::wait_node> waiters_ { };
+};
+
+/*
+    async_semaphore that any number of threads can acquire and release. Acquiring an available unit while nobody
+    waits is a single compare-and-swap. Waiting coroutines are queued under a mutex and resumed by the thread that
+    releases, on the executor passed to acquire, or right on that thread without one. A waiting coroutine can be
+    destroyed, it leaves the queue, and a unit handed to it before it was resumed is released again.
+*/
+class concurrent_async_semaphore {
+public:
+    class acquire_awaiter {
+    public:
+        acquire_awaiter(concurrent_async_semaphore& owner, executor* home) noexcept
+            : owner_(owner)
+        {
+            node_.home = home;
+        }
+
+        ~acquire_awaiter()
+        {
+            if (node_.handle) {
+                owner_.cancel(node_);
+            }
+        }
+
+        bool await_ready() noexcept
+        {
+            // queued coroutines go first
+            return owner_.waiting_.load(std::memory_order_seq_cst) == 0 && owner_.try_acquire();
+        }
+
+        bool await_suspend(std::coroutine_handle<> calling)
+        {
+            node_.handle = calling;
+            return owner_.wait(node_);
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+
+    private:
+        concurrent_async_semaphore& owner_;
+        detail::wait_node node_ { };
+    };
+
+    explicit concurrent_async_semaphore(size_t count) noexcept
+        : count_(count)
+    {
+    }
+
+    concurrent_async_semaphore(const concurrent_async_semaphore&)            = delete;
+    concurrent_async_semaphore& operator=(const concurrent_async_semaphore&) = delete;
+
+    acquire_awaiter acquire() noexcept
+    {
+        return acquire_awaiter { *this, nullptr };
+    }
+
+    acquire_awaiter acquire(executor& resume_on) noexcept
+    {
+        return acquire_awaiter { *this, &resume_on };
+    }
+
+    /*
+        Can be called on any thread.
+    */
+    bool try_acquire() noexcept
+    {
+        size_t count = count_.load(std::memory_order_seq_cst);
+        while (count != 0) {
+            if (count_.compare_exchange_weak(count, count - 1, std::memory_order_seq_cst)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /*
+        Can be called on any thread.
+    */
+    void release()
+    {
+        if (waiting_.load(std::memory_order_seq_cst) != 0) {
+            detail::wait_node* waiter = nullptr;
+
+            {
+                std::unique_lock lock(mutex_);
+                waiter = waiters_.pop_front();
+                if (waiter != nullptr) {
+                    waiting_.fetch_sub(1, std::memory_order_seq_cst);
+                } else {
+                    count_.fetch_add(1, std::memory_order_seq_cst);
+                }
+            }
+
+            if (waiter != nullptr) {
+                detail::resume_waiter(waiter);
+            }
+            return;
+        }
+
+        // pairs with wait: either this sees the new waiter or the waiter sees the released unit
+        count_.fetch_add(1, std::memory_order_seq_cst);
+        if (waiting_.load(std::memory_order_seq_cst) != 0) {
+            drain();
+        }
+    }
+
+    /*
+        Units that can be acquired right now, may be stale by the time it returns.
+    */
+    size_t available() const noexcept
+    {
+        return count_.load(std::memory_order_relaxed);
+    }
+
+private:
+    /*
+        Queues waiter unless a unit got available meanwhile. Returns false if waiter should not suspend.
+    */
+    bool wait(detail::wait_node& waiter)
+    {
+        std::unique_lock lock(mutex_);
+
+        waiting_.fetch_add(1, std::memory_order_seq_cst);
+        if (try_acquire()) {
+            waiting_.fetch_sub(1, std::memory_order_seq_cst);
+            return false;
+        }
+
+        waiters_.push_back(&waiter);
+        return true;
+    }
+
+    /*
+        Hands units released while a coroutine was about to wait to queued coroutines.
+    */
+    void drain()
+    {
+        {
+            std::unique_lock lock(mutex_);
+            while (!waiters_.empty() && try_acquire()) {
+                ready_.push_back(waiters_.pop_front());
+                waiting_.fetch_sub(1, std::memory_order_seq_cst);
+            }
+        }
+
+        detail::resume_waiters(mutex_, ready_);
+    }
+
+    /*
+        Unlinks waiter of a destroyed coroutine. A unit it got but was not resumed with yet goes to the next one.
+    */
+    void cancel(detail::wait_node& waiter)
+    {
+        bool granted = false;
+
+        {
+            std::unique_lock lock(mutex_);
+            if (waiters_.remove(&waiter)) {
+                waiting_.fetch_sub(1, std::memory_order_seq_cst);
+            } else {
+                granted = ready_.remove(&waiter);
+            }
+        }
+
+        if (granted) {
+            release();
+        }
+    }
+
+    std::atomic<size_t> count_;
+    std::atomic<size_t> waiting_ { 0 };
+    std::mutex mutex_ { };
+    detail::intrusive_queue<detail::wait_node> waiters_ { };
+    detail::intrusive_queue<detail::wait_node> ready_ { };
+};
+
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "error.hpp"
+
+#include <stop_token>
+#include <utility>
+
+namespace co {
+
+/*
+    Thrown into work abandoned through a cancellation_token: by awaiters of cancelled futures, cancelled sleeps and
+    cancelled invoke.
+*/
+class operation_cancelled : public con::error {
+public:
+    operation_cancelled()
+        : con::error("operation cancelled")
+    {
+    }
+};
+
+class cancellation_source;
+
+template <typename Callback>
+class cancellation_registration;
+
+/*
+    Side of a cancellation_source handed to work that should stop early. Copying it only bumps a reference count
+    and checking it is an atomic load. A default constructed token is never cancelled.
+*/
+class cancellation_token {
+public:
+    cancellation_token() noexcept = default;
+
+    bool cancellation_requested() const noexcept
+    {
+        return token_.stop_requested();
+    }
+
+    /*
+        False for a default constructed token, or if the source is gone without requesting cancellation.
+    */
+    bool can_be_cancelled() const noexcept
+    {
+        return token_.stop_possible();
+    }
+
+    void throw_if_cancellation_requested() const
+    {
+        if (cancellation_requested()) {
+            throw operation_cancelled();
+        }
+    }
+
+private:
+    friend class cancellation_source;
+
+    template <typename Callback>
+    friend class cancellation_registration;
+
+    explicit cancellation_token(std::stop_token token) noexcept
+        : token_(std::move(token))
+    {
+    }
+
+    std::stop_token token_ { };
+};
+
+/*
+    Requests cancellation of everything holding one of its tokens. Shared state is allocated once, when the source
+    is created. Can be used on any thread.
+*/
+class cancellation_source {
+public:
+    cancellation_source() = default;
+
+    cancellation_token token() const noexcept
+    {
+        return cancellation_token { source_.get_token() };
+    }
+
+    /*
+        Runs registered callbacks on the calling thread. Returns false if cancellation was already requested.
+    */
+    bool request_cancellation() noexcept
+    {
+        return source_.request_stop();
+    }
+
+    bool cancellation_requested() const noexcept
+    {
+        return source_.stop_requested();
+    }
+
+private:
+    std::stop_source source_ { };
+};
+
+/*
+    Runs callback once cancellation of token is requested: on the requesting thread, or right in the constructor if
+    it already was. Lives wherever it is constructed, typically in an awaiter inside a coroutine frame, so
+    registering allocates nothing. The destructor unregisters the callback and waits for it if it is running on
+    another thread.
+*/
+template <typename Callback>
+class cancellation_registration {
+public:
+    cancellation_registration(const cancellation_token& token, Callback callback)
+        : callback_(token.token_, std::move(callback))
+    {
+    }
+
+    cancellation_registration(const cancellation_registration&)            = delete;
+    cancellation_registration& operator=(const cancellation_registration&) = delete;
+
+private:
+    std::stop_callback<Callback> callback_;
+};
+
+}
@@ -0,0 +1,838 @@
+#pragma once
+
+#include "error.hpp"
+#include "executor.hpp"
+#include "intrusive_queue.hpp"
+#include "tracing.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace co {
+
+/*
+    Bounded queue between coroutines of one thread, typically of one ev_loop. co_await send(value) suspends while
+    the channel is full, co_await receive() while it is empty, so a fast producer is held back instead of piling up
+    items. Waiting coroutines are resumed right away by the operation that lets them continue, in the order they
+    started waiting.
+
+    After close() sends fail and return false, items already in the channel can still be received, then receive
+    yields nullopt. A waiting coroutine can be destroyed, it leaves the queue and a value it was sending is dropped.
+    Not thread safe, use concurrent_channel between threads. Must outlive waiting coroutines.
+*/
+template <typename T>
+class channel {
+    struct sender_node : detail::intrusive_link<sender_node> {
+        std::coroutine_handle<> handle { };
+        T* value { nullptr };
+        bool sent { false };
+    };
+
+    struct receiver_node : detail::intrusive_link<receiver_node> {
+        std::coroutine_handle<> handle { };
+    };
+
+public:
+    class send_awaiter {
+    public:
+        send_awaiter(channel& owner, T value)
+            : owner_(owner)
+            , value_(std::move(value))
+        {
+        }
+
+        ~send_awaiter()
+        {
+            owner_.senders_.remove(&node_);
+        }
+
+        bool await_ready()
+        {
+            if (owner_.closed_) {
+                return true;
+            }
+
+            node_.sent = owner_.try_send(std::move(value_));
+            return node_.sent;
+        }
+
+        void await_suspend(std::coroutine_handle<> calling) noexcept
+        {
+            node_.handle = calling;
+            node_.value  = &value_;
+            owner_.senders_.push_back(&node_);
+        }
+
+        /*
+            False if channel was closed and value was dropped.
+        */
+        bool await_resume() const noexcept
+        {
+            return node_.sent;
+        }
+
+    private:
+        channel& owner_;
+        T value_;
+        sender_node node_ { };
+    };
+
+    class receive_awaiter {
+    public:
+        explicit receive_awaiter(channel& owner) noexcept
+            : owner_(owner)
+        {
+        }
+
+        ~receive_awaiter()
+        {
+            owner_.receivers_.remove(&node_);
+        }
+
+        bool await_ready() const noexcept
+        {
+            return owner_.size_ != 0 || owner_.closed_;
+        }
+
+        void await_suspend(std::coroutine_handle<> calling) noexcept
+        {
+            node_.handle = calling;
+            owner_.receivers_.push_back(&node_);
+        }
+
+        /*
+            Nullopt if channel is closed and empty.
+        */
+        std::optional<T> await_resume()
+        {
+            return owner_.try_receive();
+        }
+
+    private:
+        channel& owner_;
+        receiver_node node_ { };
+    };
+
+    class batch_awaiter {
+    public:
+        batch_awaiter(channel& owner, std::vector<T>& out, size_t max) noexcept
+            : owner_(owner)
+            , out_(out)
+            , max_(max)
+        {
+        }
+
+        ~batch_awaiter()
+        {
+            owner_.receivers_.remove(&node_);
+        }
+
+        bool await_ready() const noexcept
+        {
+            return max_ == 0 || owner_.size_ != 0 || owner_.closed_;
+        }
+
+        void await_suspend(std::coroutine_handle<> calling) noexcept
+        {
+            node_.handle = calling;
+            owner_.receivers_.push_back(&node_);
+        }
+
+        /*
+            Number of items appended to out, zero if channel is closed and empty.
+        */
+        size_t await_resume()
+        {
+            size_t taken = 0;
+            while (taken < max_) {
+                std::optional<T> item = owner_.try_receive();
+                if (!item) {
+                    break;
+                }
+                out_.push_back(std::move(*item));
+                ++taken;
+            }
+            return taken;
+        }
+
+    private:
+        channel& owner_;
+        std::vector<T>& out_;
+        size_t max_;
+        receiver_node node_ { };
+    };
+
+    explicit channel(size_t capacity)
+        : slots_(capacity)
+    {
+        if (capacity == 0) {
+            throw con::error("channel capacity must be positive");
+        }
+    }
+
+    channel(const channel&)            = delete;
+    channel& operator=(const channel&) = delete;
+
+    send_awaiter send(T value)
+    {
+        return send_awaiter { *this, std::move(value) };
+    }
+
+    receive_awaiter receive() noexcept
+    {
+        return receive_awaiter { *this };
+    }
+
+    /*
+        co_await receive_batch(out, max) suspends until the channel has items, then moves up to max of them to the
+        end of out at once. With max of zero it yields zero right away.
+    */
+    batch_awaiter receive_batch(std::vector<T>& out, size_t max) noexcept
+    {
+        return batch_awaiter { *this, out, max };
+    }
+
+    /*
+        Puts value into channel if it has room. Value is moved from only on success.
+    */
+    bool try_send(T&& value)
+    {
+        if (closed_ || size_ == slots_.size()) {
+            return false;
+        }
+
+        push(std::move(value));
+
+        if (receiver_node* receiver = receivers_.pop_front()) {
+            detail::trace_slice slice("coroutine.resume");
+            receiver->handle.resume();
+        }
+
+        return true;
+    }
+
+    std::optional<T> try_receive()
+    {
+        if (size_ == 0) {
+            return std::nullopt;
+        }
+
+        std::optional<T> item = std::move(slots_[head_]);
+        slots_[head_].reset();
+        head_ = (head_ + 1) % slots_.size();
+        --size_;
+
+        if (sender_node* sender = senders_.pop_front()) {
+            push(std::move(*sender->value));
+            sender->sent = true;
+            detail::trace_slice slice("coroutine.resume");
+            sender->handle.resume();
+        }
+
+        return item;
+    }
+
+    /*
+        Fails waiting and future sends, wakes waiting receivers.
+    */
+    void close()
+    {
+        closed_ = true;
+
+        while (sender_node* sender = senders_.pop_front()) {
+            detail::trace_slice slice("coroutine.resume");
+            sender->handle.resume();
+        }
+        while (receiver_node* receiver = receivers_.pop_front()) {
+            detail::trace_slice slice("coroutine.resume");
+            receiver->handle.resume();
+        }
+    }
+
+    bool closed() const noexcept
+    {
+        return closed_;
+    }
+
+    size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    size_t capacity() const noexcept
+    {
+        return slots_.size();
+    }
+
+private:
+    void push(T&& value)
+    {
+        slots_[(head_ + size_) % slots_.size()].emplace(std::move(value));
+        ++size_;
+    }
+
+    std::vector<std::optional<T>> slots_;
+    size_t head_ { 0 };
+    size_t size_ { 0 };
+    bool closed_ { false };
+    detail::intrusive_queue<sender_node> senders_ { };
+    detail::intrusive_queue<receiver_node> receivers_ { };
+};
+
+/*
+    channel that any number of threads can send to and receive from. Items go through a lock-free bounded ring
+    (Vyukov's MPMC queue), so sends and receives that do not wait take no lock. Coroutines that have to wait are
+    queued under a mutex and resumed by whoever makes room or sends, on the executor passed to send or receive,
+    or right on that thread without one. Capacity is rounded up to a power of two, at least two. A waiting coroutine
+    can be destroyed, it leaves the queue. An item already handed to a destroyed receiver before it was resumed is
+    dropped with it.
+*/
+template <typename T>
+class concurrent_channel {
+    struct sender_node : detail::intrusive_link<sender_node> {
+        std::coroutine_handle<> handle { };
+        executor* home { nullptr };
+        T* value { nullptr };
+        bool sent { false };
+    };
+
+    struct receiver_node : detail::intrusive_link<receiver_node> {
+        std::coroutine_handle<> handle { };
+        executor* home { nullptr };
+        std::optional<T> item { };
+    };
+
+public:
+    class send_awaiter {
+    public:
+        send_awaiter(concurrent_channel& owner, T value, executor* home)
+            : owner_(owner)
+            , value_(std::move(value))
+        {
+            node_.home = home;
+        }
+
+        ~send_awaiter()
+        {
+            if (node_.handle) {
+                owner_.cancel(node_, owner_.senders_, owner_.senders_waiting_);
+            }
+        }
+
+        bool await_ready()
+        {
+            if (owner_.closed_.load(std::memory_order_seq_cst)) {
+                return true;
+            }
+
+            node_.sent = owner_.try_send(std::move(value_));
+            return node_.sent;
+        }
+
+        bool await_suspend(std::coroutine_handle<> calling)
+        {
+            node_.handle = calling;
+            node_.value  = &value_;
+            return owner_.wait_to_send(node_);
+        }
+
+        /*
+            False if channel was closed and value was dropped.
+        */
+        bool await_resume() const noexcept
+        {
+            return node_.sent;
+        }
+
+    private:
+        concurrent_channel& owner_;
+        T value_;
+        sender_node node_ { };
+    };
+
+    class receive_awaiter {
+    public:
+        receive_awaiter(concurrent_channel& owner, executor* home) noexcept
+            : owner_(owner)
+        {
+            node_.home = home;
+        }
+
+        ~receive_awaiter()
+        {
+            if (node_.handle) {
+                owner_.cancel(node_, owner_.receivers_, owner_.receivers_waiting_);
+            }
+        }
+
+        bool await_ready()
+        {
+            node_.item = owner_.try_receive();
+            if (!node_.item && owner_.closed_.load(std::memory_order_seq_cst)) {
+                node_.item = owner_.try_receive();
+                return true;
+            }
+            return node_.item.has_value();
+        }
+
+        bool await_suspend(std::coroutine_handle<> calling)
+        {
+            node_.handle = calling;
+            return owner_.wait_to_receive(node_);
+        }
+
+        /*
+            Nullopt if channel is closed and empty.
+        */
+        std::optional<T> await_resume()
+        {
+            if (!node_.item) {
+                // woken by close, items sent before it are still there
+                return owner_.try_receive();
+            }
+            return std::move(node_.item);
+        }
+
+    private:
+        concurrent_channel& owner_;
+        receiver_node node_ { };
+    };
+
+    class batch_awaiter {
+    public:
+        batch_awaiter(concurrent_channel& owner, std::vector<T>& out, size_t max, executor* home) noexcept
+            : owner_(owner)
+            , out_(out)
+            , max_(max)
+        {
+            node_.home = home;
+        }
+
+        ~batch_awaiter()
+        {
+            if (node_.handle) {
+                owner_.cancel(node_, owner_.receivers_, owner_.receivers_waiting_);
+            }
+        }
+
+        bool await_ready()
+        {
+            if (max_ == 0) {
+                return true;
+            }
+
+            taken_ = owner_.take(out_, max_);
+            if (taken_ == 0 && owner_.closed_.load(std::memory_order_seq_cst)) {
+                taken_ = owner_.take(out_, max_);
+                return true;
+            }
+            return taken_ != 0;
+        }
+
+        bool await_suspend(std::coroutine_handle<> calling)
+        {
+            node_.handle = calling;
+            return owner_.wait_to_receive(node_);
+        }
+
+        /*
+            Number of items appended to out, zero if channel is closed and empty.
+        */
+        size_t await_resume()
+        {
+            if (node_.item) {
+                out_.push_back(std::move(*node_.item));
+                node_.item.reset();
+                ++taken_;
+            }
+            if (taken_ < max_) {
+                taken_ += owner_.take(out_, max_ - taken_);
+            }
+            return taken_;
+        }
+
+    private:
+        concurrent_channel& owner_;
+        std::vector<T>& out_;
+        size_t max_;
+        size_t taken_ { 0 };
+        receiver_node node_ { };
+    };
+
+    explicit concurrent_channel(size_t capacity)
+        : mask_(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1)
+        , cells_(std::make_unique<cell[]>(mask_ + 1))
+    {
+        if (capacity == 0) {
+            throw con::error("channel capacity must be positive");
+        }
+
+        for (size_t index = 0; index <= mask_; ++index) {
+            cells_[index].sequence.store(index, std::memory_order_relaxed);
+        }
+    }
+
+    concurrent_channel(const concurrent_channel&)            = delete;
+    concurrent_channel& operator=(const concurrent_channel&) = delete;
+
+    send_awaiter send(T value)
+    {
+        return send_awaiter { *this, std::move(value), nullptr };
+    }
+
+    send_awaiter send(T value, executor& resume_on)
+    {
+        return send_awaiter { *this, std::move(value), &resume_on };
+    }
+
+    receive_awaiter receive() noexcept
+    {
+        return receive_awaiter { *this, nullptr };
+    }
+
+    receive_awaiter receive(executor& resume_on) noexcept
+    {
+        return receive_awaiter { *this, &resume_on };
+    }
+
+    batch_awaiter receive_batch(std::vector<T>& out, size_t max) noexcept
+    {
+        return batch_awaiter { *this, out, max, nullptr };
+    }
+
+    batch_awaiter receive_batch(std::vector<T>& out, size_t max, executor& resume_on) noexcept
+    {
+        return batch_awaiter { *this, out, max, &resume_on };
+    }
+
+    /*
+        Puts value into channel if it has room. Value is moved from only on success. Can be called on any thread.
+    */
+    bool try_send(T&& value)
+    {
+        if (closed_.load(std::memory_order_seq_cst) || !push(value)) {
+            return false;
+        }
+
+        pushed();
+        return true;
+    }
+
+    /*
+        Can be called on any thread.
+    */
+    std::optional<T> try_receive()
+    {
+        std::optional<T> item = pop();
+        if (item) {
+            popped();
+        }
+        return item;
+    }
+
+    /*
+        Fails waiting and future sends, wakes waiting receivers. Can be called on any thread.
+    */
+    void close()
+    {
+        {
+            std::unique_lock lock(mutex_);
+            closed_.store(true, std::memory_order_seq_cst);
+            ready_senders_.append(senders_);
+            ready_receivers_.append(receivers_);
+            senders_waiting_.store(0, std::memory_order_seq_cst);
+            receivers_waiting_.store(0, std::memory_order_seq_cst);
+        }
+
+        wake(ready_senders_);
+        wake(ready_receivers_);
+    }
+
+    bool closed() const noexcept
+    {
+        return closed_.load(std::memory_order_seq_cst);
+    }
+
+    /*
+        Number of items in channel, may be stale by the time it returns.
+    */
+    size_t size() const noexcept
+    {
+        size_t dequeued = dequeue_position_.load(std::memory_order_relaxed);
+        size_t enqueued = enqueue_position_.load(std::memory_order_relaxed);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    size_t capacity() const noexcept
+    {
+        return mask_ + 1;
+    }
+
+private:
+    struct cell {
+        std::atomic<size_t> sequence { 0 };
+        std::optional<T> value { };
+    };
+
+    /*
+        Moves value into ring if it has room. Sequence accesses are sequentially consistent, so a push is ordered
+        with the waiting counters read and written around it (Dekker-style handshake with waiting coroutines).
+    */
+    bool push(T& value)
+    {
+        size_t position = enqueue_position_.load(std::memory_order_relaxed);
+
+        while (true) {
+            cell& target      = cells_[position & mask_];
+            size_t sequence   = target.sequence.load(std::memory_order_seq_cst);
+            intptr_t distance = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+            if (distance == 0) {
+                if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    target.value.emplace(std::move(value));
+                    target.sequence.store(position + 1, std::memory_order_seq_cst);
+                    return true;
+                }
+            } else if (distance < 0) {
+                return false;
+            } else {
+                position = enqueue_position_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::optional<T> pop()
+    {
+        size_t position = dequeue_position_.load(std::memory_order_relaxed);
+
+        while (true) {
+            cell& source      = cells_[position & mask_];
+            size_t sequence   = source.sequence.load(std::memory_order_seq_cst);
+            intptr_t distance = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+
+            if (distance == 0) {
+                if (dequeue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    std::optional<T> item = std::move(source.value);
+                    source.value.reset();
+                    source.sequence.store(position + mask_ + 1, std::memory_order_seq_cst);
+                    return item;
+                }
+            } else if (distance < 0) {
+                return std::nullopt;
+            } else {
+                position = dequeue_position_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    size_t take(std::vector<T>& out, size_t max)
+    {
+        size_t taken = 0;
+        while (taken < max) {
+            std::optional<T> item = pop();
+            if (!item) {
+                break;
+            }
+            out.push_back(std::move(*item));
+            ++taken;
+        }
+
+        if (taken != 0) {
+            popped();
+        }
+        return taken;
+    }
+
+    /*
+        Hands items to waiting receivers after a push.
+    */
+    void pushed()
+    {
+        if (receivers_waiting_.load(std::memory_order_seq_cst) == 0) {
+            return;
+        }
+
+        bool made_room = false;
+
+        {
+            std::unique_lock lock(mutex_);
+            while (!receivers_.empty()) {
+                std::optional<T> item = pop();
+                if (!item) {
+                    break;
+                }
+
+                receiver_node* receiver = receivers_.pop_front();
+                receivers_waiting_.fetch_sub(1, std::memory_order_seq_cst);
+                receiver->item = std::move(item);
+                ready_receivers_.push_back(receiver);
+                made_room = true;
+            }
+        }
+
+        wake(ready_receivers_);
+        if (made_room) {
+            popped();
+        }
+    }
+
+    /*
+        Moves values of waiting senders into the room left by a pop.
+    */
+    void popped()
+    {
+        if (senders_waiting_.load(std::memory_order_seq_cst) == 0) {
+            return;
+        }
+
+        bool sent = false;
+
+        {
+            std::unique_lock lock(mutex_);
+            while (sender_node* sender = senders_.front()) {
+                if (!push(*sender->value)) {
+                    break;
+                }
+
+                senders_.pop_front();
+                senders_waiting_.fetch_sub(1, std::memory_order_seq_cst);
+                sender->sent = true;
+                ready_senders_.push_back(sender);
+                sent = true;
+            }
+        }
+
+        wake(ready_senders_);
+        if (sent) {
+            pushed();
+        }
+    }
+
+    /*
+        Queues sender unless the channel got room or was closed meanwhile. Returns false if sender should not
+        suspend.
+    */
+    bool wait_to_send(sender_node& sender)
+    {
+        {
+            std::unique_lock lock(mutex_);
+
+            if (!closed_.load(std::memory_order_seq_cst)) {
+                senders_waiting_.fetch_add(1, std::memory_order_seq_cst);
+                if (!push(*sender.value)) {
+                    senders_.push_back(&sender);
+                    return true;
+                }
+                senders_waiting_.fetch_sub(1, std::memory_order_seq_cst);
+                sender.sent = true;
+            }
+        }
+
+        if (sender.sent) {
+            pushed();
+        }
+        return false;
+    }
+
+    template <typename Node>
+    bool wait_to_receive(Node& receiver)
+    {
+        {
+            std::unique_lock lock(mutex_);
+
+            if (!closed_.load(std::memory_order_seq_cst)) {
+                receivers_waiting_.fetch_add(1, std::memory_order_seq_cst);
+                receiver.item = pop();
+                if (!receiver.item) {
+                    receivers_.push_back(&receiver);
+                    return true;
+                }
+                receivers_waiting_.fetch_sub(1, std::memory_order_seq_cst);
+            }
+        }
+
+        if (receiver.item) {
+            popped();
+        }
+        return false;
+    }
+
+    /*
+        Unlinks waiter of a destroyed coroutine, from its wait queue or from the queue of those about to be resumed.
+    */
+    template <typename Node>
+    void cancel(Node& waiter, detail::intrusive_queue<Node>& waiting, std::atomic<size_t>& count) noexcept
+    {
+        std::unique_lock lock(mutex_);
+        if (waiting.remove(&waiter)) {
+            count.fetch_sub(1, std::memory_order_seq_cst);
+        } else {
+            ready_queue(waiter).remove(&waiter);
+        }
+    }
+
+    detail::intrusive_queue<sender_node>& ready_queue(sender_node&) noexcept
+    {
+        return ready_senders_;
+    }
+
+    detail::intrusive_queue<receiver_node>& ready_queue(receiver_node&) noexcept
+    {
+        return ready_receivers_;
+    }
+
+    /*
+        Resumes ready waiters one by one, each taken off the queue under the mutex, so a resumed coroutine can still
+        destroy one behind it.
+    */
+    template <typename Node>
+    void wake(detail::intrusive_queue<Node>& ready)
+    {
+        while (true) {
+            Node* node = nullptr;
+            {
+                std::unique_lock lock(mutex_);
+                node = ready.pop_front();
+            }
+
+            if (node == nullptr) {
+                return;
+            }
+
+            std::coroutine_handle<> handle = node->handle;
+            if (node->home != nullptr) {
+                node->home->execute([handle]() {
+                    detail::trace_slice slice("coroutine.resume");
+                    handle.resume();
+                });
+            } else {
+                detail::trace_slice slice("coroutine.resume");
+                handle.resume();
+            }
+        }
+    }
+
+    size_t mask_;
+    std::unique_ptr<cell[]> cells_;
+    alignas(64) std::atomic<size_t> enqueue_position_ { 0 };
+    alignas(64) std::atomic<size_t> dequeue_position_ { 0 };
+    alignas(64) std::atomic<bool> closed_ { false };
+    std::atomic<size_t> senders_waiting_ { 0 };
+    std::atomic<size_t> receivers_waiting_ { 0 };
+    std::mutex mutex_ { };
+    detail::intrusive_queue<sender_node> senders_ { };
+    detail::intrusive_queue<receiver_node> receivers_ { };
+    detail::intrusive_queue<sender_node> ready_senders_ { };
+    detail::intrusive_queue<receiver_node> ready_receivers_ { };
+};
+
+}
@@ -1,15 +1,163 @@
 #pragma once
 
 #include "error.hpp"
+#include "pool.hpp"
 #include "result.hpp"
 
 #include <coroutine>
 #include <cstddef>
 #include <exception>
 #include <memory>
+#include <new>
+#include <type_traits>
 
 namespace co {
 
+namespace detail {
+
+    struct frame_pool_tag { };
+
+    using frame_pool = size_class_pool<frame_pool_tag, 64, 4096, 256>;
+
+    /*
+        Base of coroutine promises that takes frame allocation away from global operator new. Frames come from
+        thread local frame_pool.
+    */
+    struct pooled_frame {
+        static void* operator new(size_t size)
+        {
+            return frame_pool::allocate(size);
+        }
+
+        static void operator delete(void* frame, size_t size) noexcept
+        {
+            frame_pool::deallocate(frame, size);
+        }
+    };
+
+    /*
+        Handle to a coroutine whose promise is Promise or derives from it, like allocator_frame does.
+        std::coroutine_handle<Promise> may refer only to a frame whose promise is exactly Promise, so the frame is
+        kept type erased next to a pointer to its promise. from_promise takes the most derived promise.
+    */
+    template <typename Promise>
+    class promise_handle {
+    public:
+        promise_handle() noexcept = default;
+
+        promise_handle(std::nullptr_t) noexcept
+        {
+        }
+
+        template <typename Frame>
+        static promise_handle from_promise(Frame& promise) noexcept
+        {
+            static_assert(std::is_base_of_v<Promise, Frame>);
+            return promise_handle(std::coroutine_handle<Frame>::from_promise(promise), promise);
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return static_cast<bool>(frame_);
+        }
+
+        operator std::coroutine_handle<>() const noexcept
+        {
+            return frame_;
+        }
+
+        Promise& promise() const noexcept
+        {
+            return *promise_;
+        }
+
+        bool done() const noexcept
+        {
+            return frame_.done();
+        }
+
+        void resume() const
+        {
+            frame_.resume();
+        }
+
+        void destroy() const
+        {
+            frame_.destroy();
+        }
+
+    private:
+        promise_handle(std::coroutine_handle<> frame, Promise& promise) noexcept
+            : frame_(frame)
+            , promise_(std::addressof(promise))
+        {
+        }
+
+        std::coroutine_handle<> frame_ { };
+        Promise* promise_ { nullptr };
+    };
+
+    /*
+        Promise of coroutines that take std::allocator_arg_t followed by an allocator as their first two parameters.
+        The frame is allocated by that allocator and a copy of the allocator is kept right after the frame, because
+        operator delete does not get the coroutine arguments. Selected through std::coroutine_traits, operator new
+        and operator delete must not be templates or GCC reports them as mismatched. Promise::get_return_object
+        takes the most derived promise type as its template argument, so the return object gets a handle to this
+        promise rather than to its base.
+    */
+    template <typename Promise, typename Alloc, typename... Args>
+    struct allocator_frame : Promise {
+        using frame_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<std::max_align_t>;
+        using traits      = std::allocator_traits<frame_alloc>;
+
+        auto get_return_object()
+        {
+            return Promise::template get_return_object<allocator_frame>();
+        }
+
+        static void* operator new(size_t size, std::allocator_arg_t, const Alloc& alloc, const Args&...)
+        {
+            frame_alloc allocator(alloc);
+            void* frame = traits::allocate(allocator, blocks(size));
+            ::new (slot(frame, size)) frame_alloc(std::move(allocator));
+            return frame;
+        }
+
+        static void operator delete(void* frame, size_t size) noexcept
+        {
+            frame_alloc* stored = std::launder(slot(frame, size));
+            frame_alloc allocator(std::move(*stored));
+            stored->~frame_alloc();
+            traits::deallocate(allocator, static_cast<std::max_align_t*>(frame), blocks(size));
+        }
+
+    private:
+        static size_t offset(size_t size) noexcept
+        {
+            return (size + alignof(frame_alloc) - 1) / alignof(frame_alloc) * alignof(frame_alloc);
+        }
+
+        static frame_alloc* slot(void* frame, size_t size) noexcept
+        {
+            return reinterpret_cast<frame_alloc*>(static_cast<std::byte*>(frame) + offset(size));
+        }
+
+        static size_t blocks(size_t size) noexcept
+        {
+            return (offset(size) + sizeof(frame_alloc) + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+        }
+    };
+
+}
+
+/*
+    Counters of coroutine frames allocated on the calling thread.
+*/
+inline pool_stats coroutine_frame_pool_stats() noexcept
+{
+    return detail::frame_pool::stats();
+}
+
 template <typename T = void>
 class [[nodiscard]] coroutine {
 public:
@@ -30,7 +178,11 @@ public:
         }
     };
 
-    struct promise {
+    struct promise;
+
+    using handle_type = detail::promise_handle<promise>;
+
+    struct promise : detail::pooled_frame {
         std::coroutine_handle<> continuation { std::noop_coroutine() };
         con::result<T> result { };
 
@@ -49,9 +201,10 @@ public:
             return { };
         }
 
+        template <typename Frame = promise>
         coroutine get_return_object()
         {
-            return coroutine { std::coroutine_handle<promise>::from_promise(*this) };
+            return coroutine { handle_type::from_promise(static_cast<Frame&>(*this)) };
         }
 
         void return_value(T&& res) noexcept
@@ -66,14 +219,14 @@ public:
     };
 
     struct awaiter {
-        std::coroutine_handle<promise> handle;
+        handle_type handle;
 
         bool await_ready() const noexcept
         {
             return !handle || handle.done();
         }
 
-        std::coroutine_handle<promise> await_suspend(std::coroutine_handle<> calling) noexcept
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> calling) noexcept
         {
             handle.promise().continuation = calling;
             return handle;
@@ -184,16 +337,16 @@ public:
     }
 
 private:
-    explicit coroutine(std::coroutine_handle<promise> handle)
+    explicit coroutine(handle_type handle)
         : handle_(handle)
     {
     }
 
-    std::coroutine_handle<promise> handle_ { };
+    handle_type handle_ { };
 };
 
 template <>
-struct coroutine<void>::promise {
+struct coroutine<void>::promise : detail::pooled_frame {
     std::coroutine_handle<> continuation { std::noop_coroutine() };
     con::result<con::unit> result { };
 
@@ -212,9 +365,10 @@ struct coroutine<void>::promise {
         return { };
     }
 
+    template <typename Frame = promise>
     coroutine<void> get_return_object()
     {
-        return coroutine<void> { std::coroutine_handle<promise>::from_promise(*this) };
+        return coroutine<void> { handle_type::from_promise(static_cast<Frame&>(*this)) };
     }
 
     void return_void() noexcept
@@ -224,3 +378,11 @@ struct coroutine<void>::promise {
 };
 
 }
+
+template <typename T, typename Alloc, typename... Args>
+struct std::coroutine_traits<co::coroutine<T>, std::allocator_arg_t, Alloc, Args...> {
+    using promise_type = co::detail::allocator_frame<
+        typename co::coroutine<T>::promise_type,
+        std::remove_cvref_t<Alloc>,
+        std::remove_cvref_t<Args>...>;
+};
@@ -1,45 +1,239 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <concepts>
-#include <list>
-#include <mutex>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ranges>
+#include <span>
 #include <type_traits>
 
+#include "cancellation.hpp"
+#include "executor.hpp"
 #include "function.hpp"
 #include "future.hpp"
+#include "io_operation.hpp"
+#include "io_reactor.hpp"
+#include "io_uring_engine.hpp"
+#include "loop_anchor.hpp"
+#include "loop_statistics.hpp"
+#include "mpsc_queue.hpp"
+#include "parker.hpp"
 #include "result.hpp"
+#include "task.hpp"
+#include "task_node.hpp"
+#include "timer_queue.hpp"
+#include "tracing.hpp"
 
 namespace co {
 
-class ev_loop {
+/*
+    How ev_loop behaves when its queue is empty. The loop polls the queue spin_iterations times before parking
+    its thread until new work arrives. Zero parks right away, which is what most loops want.
+*/
+struct idle_policy {
+    size_t spin_iterations { 0 };
+};
+
+/*
+    Lane of ev_loop queue. Tasks of one lane run in the order they were posted, lanes are drained by weight.
+*/
+enum class priority : uint8_t {
+    high,
+    normal,
+    low,
+};
+
+inline constexpr size_t priority_count = 3;
+
+/*
+    How many tasks ev_loop takes from each lane in turn while all of them have work, so a busy high lane slows
+    lower lanes down but cannot starve them. Zero counts as one.
+*/
+struct lane_weights {
+    size_t high { 16 };
+    size_t normal { 4 };
+    size_t low { 1 };
+};
+
+/*
+    Counters of a lane. depth is the number of tasks posted and not run yet, it shows how long new tasks of the
+    lane wait behind others.
+*/
+struct lane_stats {
+    size_t posted { 0 };
+    size_t run { 0 };
+
+    size_t depth() const noexcept
+    {
+        return posted - run;
+    }
+};
+
+class ev_loop : public executor {
 public:
-    ev_loop() = default;
+    /*
+        Cancelling the token while the coroutine sleeps drops the timer and resumes the coroutine on the loop right
+        away with operation_cancelled. Destroying a sleeping coroutine drops its timer.
+    */
+    class sleep_awaiter {
+        struct canceller {
+            sleep_awaiter* awaiter;
+
+            void operator()()
+            {
+                ev_loop* loop         = &awaiter->loop_;
+                sleep_awaiter* target = awaiter;
+                timer_id timer        = awaiter->timer_;
+
+                // timers belong to the loop thread, the awaiter is alive as long as its timer is
+                loop->post(priority::high, [loop, target, timer]() {
+                    if (loop->cancel(timer)) {
+                        target->cancelled_ = true;
+                        detail::trace_slice slice("coroutine.resume");
+                        target->handle_.resume();
+                    }
+                });
+            }
+        };
+
+    public:
+        sleep_awaiter(ev_loop& loop, timer_clock::time_point deadline, cancellation_token token = { }) noexcept
+            : loop_(loop)
+            , deadline_(deadline)
+            , token_(std::move(token))
+        {
+        }
+
+        sleep_awaiter(const sleep_awaiter&)            = delete;
+        sleep_awaiter& operator=(const sleep_awaiter&) = delete;
+
+        ~sleep_awaiter()
+        {
+            if (pending_) {
+                loop_.cancel(timer_);
+            }
+        }
+
+        bool await_ready() noexcept
+        {
+            cancelled_ = token_.cancellation_requested();
+            return cancelled_ || deadline_ <= timer_clock::now();
+        }
+
+        void await_suspend(std::coroutine_handle<> calling)
+        {
+            handle_  = calling;
+            timer_   = loop_.post_at(deadline_, [calling]() {
+                detail::trace_slice slice("coroutine.resume");
+                calling.resume();
+            });
+            pending_ = true;
+
+            if (token_.can_be_cancelled()) {
+                registration_.emplace(token_, canceller { this });
+            }
+        }
+
+        void await_resume()
+        {
+            pending_ = false;
+            registration_.reset();
+
+            if (cancelled_) {
+                throw operation_cancelled();
+            }
+        }
+
+    private:
+        ev_loop& loop_;
+        timer_clock::time_point deadline_;
+        cancellation_token token_;
+        std::coroutine_handle<> handle_ { };
+        timer_id timer_ { };
+        bool pending_ { false };
+        bool cancelled_ { false };
+        std::optional<cancellation_registration<canceller>> registration_ { };
+    };
+
+    ev_loop()
+        : ev_loop(idle_policy { })
+    {
+    }
+
+    explicit ev_loop(idle_policy policy, lane_weights weights = { })
+        : idle_policy_(policy)
+        , weights_ { std::max<size_t>(weights.high, 1), std::max<size_t>(weights.normal, 1),
+            std::max<size_t>(weights.low, 1) }
+    {
+#if defined(COOPERATIVE_HAS_IO_URING)
+        if (uring_.available()) {
+            parker_.watch_completions(uring_.fd());
+        }
+#endif
+    }
 
     ev_loop(const ev_loop&)            = delete;
     ev_loop& operator=(const ev_loop&) = delete;
 
+    ~ev_loop() override
+    {
+        anchor_.detach();
+
+        for (lane& queue : lanes_) {
+            while (!queue.tasks.empty()) {
+                if (detail::task_node* node = queue.tasks.pop()) {
+                    node->discard();
+                }
+            }
+        }
+    }
+
     /*
         This function blocks thread until ev_loop is stopped
     */
     void start()
     {
-        while (true) {
-            move_only_function<void> task {};
+        size_t spins = 0;
+#if defined(COOPERATIVE_HAS_EPOLL)
+        size_t tasks_run = 0;
+#endif
 
-            {
-                std::unique_lock lock(mutex_);
-                if (stop_) {
-                    break;
-                }
-                if (!task_queue_.empty()) {
-                    task = std::move(task_queue_.front());
-                    task_queue_.pop_front();
+        while (!stop_.load(std::memory_order_acquire)) {
+            if (!timers_.empty() && run_timers()) {
+                spins = 0;
+                continue;
+            }
+
+            if (size_t ran = run_batch()) {
+                spins = 0;
+#if defined(COOPERATIVE_HAS_EPOLL)
+                tasks_run += ran;
+                if (tasks_run >= io_poll_interval) {
+                    tasks_run = 0;
+                    poll_io();
                 }
+#endif
+                continue;
             }
 
-            if (task) {
-                task();
+            if (!queues_empty()) {
+                // producer is in the middle of a push
+                detail::cpu_relax();
+                continue;
+            }
+
+            if (spins < idle_policy_.spin_iterations) {
+                ++spins;
+                detail::cpu_relax();
+                continue;
             }
+
+            park();
         }
     }
 
@@ -50,8 +244,132 @@ public:
         requires std::invocable<Function>
     void post(Function function)
     {
-        std::unique_lock lock(mutex_);
-        task_queue_.push_back(std::move(function));
+        post(priority::normal, std::move(function));
+    }
+
+    /*
+        Put task to event loop, it is dropped without running if token is cancelled by then. Can be called on any
+        thread.
+    */
+    template <typename Function>
+        requires std::invocable<Function>
+    void post(cancellation_token token, Function function)
+    {
+        post(priority::normal, std::move(token), std::move(function));
+    }
+
+    template <typename Function>
+        requires std::invocable<Function>
+    void post(priority level, cancellation_token token, Function function)
+    {
+        post(level, [token = std::move(token), function = std::move(function)]() mutable {
+            if (!token.cancellation_requested()) {
+                function();
+            }
+        });
+    }
+
+    /*
+        Put task to lane of event loop. Can be called on any thread.
+    */
+    template <typename Function>
+        requires std::invocable<Function>
+    void post(priority level, Function function)
+    {
+        lane& queue             = lanes_[static_cast<size_t>(level)];
+        detail::task_node* node = new detail::task_node_impl<Function>(std::move(function));
+        mark_posted(node);
+        // counted before push, so the loop never runs a task that is not counted as posted yet
+        queue.posted.fetch_add(1, std::memory_order_relaxed);
+        queue.tasks.push(node);
+        unpark();
+    }
+
+    /*
+        Put every task of range to event loop with a single handoff, they run in range order. Tasks are moved out
+        of the range. Can be called on any thread.
+    */
+    template <std::ranges::input_range Range>
+        requires std::invocable<std::ranges::range_value_t<Range>>
+    void post_bulk(Range&& functions)
+    {
+        post_bulk(priority::normal, std::forward<Range>(functions));
+    }
+
+    template <std::ranges::input_range Range>
+        requires std::invocable<std::ranges::range_value_t<Range>>
+    void post_bulk(priority level, Range&& functions)
+    {
+        using function_type = std::ranges::range_value_t<Range>;
+
+        detail::task_node* first = nullptr;
+        detail::task_node* last  = nullptr;
+        size_t count             = 0;
+
+        try {
+            for (auto&& function : functions) {
+                detail::task_node* node = new detail::task_node_impl<function_type>(std::move(function));
+                mark_posted(node);
+                if (last == nullptr) {
+                    first = node;
+                } else {
+                    last->next.store(node, std::memory_order_relaxed);
+                }
+                last = node;
+                ++count;
+            }
+        } catch (...) {
+            discard_chain(first);
+            throw;
+        }
+
+        if (first == nullptr) {
+            return;
+        }
+
+        lane& queue = lanes_[static_cast<size_t>(level)];
+        queue.posted.fetch_add(count, std::memory_order_relaxed);
+        queue.tasks.push_chain(first, last);
+        unpark();
+    }
+
+    void execute(move_only_function<void> task) override
+    {
+        post(std::move(task));
+    }
+
+    /*
+        Counters of lane. Can be called on any thread, the numbers are a snapshot that may be already stale.
+    */
+    lane_stats statistics(priority level) const noexcept
+    {
+        const lane& queue = lanes_[static_cast<size_t>(level)];
+
+        lane_stats stats;
+        // run first: every task counted as run was counted as posted before
+        stats.run    = queue.run.load(std::memory_order_acquire);
+        stats.posted = queue.posted.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    /*
+        Counters of the whole loop, see loop_statistics. Can be called on any thread.
+    */
+    loop_statistics statistics() const noexcept
+    {
+        loop_statistics stats;
+
+        for (size_t level = 0; level < priority_count; ++level) {
+            lane_stats lane = statistics(static_cast<priority>(level));
+            stats.tasks_posted += lane.posted;
+            stats.tasks_executed += lane.run;
+            stats.queue_depth += lane.depth();
+        }
+
+        stats.timers_executed = timers_run_.load(std::memory_order_relaxed);
+
+        counters_.fill(stats);
+        return stats;
     }
 
     /*
@@ -73,41 +391,479 @@ public:
     }
 
     /*
-        Put task to other event loop and get result on this event loop. Can be used only on this event loop thread.
+        Like invoke, but the task is not run if token is cancelled before it starts, and coroutines awaiting the
+        future are resumed with operation_cancelled as soon as token is cancelled. Can be used only on event loop
+        thread.
     */
     template <typename Function>
         requires std::invocable<Function>
-    future<std::invoke_result_t<Function>> invoke(ev_loop& other_ev_loop, Function function)
+    future<std::invoke_result_t<Function>> invoke(cancellation_token token, Function function)
     {
-        auto [fut, prom] = create_future_promise<std::invoke_result_t<Function>>();
+        auto [fut, prom] = create_future_promise<std::invoke_result_t<Function>>(std::move(token));
+        post([function = std::move(function), prom = std::move(prom)]() mutable {
+            run_cancellable(prom, function);
+        });
+        return std::move(fut);
+    }
 
-        other_ev_loop.post([function = std::move(function), prom = std::move(prom), this]() mutable {
-            con::result<std::invoke_result_t<Function>> result;
+    /*
+        Put task to other event loop or thread pool and get result on this event loop. The promise is resolved on
+        the other side and continuations come back here, so the round trip takes one post each way. Can be used
+        only on this event loop thread.
+    */
+    template <typename Executor, typename Function>
+        requires std::invocable<Function>
+        && requires(Executor& executor, move_only_function<void> task) { executor.post(std::move(task)); }
+    future<std::invoke_result_t<Function>> invoke(Executor& other_ev_loop, Function function)
+    {
+        auto [fut, prom] = create_future_promise<std::invoke_result_t<Function>>(*this);
 
+        other_ev_loop.post([function = std::move(function), prom = std::move(prom)]() mutable {
             try {
-                result = function();
+                prom.set_value(function());
             } catch (...) {
-                result = std::current_exception();
+                prom.set_exception(std::current_exception());
             }
+        });
 
-            post([result = std::move(result), prom = std::move(prom)]() mutable {
-                prom.resolve(std::move(result)); //
-            });
+        return std::move(fut);
+    }
+
+    template <typename Executor, typename Function>
+        requires std::invocable<Function>
+        && requires(Executor& executor, move_only_function<void> task) { executor.post(std::move(task)); }
+    future<std::invoke_result_t<Function>> invoke(Executor& other_ev_loop, cancellation_token token, Function function)
+    {
+        auto [fut, prom] = create_future_promise<std::invoke_result_t<Function>>(*this, std::move(token));
+
+        other_ev_loop.post([function = std::move(function), prom = std::move(prom)]() mutable {
+            run_cancellable(prom, function);
         });
 
         return std::move(fut);
     }
 
+    /*
+        Start task on event loop and let it run to completion on its own, the loop owns the frame until the task
+        starts and the frame frees itself when the task finishes. Result and exception of the task are dropped.
+        Can be called on any thread.
+    */
+    template <typename T>
+    void spawn(task<T> work)
+    {
+        post([work = std::move(work)]() mutable { detail::task_access::start_detached(std::move(work)); });
+    }
+
+    /*
+        Run task on event loop at deadline. Can be used only on event loop thread.
+    */
+    template <typename Function>
+        requires std::invocable<Function>
+    timer_id post_at(timer_clock::time_point deadline, Function function)
+    {
+        return timers_.add(deadline, std::move(function));
+    }
+
+    /*
+        Run task on event loop after delay. Can be used only on event loop thread.
+    */
+    template <typename Rep, typename Period, typename Function>
+        requires std::invocable<Function>
+    timer_id post_after(std::chrono::duration<Rep, Period> delay, Function function)
+    {
+        return post_at(timer_clock::now() + std::chrono::ceil<timer_clock::duration>(delay), std::move(function));
+    }
+
+    /*
+        Cancel timer that did not fire yet. Returns false if it already fired or was cancelled. Can be used only on
+        event loop thread.
+    */
+    bool cancel(timer_id id) noexcept
+    {
+        return timers_.cancel(id);
+    }
+
+    /*
+        Number of timers that did not fire and were not cancelled yet. Can be used only on event loop thread.
+    */
+    size_t pending_timers() const noexcept
+    {
+        return timers_.size();
+    }
+
+    /*
+        Handle that outlives the loop and posts to it while it is alive, for work that may finish after the loop is
+        gone. Can be called on any thread.
+    */
+    detail::loop_anchor anchor() const noexcept
+    {
+        return anchor_;
+    }
+
+    /*
+        co_await loop.sleep_for(delay) resumes coroutine on this event loop after delay, or earlier with
+        operation_cancelled if token is cancelled. Can be used only on event loop thread.
+    */
+    template <typename Rep, typename Period>
+    sleep_awaiter sleep_for(std::chrono::duration<Rep, Period> delay, cancellation_token token = { }) noexcept
+    {
+        timer_clock::time_point deadline = timer_clock::now() + std::chrono::ceil<timer_clock::duration>(delay);
+        return sleep_awaiter { *this, deadline, std::move(token) };
+    }
+
+    sleep_awaiter sleep_until(timer_clock::time_point deadline, cancellation_token token = { }) noexcept
+    {
+        return sleep_awaiter { *this, deadline, std::move(token) };
+    }
+
+#if defined(COOPERATIVE_HAS_EPOLL)
+    /*
+        co_await loop.readable(fd) resumes coroutine on this event loop once non-blocking fd can be read. Readiness
+        is edge-triggered: read until EAGAIN before awaiting again. Throws operation_cancelled if fd is deregistered
+        meanwhile and con::error if another coroutine already waits to read fd. Can be used only on event loop
+        thread. The awaiting coroutine can be destroyed while suspended.
+    */
+    detail::io_awaiter readable(int fd) noexcept
+    {
+        return detail::io_awaiter { parker_, fd, false };
+    }
+
+    /*
+        co_await loop.writable(fd) resumes coroutine on this event loop once non-blocking fd can be written. Same
+        errors as readable. Can be used only on event loop thread.
+    */
+    detail::io_awaiter writable(int fd) noexcept
+    {
+        return detail::io_awaiter { parker_, fd, true };
+    }
+
+    /*
+        Stop watching fd, must be called before fd is closed. Coroutines waiting for it are resumed, readable and
+        writable throw operation_cancelled and I/O operations yield -ECANCELED. Can be used only on event loop
+        thread.
+    */
+    void deregister(int fd)
+    {
+        if (parker_.forget(fd)) {
+            post([this]() { parker_.resume_ready(); });
+        }
+    }
+
+    /*
+        co_await loop.read(fd, buffer, offset) reads into buffer and yields byte count or minus errno. Can be used only
+        on event loop thread, buffer has to live until the operation completes. Same for the operations below.
+        The awaiting coroutine can be destroyed while suspended, the operation is cancelled.
+    */
+    detail::io_operation read(int fd, std::span<std::byte> buffer, uint64_t offset = current_offset) noexcept
+    {
+        return operation(detail::io_opcode::read, fd, buffer.data(), clamp(buffer.size()), offset);
+    }
+
+    detail::io_operation write(int fd, std::span<const std::byte> buffer, uint64_t offset = current_offset) noexcept
+    {
+        return operation(detail::io_opcode::write, fd, const_cast<std::byte*>(buffer.data()), clamp(buffer.size()),
+            offset);
+    }
+
+    detail::io_operation readv(int fd, std::span<const iovec> buffers, uint64_t offset = current_offset) noexcept
+    {
+        return operation(detail::io_opcode::readv, fd, const_cast<iovec*>(buffers.data()), clamp(buffers.size()),
+            offset);
+    }
+
+    /*
+        Yields accepted descriptor, non-blocking by default.
+    */
+    detail::io_operation accept(int fd, sockaddr* address = nullptr, socklen_t* address_length = nullptr,
+        int flags = SOCK_NONBLOCK | SOCK_CLOEXEC) noexcept
+    {
+        detail::io_request request {
+            detail::io_opcode::accept, fd, address, 0, 0, static_cast<uint32_t>(flags), address_length
+        };
+        return detail::io_operation { parker_, engine(), request };
+    }
+
+    detail::io_operation recv(int fd, std::span<std::byte> buffer, int flags = 0) noexcept
+    {
+        return operation(detail::io_opcode::recv, fd, buffer.data(), clamp(buffer.size()), 0, flags);
+    }
+
+    detail::io_operation send(int fd, std::span<const std::byte> buffer, int flags = MSG_NOSIGNAL) noexcept
+    {
+        return operation(
+            detail::io_opcode::send, fd, const_cast<std::byte*>(buffer.data()), clamp(buffer.size()), 0, flags);
+    }
+
+    /*
+        Registers buffers with io_uring, replacing previous ones. Reads and writes inside them skip pinning pages on
+        every operation. Returns false if io_uring is not used.
+    */
+    bool register_buffers(std::span<const iovec> buffers)
+    {
+#if defined(COOPERATIVE_HAS_IO_URING)
+        return uring_.register_buffers(buffers);
+#else
+        (void)buffers;
+        return false;
+#endif
+    }
+
+    /*
+        Registers descriptors with io_uring, replacing previous ones. Operations on them skip taking a file
+        reference every time. Returns false if io_uring is not used.
+    */
+    bool register_files(std::span<const int> fds)
+    {
+#if defined(COOPERATIVE_HAS_IO_URING)
+        return uring_.register_files(fds);
+#else
+        (void)fds;
+        return false;
+#endif
+    }
+#endif
+
     void stop()
     {
-        std::unique_lock lock(mutex_);
-        stop_ = true;
+        stop_.store(true, std::memory_order_seq_cst);
+        unpark();
     }
 
 private:
-    std::mutex mutex_ {};
-    std::list<move_only_function<void>> task_queue_ {};
-    bool stop_ { false };
+#if defined(COOPERATIVE_HAS_EPOLL)
+    static uint32_t clamp(size_t size) noexcept
+    {
+        return size > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(size);
+    }
+
+    detail::uring_engine* engine() noexcept
+    {
+#if defined(COOPERATIVE_HAS_IO_URING)
+        return &uring_;
+#else
+        return nullptr;
+#endif
+    }
+
+    detail::io_operation operation(
+        detail::io_opcode opcode, int fd, void* address, uint32_t length, uint64_t offset, int flags = 0) noexcept
+    {
+        detail::io_request request { opcode, fd, address, length, offset, static_cast<uint32_t>(flags), nullptr };
+        return detail::io_operation { parker_, engine(), request };
+    }
+
+    /*
+        Busy loop never parks, so I/O is checked between tasks to keep it from starving.
+    */
+    void poll_io()
+    {
+        if (parker_.has_waiters()) {
+            parker_.poll();
+        }
+#if defined(COOPERATIVE_HAS_IO_URING)
+        if (uring_.busy()) {
+            uring_.flush();
+            uring_.reap();
+        }
+#endif
+    }
+#endif
+
+    void park()
+    {
+#if defined(COOPERATIVE_HAS_IO_URING)
+        uring_.flush();
+#endif
+        counters_.park_started();
+        parker_.park(timers_.next_deadline(), [this]() {
+            return queues_empty() && !io_completed() && !stop_.load(std::memory_order_seq_cst); //
+        });
+        counters_.park_finished();
+#if defined(COOPERATIVE_HAS_IO_URING)
+        uring_.reap();
+#endif
+    }
+
+    /*
+        Runs queued tasks, up to batch_size of them, so timers are checked between batches instead of between
+        tasks. Lanes take turns from high to low, each running up to its weight of tasks per turn. Returns number
+        of tasks run.
+    */
+    size_t run_batch()
+    {
+        size_t ran = 0;
+
+        while (ran < batch_size) {
+            size_t ran_before = ran;
+
+            for (size_t level = 0; level < priority_count; ++level) {
+                lane& queue  = lanes_[level];
+                size_t quota = weights_[level];
+
+                while (quota != 0) {
+                    detail::task_node* node = queue.tasks.pop();
+                    if (node == nullptr) {
+                        break;
+                    }
+
+                    --quota;
+                    ++ran;
+                    queue.run.store(queue.run.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+                    counters_.task_started(node, [this]() { return queued_tasks(); });
+                    {
+                        detail::trace_slice slice("ev_loop.task", trace_flow(node));
+                        node->run();
+                    }
+                    counters_.task_finished();
+
+                    if (stop_.load(std::memory_order_acquire)) {
+                        return ran;
+                    }
+                }
+            }
+
+            if (ran == ran_before) {
+                break;
+            }
+        }
+
+        return ran;
+    }
+
+    template <typename T, typename Function>
+    static void run_cancellable(promise<T>& prom, Function& function)
+    {
+        if (prom.cancellation_requested()) {
+            prom.set_exception(std::make_exception_ptr(operation_cancelled()));
+            return;
+        }
+
+        try {
+            prom.set_value(function());
+        } catch (...) {
+            prom.set_exception(std::current_exception());
+        }
+    }
+
+    /*
+        Stamps node for statistics and starts the trace arrow that ends where the task runs.
+    */
+    static void mark_posted([[maybe_unused]] detail::task_node* node) noexcept
+    {
+        detail::loop_counters::stamp(node);
+#if defined(COOPERATIVE_ENABLE_TRACING)
+        node->trace_flow = detail::trace_flow_start("ev_loop.post");
+#endif
+    }
+
+    static uint64_t trace_flow([[maybe_unused]] const detail::task_node* node) noexcept
+    {
+#if defined(COOPERATIVE_ENABLE_TRACING)
+        return node->trace_flow;
+#else
+        return 0;
+#endif
+    }
+
+    size_t queued_tasks() const noexcept
+    {
+        size_t depth = 0;
+        for (const lane& queue : lanes_) {
+            size_t run = queue.run.load(std::memory_order_relaxed);
+            depth += queue.posted.load(std::memory_order_relaxed) - run;
+        }
+        return depth;
+    }
+
+    bool queues_empty() const noexcept
+    {
+        for (const lane& queue : lanes_) {
+            if (!queue.tasks.empty()) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /*
+        True if io_uring has finished requests that were collected but not resumed yet, the loop must not block.
+    */
+    bool io_completed() const noexcept
+    {
+#if defined(COOPERATIVE_HAS_IO_URING)
+        return uring_.completed();
+#else
+        return false;
+#endif
+    }
+
+    static void discard_chain(detail::task_node* node) noexcept
+    {
+        while (node != nullptr) {
+            detail::task_node* next = static_cast<detail::task_node*>(node->next.load(std::memory_order_relaxed));
+            node->discard();
+            node = next;
+        }
+    }
+
+    /*
+        Runs timers that are due. Returns false if none were.
+    */
+    bool run_timers()
+    {
+        timer_clock::time_point now = timer_clock::now();
+        bool ran                    = false;
+
+        while (move_only_function<void> task = timers_.pop_expired(now)) {
+            ran = true;
+            timers_run_.store(timers_run_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            counters_.timer_started();
+            {
+                detail::trace_slice slice("ev_loop.timer");
+                task();
+            }
+            counters_.task_finished();
+
+            if (stop_.load(std::memory_order_acquire)) {
+                break;
+            }
+        }
+
+        return ran;
+    }
+
+    void unpark()
+    {
+        parker_.unpark();
+    }
+
+    static constexpr size_t batch_size = 64;
+
+    struct lane {
+        mpsc_queue<detail::task_node> tasks {};
+        std::atomic<size_t> posted { 0 };
+        std::atomic<size_t> run { 0 };
+    };
+
+    lane lanes_[priority_count] {};
+    detail::loop_counters counters_ {};
+    timer_queue timers_ {};
+    std::atomic<uint64_t> timers_run_ { 0 };
+    std::atomic<bool> stop_ { false };
+    detail::loop_anchor anchor_ { *this };
+#if defined(COOPERATIVE_HAS_EPOLL)
+    static constexpr size_t io_poll_interval = 64;
+
+    detail::epoll_reactor parker_ {};
+#if defined(COOPERATIVE_HAS_IO_URING)
+    detail::uring_engine uring_ {};
+#endif
+#else
+    detail::condition_parker parker_ {};
+#endif
+    idle_policy idle_policy_ {};
+    size_t weights_[priority_count] {};
 };
 
 }
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "function.hpp"
+
+namespace co {
+
+/*
+    Something that runs tasks, like ev_loop or thread_pool. Futures bound to an executor run their continuations on
+    it, whichever thread resolves the promise.
+*/
+class executor {
+public:
+    virtual ~executor() = default;
+
+    /*
+        Put task to executor. Can be called on any thread.
+    */
+    virtual void execute(move_only_function<void> task) = 0;
+};
+
+}
@@ -1,97 +1,198 @@
 #pragma once
 
 #include <concepts>
+#include <cstddef>
 #include <functional>
 #include <memory>
+#include <new>
 #include <type_traits>
+#include <utility>
 
 namespace co {
 
-template <typename Ret, typename... Args>
-class move_only_function {
-private:
-    class functor_base {
-    public:
-        virtual std::conditional_t<std::is_same_v<Ret, void>, void, Ret> call(Args...) const = 0;
+/*
+    Inline storage of move_only_function in bytes. Together with the dispatch table pointer it fills one cache line.
+*/
+inline constexpr size_t default_function_capacity = 48;
 
-        virtual ~functor_base() = default;
-    };
-
-    template <typename F>
-    class functor : public functor_base {
-    public:
-        functor(F&& f)
-            : functor_(std::move(f))
-        {
-        }
-
-        std::conditional_t<std::is_same_v<Ret, void>, void, Ret> call(Args... args) const override
-        {
-            return functor_(std::forward<Args>(args)...);
-        }
+namespace detail {
 
-    private:
-        mutable F functor_;
-    };
+    template <typename F, size_t Capacity>
+    inline constexpr bool fits_inline = sizeof(F) <= Capacity && alignof(F) <= alignof(std::max_align_t)
+        && std::is_nothrow_move_constructible_v<F>;
 
-    std::unique_ptr<functor_base> function_ { };
+}
 
+/*
+    Move only type erased callable. Callables that fit into Capacity bytes and are nothrow movable are stored
+    inline, bigger ones are allocated on the heap. Calls go through a static table of function pointers.
+*/
+template <size_t Capacity, typename Ret, typename... Args>
+class basic_move_only_function {
 public:
+    /*
+        True if callable of type F is stored without heap allocation.
+    */
     template <typename F>
-        requires(std::invocable<F&, Args...> && !std::same_as<std::decay_t<F>, move_only_function>)
-    move_only_function(F&& f)
-        : function_(std::make_unique<functor<std::decay_t<F>>>(std::forward<F>(f)))
-    {
-    }
+    static constexpr bool stored_inline = detail::fits_inline<std::decay_t<F>, Capacity>;
 
-    move_only_function() noexcept
-        : function_(nullptr)
+    template <typename F>
+        requires(std::invocable<F&, Args...> && !std::same_as<std::decay_t<F>, basic_move_only_function>)
+    basic_move_only_function(F&& f)
     {
+        emplace<std::decay_t<F>>(std::forward<F>(f));
     }
 
-    move_only_function(move_only_function&& other) noexcept
+    basic_move_only_function() noexcept = default;
+
+    basic_move_only_function(basic_move_only_function&& other) noexcept
     {
-        std::swap(function_, other.function_);
+        take(other);
     }
 
-    move_only_function& operator=(move_only_function&& other) noexcept
+    basic_move_only_function& operator=(basic_move_only_function&& other) noexcept
     {
         if (this == std::addressof(other)) {
             return *this;
         }
 
-        std::swap(function_, other.function_);
+        reset();
+        take(other);
 
         return *this;
     }
 
     template <typename F>
-        requires(std::invocable<F&, Args...> && !std::same_as<std::decay_t<F>, move_only_function>)
-    move_only_function& operator=(F&& f) noexcept
+        requires(std::invocable<F&, Args...> && !std::same_as<std::decay_t<F>, basic_move_only_function>)
+    basic_move_only_function& operator=(F&& f)
     {
-        function_ = std::make_unique<functor<std::decay_t<F>>>(std::forward<F>(f));
+        reset();
+        emplace<std::decay_t<F>>(std::forward<F>(f));
 
         return *this;
     }
 
-    move_only_function(const move_only_function& other)            = delete;
-    move_only_function& operator=(const move_only_function& other) = delete;
+    basic_move_only_function(const basic_move_only_function& other)            = delete;
+    basic_move_only_function& operator=(const basic_move_only_function& other) = delete;
 
-    ~move_only_function() = default;
+    ~basic_move_only_function()
+    {
+        reset();
+    }
 
-    std::conditional_t<std::is_same_v<Ret, void>, void, Ret> operator()(Args... args) const
+    Ret operator()(Args... args) const
     {
-        if (!function_) {
+        if (!vtable_) {
             throw std::bad_function_call();
         }
 
-        return function_->call(std::forward<Args>(args)...);
+        return vtable_->call(&storage_, std::forward<Args>(args)...);
     }
 
     explicit operator bool() const noexcept
     {
-        return function_ != nullptr;
+        return vtable_ != nullptr;
     }
+
+private:
+    struct vtable {
+        Ret (*call)(void* storage, Args&&... args);
+        void (*relocate)(void* from, void* to) noexcept;
+        void (*destroy)(void* storage) noexcept;
+    };
+
+    template <typename F>
+    struct inline_ops {
+        static F* get(void* storage) noexcept
+        {
+            return std::launder(static_cast<F*>(storage));
+        }
+
+        static Ret call(void* storage, Args&&... args)
+        {
+            return static_cast<Ret>(std::invoke(*get(storage), std::forward<Args>(args)...));
+        }
+
+        static void relocate(void* from, void* to) noexcept
+        {
+            ::new (to) F(std::move(*get(from)));
+            get(from)->~F();
+        }
+
+        static void destroy(void* storage) noexcept
+        {
+            get(storage)->~F();
+        }
+
+        static constexpr vtable table { &call, &relocate, &destroy };
+    };
+
+    template <typename F>
+    struct heap_ops {
+        static F* get(void* storage) noexcept
+        {
+            return *static_cast<F**>(storage);
+        }
+
+        static Ret call(void* storage, Args&&... args)
+        {
+            return static_cast<Ret>(std::invoke(*get(storage), std::forward<Args>(args)...));
+        }
+
+        static void relocate(void* from, void* to) noexcept
+        {
+            *static_cast<F**>(to) = get(from);
+        }
+
+        static void destroy(void* storage) noexcept
+        {
+            delete get(storage);
+        }
+
+        static constexpr vtable table { &call, &relocate, &destroy };
+    };
+
+    template <typename F, typename Arg>
+    void emplace(Arg&& f)
+    {
+        if constexpr (detail::fits_inline<F, Capacity>) {
+            ::new (static_cast<void*>(&storage_)) F(std::forward<Arg>(f));
+            vtable_ = &inline_ops<F>::table;
+        } else {
+            *reinterpret_cast<F**>(&storage_) = new F(std::forward<Arg>(f));
+            vtable_ = &heap_ops<F>::table;
+        }
+    }
+
+    void take(basic_move_only_function& other) noexcept
+    {
+        if (other.vtable_) {
+            other.vtable_->relocate(&other.storage_, &storage_);
+            vtable_       = other.vtable_;
+            other.vtable_ = nullptr;
+        }
+    }
+
+    void reset() noexcept
+    {
+        if (vtable_) {
+            vtable_->destroy(&storage_);
+            vtable_ = nullptr;
+        }
+    }
+
+    static_assert(Capacity >= sizeof(void*), "inline storage must fit a pointer");
+
+    union storage {
+        std::max_align_t align;
+        std::byte bytes[Capacity];
+    };
+
+    const vtable* vtable_ { nullptr };
+    mutable storage storage_;
 };
 
+template <typename Ret, typename... Args>
+using move_only_function = basic_move_only_function<default_function_capacity, Ret, Args...>;
+
 }
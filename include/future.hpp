@@ -1,12 +1,27 @@
 #pragma once
 
+#include "cancellation.hpp"
 #include "error.hpp"
+#include "executor.hpp"
 #include "function.hpp"
+#include "pool.hpp"
 #include "result.hpp"
-
+#include "timer_queue.hpp"
+#include "tracing.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
 #include <exception>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <tuple>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace co {
 
@@ -19,9 +34,56 @@ class promise;
 template <typename T>
 std::pair<future<T>, promise<T>> create_future_promise() noexcept;
 
+template <typename T>
+std::pair<future<T>, promise<T>> create_future_promise(executor& home) noexcept;
+
+template <typename T>
+std::pair<future<T>, promise<T>> create_future_promise(cancellation_token cancellation) noexcept;
+
+template <typename T>
+std::pair<future<T>, promise<T>> create_future_promise(executor& home, cancellation_token cancellation) noexcept;
+
 template <typename T>
 promise<T> create_promise() noexcept;
 
+namespace detail {
+
+    struct future_access;
+
+    struct control_block_pool_tag { };
+
+    using control_block_pool = size_class_pool<control_block_pool_tag, 16, 256, 1024>;
+
+}
+
+/*
+    Exception of a future given by with_timeout or with_deadline that was not ready in time.
+*/
+class timeout_error : public con::error {
+public:
+    timeout_error()
+        : con::error("operation timed out")
+    {
+    }
+};
+
+/*
+    Counters of control block allocations made on the calling thread.
+*/
+inline pool_stats control_block_pool_stats() noexcept
+{
+    return detail::control_block_pool::stats();
+}
+
+/*
+    State shared by future and promise. They can live on different threads: the reference count is atomic and
+    state hands the value and the continuation over without locks. Whoever comes second, the resolving promise or
+    the subscribing continuation, runs the continuation. If home executor is set, continuation is put there
+    instead of running on the resolving thread. An awaiting coroutine is kept as a bare handle next to the
+    continuation, so co_await allocates nothing. If a cancellation token is set, cancelling it while a coroutine
+    awaits resolves the state with operation_cancelled. Promise and cancellation race to claim the state, the
+    loser's result is dropped.
+*/
 template <typename T>
 class future_promise_control_block {
 private:
@@ -34,16 +96,166 @@ private:
     template <typename U>
     friend std::pair<future<U>, promise<U>> create_future_promise() noexcept;
 
+    template <typename U>
+    friend std::pair<future<U>, promise<U>> create_future_promise(executor& home) noexcept;
+
+    template <typename U>
+    friend std::pair<future<U>, promise<U>> create_future_promise(cancellation_token cancellation) noexcept;
+
+    template <typename U>
+    friend std::pair<future<U>, promise<U>> create_future_promise(
+        executor& home, cancellation_token cancellation) noexcept;
+
     template <typename U>
     friend promise<U> create_promise() noexcept;
 
-    future_promise_control_block()  = default;
+    friend struct detail::future_access;
+
+    enum : uint8_t {
+        state_pending,
+        state_subscribed,
+        state_ready,
+    };
+
+    enum : uint8_t {
+        claimed_by_nobody,
+        claimed_by_promise,
+        claimed_by_cancellation,
+    };
+
+    explicit future_promise_control_block(executor* home_executor = nullptr, cancellation_token token = { }) noexcept
+        : home(home_executor)
+        , cancellation(std::move(token))
+    {
+    }
+
     ~future_promise_control_block() = default;
 
-    size_t refcount { 0 };
-    bool ready { false };
+    static void* operator new(size_t size)
+    {
+        static_assert(alignof(future_promise_control_block) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+        return detail::control_block_pool::allocate(size);
+    }
+
+    static void operator delete(void* pointer, size_t size) noexcept
+    {
+        detail::control_block_pool::deallocate(pointer, size);
+    }
+
+    void retain() noexcept
+    {
+        refcount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release() noexcept
+    {
+        if (refcount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+    bool ready() const noexcept
+    {
+        return state.load(std::memory_order_acquire) == state_ready;
+    }
+
+    /*
+        Returns false if the state was already claimed by promise or cancellation.
+    */
+    bool try_publish(con::result<T>&& result, uint8_t claimant = claimed_by_promise)
+    {
+        uint8_t expected = claimed_by_nobody;
+        if (!claimed.compare_exchange_strong(
+                expected, claimant, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            return false;
+        }
+
+        publish(std::move(result));
+        return true;
+    }
+
+    void cancel()
+    {
+        try_publish(con::result<T>(std::make_exception_ptr(operation_cancelled())), claimed_by_cancellation);
+    }
+
+    bool claimed_by(uint8_t claimant) const noexcept
+    {
+        return claimed.load(std::memory_order_acquire) == claimant;
+    }
+
+    void publish(con::result<T>&& result)
+    {
+        value = std::move(result);
+
+        if (state.exchange(state_ready, std::memory_order_acq_rel) == state_subscribed) {
+            run_continuation();
+        }
+    }
+
+    void subscribe(move_only_function<void> callback)
+    {
+        continuation = std::move(callback);
+
+        uint8_t expected = state_pending;
+        if (!state.compare_exchange_strong(
+                expected, state_subscribed, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            move_only_function<void> task = std::move(continuation);
+            detail::trace_slice slice("future.then");
+            task();
+        }
+    }
+
+    /*
+        Returns false if value is already there and coroutine should not suspend.
+    */
+    bool subscribe(std::coroutine_handle<> calling) noexcept
+    {
+        awaiting = calling;
+
+        uint8_t expected = state_pending;
+        return state.compare_exchange_strong(
+            expected, state_subscribed, std::memory_order_acq_rel, std::memory_order_acquire);
+    }
+
+    void run_continuation()
+    {
+        if (home == nullptr) {
+            if (awaiting) {
+                detail::trace_slice slice("coroutine.resume");
+                awaiting.resume();
+                return;
+            }
+
+            move_only_function<void> task = std::move(continuation);
+            detail::trace_slice slice("future.then");
+            task();
+            return;
+        }
+
+        // the future keeps control block alive until the task runs or the executor drops it
+        home->execute([keep_alive = future<T>(this)]() mutable {
+            future_promise_control_block* self = keep_alive.control_block_;
+            if (self->awaiting) {
+                detail::trace_slice slice("coroutine.resume");
+                self->awaiting.resume();
+                return;
+            }
+
+            move_only_function<void> task = std::move(self->continuation);
+            detail::trace_slice slice("future.then");
+            task();
+        });
+    }
+
+    std::atomic<size_t> refcount { 0 };
+    std::atomic<uint8_t> state { state_pending };
+    std::atomic<uint8_t> claimed { claimed_by_nobody };
+    executor* home { nullptr };
+    cancellation_token cancellation { };
     con::result<T> value { };
     move_only_function<void> continuation { };
+    std::coroutine_handle<> awaiting { };
 };
 
 template <typename T>
@@ -58,14 +270,11 @@ public:
             return;
         }
 
-        if (future_given_ && !control_block_->ready) {
-            set_exception(std::make_exception_ptr(con::error("broken promise")));
+        if (future_given_ && control_block_->claimed_by(future_promise_control_block<T>::claimed_by_nobody)) {
+            control_block_->try_publish(con::result<T>(std::make_exception_ptr(con::error("broken promise"))));
         }
 
-        --control_block_->refcount;
-        if (control_block_->refcount == 0) {
-            delete control_block_;
-        }
+        control_block_->release();
     }
 
     promise()
@@ -111,15 +320,13 @@ public:
         if (!control_block_) {
             throw con::error("empty primise");
         }
-        if (control_block_->ready) {
+        if (!control_block_->try_publish(std::move(value))) {
+            // cancellation got there first, nobody waits for the value any more
+            if (control_block_->claimed_by(future_promise_control_block<T>::claimed_by_cancellation)) {
+                return;
+            }
             throw con::error("promise already resolved");
         }
-        control_block_->ready = true;
-        control_block_->value = std::move(value);
-        if (control_block_->continuation) {
-            control_block_->continuation();
-            control_block_->continuation = { };
-        }
     }
 
     void set_value(T value)
@@ -132,9 +339,28 @@ public:
         resolve(con::result<T>(std::move(exception)));
     }
 
+    /*
+        True once the token given to create_future_promise is cancelled. Lets the producer give up early, the
+        future is already resolved with operation_cancelled if a coroutine awaits it. Can be called on any thread.
+    */
+    bool cancellation_requested() const noexcept
+    {
+        return control_block_ != nullptr && control_block_->cancellation.cancellation_requested();
+    }
+
     template <typename U>
     friend std::pair<future<U>, promise<U>> create_future_promise() noexcept;
 
+    template <typename U>
+    friend std::pair<future<U>, promise<U>> create_future_promise(executor& home) noexcept;
+
+    template <typename U>
+    friend std::pair<future<U>, promise<U>> create_future_promise(cancellation_token cancellation) noexcept;
+
+    template <typename U>
+    friend std::pair<future<U>, promise<U>> create_future_promise(
+        executor& home, cancellation_token cancellation) noexcept;
+
     template <typename U>
     friend promise<U> create_promise() noexcept;
 
@@ -142,7 +368,7 @@ private:
     promise(future_promise_control_block<T>* control_block) noexcept
         : control_block_(control_block)
     {
-        ++control_block_->refcount;
+        control_block_->retain();
     }
 
     future_promise_control_block<T>* control_block_ { nullptr };
@@ -152,16 +378,96 @@ private:
 template <typename T>
 class future {
 public:
+    /*
+        Suspends only if the future is not ready yet, the coroutine is resumed by whoever resolves the promise, or
+        on the home executor. Yields the value or rethrows the exception. With a cancellation token, the coroutine
+        is also resumed, with operation_cancelled, by whoever cancels it.
+    */
+    class awaiter {
+        struct canceller {
+            future_promise_control_block<T>* control_block;
+
+            void operator()() noexcept
+            {
+                // the resumed coroutine may drop the last reference
+                future_promise_control_block<T>* self = control_block;
+                self->retain();
+                self->cancel();
+                self->release();
+            }
+        };
+
+    public:
+        explicit awaiter(future<T>&& awaited)
+            : control_block_(std::exchange(awaited.control_block_, nullptr))
+        {
+            if (!control_block_) {
+                throw con::error("empty future");
+            }
+        }
+
+        ~awaiter()
+        {
+            if (control_block_ != nullptr) {
+                control_block_->release();
+            }
+        }
+
+        awaiter(awaiter&& other) noexcept
+            : control_block_(std::exchange(other.control_block_, nullptr))
+        {
+        }
+
+        awaiter(const awaiter& other)            = delete;
+        awaiter& operator=(const awaiter& other) = delete;
+        awaiter& operator=(awaiter&& other)      = delete;
+
+        bool await_ready() const
+        {
+            if (control_block_->cancellation.cancellation_requested()) {
+                control_block_->cancel();
+            }
+            return control_block_->ready();
+        }
+
+        bool await_suspend(std::coroutine_handle<> calling)
+        {
+            // registered before subscribing: a cancellation that comes first resolves the state, so the
+            // coroutine does not suspend instead of being resumed inside await_suspend
+            if (control_block_->cancellation.can_be_cancelled()) {
+                registration_.emplace(control_block_->cancellation, canceller { control_block_ });
+            }
+            return control_block_->subscribe(calling);
+        }
+
+        template <typename U = T>
+            requires(std::is_same_v<U, void>)
+        void await_resume()
+        {
+            registration_.reset();
+            control_block_->value.value();
+        }
+
+        template <typename U = T>
+            requires(!std::is_same_v<U, void>)
+        T await_resume()
+        {
+            registration_.reset();
+            return std::move(control_block_->value.value());
+        }
+
+    private:
+        future_promise_control_block<T>* control_block_;
+        std::optional<cancellation_registration<canceller>> registration_ { };
+    };
+
     ~future()
     {
         if (control_block_ == nullptr) {
             return;
         }
 
-        --control_block_->refcount;
-        if (control_block_->refcount == 0) {
-            delete control_block_;
-        }
+        control_block_->release();
     }
 
     future(const future&)            = delete;
@@ -189,13 +495,23 @@ public:
     template <typename U>
     friend std::pair<future<U>, promise<U>> create_future_promise() noexcept;
 
+    template <typename U>
+    friend std::pair<future<U>, promise<U>> create_future_promise(executor& home) noexcept;
+
+    template <typename U>
+    friend std::pair<future<U>, promise<U>> create_future_promise(cancellation_token cancellation) noexcept;
+
+    template <typename U>
+    friend std::pair<future<U>, promise<U>> create_future_promise(
+        executor& home, cancellation_token cancellation) noexcept;
+
     bool ready() const
     {
         if (!control_block_) {
             throw con::error("empty future");
         }
 
-        return control_block_->ready;
+        return control_block_->ready();
     }
 
     bool has_exception() const
@@ -204,7 +520,7 @@ public:
             throw con::error("empty future");
         }
 
-        return control_block_->value.has_exception() && control_block_->ready;
+        return control_block_->ready() && control_block_->value.has_exception();
     }
 
     bool has_value() const
@@ -213,32 +529,95 @@ public:
             throw con::error("empty future");
         }
 
-        return control_block_->value.has_value() && control_block_->ready;
+        return control_block_->ready() && control_block_->value.has_value();
     }
 
-    con::result<T> result()
+    /*
+        Reference to the result kept in the control block, valid while the future is.
+    */
+    const con::result<T>& result() const&
     {
-        if (!control_block_) {
-            throw con::error("empty future");
-        }
+        check_ready();
+        return control_block_->value;
+    }
 
-        if (!control_block_->ready) {
-            throw con::error("future is not ready");
-        }
+    /*
+        Moves the result out and leaves the future empty: std::move(fut).result().
+    */
+    con::result<T> result() &&
+    {
+        check_ready();
 
-        return control_block_->value;
+        future taken = std::move(*this);
+        return std::move(taken.control_block_->value);
     }
 
-    T get()
+    template <typename U = T>
+        requires(std::is_same_v<U, void>)
+    void get() const&
+    {
+        result().value();
+    }
+
+    template <typename U = T>
+        requires(!std::is_same_v<U, void>)
+    const U& get() const&
     {
         return result().value();
     }
 
+    /*
+        Moves the value out and leaves the future empty, so large payloads are not copied:
+        std::move(fut).get().
+    */
+    template <typename U = T>
+        requires(std::is_same_v<U, void>)
+    void get() &&
+    {
+        std::move(*this).result().value();
+    }
+
+    template <typename U = T>
+        requires(!std::is_same_v<U, void>)
+    U get() &&
+    {
+        return std::move(std::move(*this).result().value());
+    }
+
+    /*
+        Continuation gets the result as an rvalue and may move the value out of it, taking con::result<T> by value
+        or by rvalue reference.
+    */
     template <typename Continuation>
-    future<std::invoke_result_t<Continuation, con::result<T>>> then(Continuation continuation) &&;
+    future<std::invoke_result_t<Continuation, con::result<T>&&>> then(Continuation continuation) &&;
+
+    /*
+        Future of the same result, or of timeout_error if the result is not there within timeout. The timer runs
+        on loop and is removed as soon as the result arrives, so futures that are in time leave no timers behind.
+        A result that arrives after the timeout is dropped, also after the loop is destroyed. The returned future is
+        resolved on the loop thread and can be awaited like any other:
+
+            int value = co_await std::move(fut).with_timeout(loop, 100ms);
+
+        Can be used only on loop thread.
+    */
+    template <typename Loop, typename Rep, typename Period>
+    future with_timeout(Loop& loop, std::chrono::duration<Rep, Period> timeout) &&;
+
+    template <typename Loop>
+    future with_deadline(Loop& loop, timer_clock::time_point deadline) &&;
+
+    awaiter operator co_await() &&
+    {
+        return awaiter { std::move(*this) };
+    }
 
     friend class promise<T>;
 
+    friend class future_promise_control_block<T>;
+
+    friend struct detail::future_access;
+
     template <typename U>
     friend class future;
 
@@ -246,7 +625,18 @@ private:
     future(future_promise_control_block<T>* control_block) noexcept
         : control_block_(control_block)
     {
-        ++control_block_->refcount;
+        control_block_->retain();
+    }
+
+    void check_ready() const
+    {
+        if (!control_block_) {
+            throw con::error("empty future");
+        }
+
+        if (!control_block_->ready()) {
+            throw con::error("future is not ready");
+        }
     }
 
     future_promise_control_block<T>* control_block_ { nullptr };
@@ -256,8 +646,44 @@ template <typename T>
 std::pair<future<T>, promise<T>> create_future_promise() noexcept
 {
     future_promise_control_block<T>* control_block = new future_promise_control_block<T>();
-    future<T> fut(control_block);
     promise<T> prom(control_block);
+    future<T> fut = prom.get_future();
+    return std::pair<future<T>, promise<T>>(std::move(fut), std::move(prom));
+}
+
+/*
+    Continuations of the future run on home executor when promise is resolved on another thread.
+*/
+template <typename T>
+std::pair<future<T>, promise<T>> create_future_promise(executor& home) noexcept
+{
+    future_promise_control_block<T>* control_block = new future_promise_control_block<T>(&home);
+    promise<T> prom(control_block);
+    future<T> fut = prom.get_future();
+    return std::pair<future<T>, promise<T>>(std::move(fut), std::move(prom));
+}
+
+/*
+    Awaiting coroutines are resumed with operation_cancelled once cancellation is requested, whether or not the
+    promise is resolved later.
+*/
+template <typename T>
+std::pair<future<T>, promise<T>> create_future_promise(cancellation_token cancellation) noexcept
+{
+    future_promise_control_block<T>* control_block
+        = new future_promise_control_block<T>(nullptr, std::move(cancellation));
+    promise<T> prom(control_block);
+    future<T> fut = prom.get_future();
+    return std::pair<future<T>, promise<T>>(std::move(fut), std::move(prom));
+}
+
+template <typename T>
+std::pair<future<T>, promise<T>> create_future_promise(executor& home, cancellation_token cancellation) noexcept
+{
+    future_promise_control_block<T>* control_block
+        = new future_promise_control_block<T>(&home, std::move(cancellation));
+    promise<T> prom(control_block);
+    future<T> fut = prom.get_future();
     return std::pair<future<T>, promise<T>>(std::move(fut), std::move(prom));
 }
 
@@ -271,9 +697,9 @@ promise<T> create_promise() noexcept
 
 template <typename T>
 template <typename Continuation>
-future<std::invoke_result_t<Continuation, con::result<T>>> future<T>::then(Continuation continuation) &&
+future<std::invoke_result_t<Continuation, con::result<T>&&>> future<T>::then(Continuation continuation) &&
 {
-    auto [fut, prom] = create_future_promise<std::invoke_result_t<Continuation, con::result<T>>>();
+    auto [fut, prom] = create_future_promise<std::invoke_result_t<Continuation, con::result<T>&&>>();
 
     if (!control_block_) {
         throw con::error("empty future");
@@ -281,26 +707,444 @@ future<std::invoke_result_t<Continuation, con::result<T>>> future<T>::then(Conti
 
     future<T> this_future = std::move(*this);
 
-    if (this_future.ready()) {
-        try {
-            prom.set_value(continuation(this_future.result()));
-        } catch (...) {
-            prom.set_exception(std::current_exception());
+    future_promise_control_block<T>* control_block = this_future.control_block_;
+
+    control_block->subscribe(
+        [prom = std::move(prom), control_block, continuation = std::move(continuation)]() mutable {
+            try {
+                prom.set_value(continuation(std::move(control_block->value)));
+            } catch (...) {
+                prom.set_exception(std::current_exception());
+            }
+        });
+
+    return std::move(fut);
+}
+
+/*
+    Result of when_any: position of the future that finished first and its result.
+*/
+template <typename T>
+struct when_any_result {
+    size_t index { 0 };
+    con::result<T> result { };
+};
+
+namespace detail {
+
+    template <typename T>
+    struct is_future : std::false_type { };
+
+    template <typename T>
+    struct is_future<future<T>> : std::true_type {
+        using value_type = T;
+    };
+
+    template <typename Range>
+    using range_future_value_t = typename is_future<std::ranges::range_value_t<Range>>::value_type;
+
+    /*
+        Lets combinators wait on a future without a then() of their own: the callback goes straight into the
+        control block, which already has room for it, and the result is moved out when it is ready.
+    */
+    struct future_access {
+        template <typename T>
+        static void check(const future<T>& fut)
+        {
+            if (!fut.control_block_) {
+                throw con::error("empty future");
+            }
+        }
+
+        template <typename T>
+        static void subscribe(future<T>& fut, move_only_function<void> callback)
+        {
+            fut.control_block_->subscribe(std::move(callback));
+        }
+
+        template <typename T>
+        static con::result<T> take(future<T>& fut) noexcept
+        {
+            return std::move(fut.control_block_->value);
+        }
+    };
+
+    /*
+        Base of combinator states, allocated once per combinator from the control block pool. Every input
+        subscribes a callback that only captures the state, so subscribing allocates nothing. remaining starts one
+        above the number of inputs: start() holds the extra count while subscribing, because inputs that are already
+        ready call back right away.
+    */
+    class combinator_state {
+    public:
+        static void* operator new(size_t size)
+        {
+            return control_block_pool::allocate(size);
+        }
+
+        static void operator delete(void* pointer, size_t size) noexcept
+        {
+            control_block_pool::deallocate(pointer, size);
+        }
+
+    protected:
+        explicit combinator_state(size_t inputs) noexcept
+            : remaining_(inputs + 1)
+        {
+        }
+
+        /*
+            Returns true for the last arrival.
+        */
+        bool arrive() noexcept
+        {
+            return remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+        }
+
+    private:
+        std::atomic<size_t> remaining_;
+    };
+
+    template <typename... Ts>
+    class when_all_tuple_state : public combinator_state {
+    public:
+        using result_type = std::tuple<con::result<Ts>...>;
+
+        explicit when_all_tuple_state(future<Ts>&&... futures)
+            : combinator_state(sizeof...(Ts))
+            , inputs_(std::move(futures)...)
+        {
+        }
+
+        future<result_type> start()
+        {
+            auto [fut, prom] = create_future_promise<result_type>();
+            output_          = std::move(prom);
+
+            std::apply(
+                [this](future<Ts>&... inputs) {
+                    (future_access::subscribe(inputs, [this]() { arrived(); }), ...); //
+                },
+                inputs_);
+            arrived();
+
+            return std::move(fut);
+        }
+
+    private:
+        void arrived()
+        {
+            if (!arrive()) {
+                return;
+            }
+
+            std::unique_ptr<when_all_tuple_state> self(this);
+            output_.set_value(std::apply(
+                [](future<Ts>&... inputs) { return result_type(future_access::take(inputs)...); }, inputs_));
+        }
+
+        std::tuple<future<Ts>...> inputs_;
+        promise<result_type> output_ { };
+    };
+
+    template <typename T>
+    class when_all_range_state : public combinator_state {
+    public:
+        using result_type = std::vector<con::result<T>>;
+
+        explicit when_all_range_state(std::vector<future<T>>&& futures)
+            : combinator_state(futures.size())
+            , inputs_(std::move(futures))
+        {
+        }
+
+        future<result_type> start()
+        {
+            auto [fut, prom] = create_future_promise<result_type>();
+            output_          = std::move(prom);
+
+            for (future<T>& input : inputs_) {
+                future_access::subscribe(input, [this]() { arrived(); });
+            }
+            arrived();
+
+            return std::move(fut);
+        }
+
+    private:
+        void arrived()
+        {
+            if (!arrive()) {
+                return;
+            }
+
+            std::unique_ptr<when_all_range_state> self(this);
+
+            result_type results;
+            results.reserve(inputs_.size());
+            for (future<T>& input : inputs_) {
+                results.push_back(future_access::take(input));
+            }
+
+            output_.set_value(std::move(results));
+        }
+
+        std::vector<future<T>> inputs_;
+        promise<result_type> output_ { };
+    };
+
+    /*
+        First arrival resolves the output, the state lives until the rest arrive.
+    */
+    template <typename T>
+    class when_any_state : public combinator_state {
+    public:
+        explicit when_any_state(std::vector<future<T>>&& futures)
+            : combinator_state(futures.size())
+            , inputs_(std::move(futures))
+        {
+        }
+
+        future<when_any_result<T>> start()
+        {
+            auto [fut, prom] = create_future_promise<when_any_result<T>>();
+            output_          = std::move(prom);
+
+            for (size_t index = 0; index < inputs_.size(); ++index) {
+                future_access::subscribe(inputs_[index], [this, index]() { arrived(index); });
+            }
+            finish();
+
+            return std::move(fut);
+        }
+
+    private:
+        void arrived(size_t index)
+        {
+            if (!decided_.exchange(true, std::memory_order_acq_rel)) {
+                output_.set_value(when_any_result<T> { index, future_access::take(inputs_[index]) });
+            }
+            finish();
+        }
+
+        void finish() noexcept
+        {
+            if (arrive()) {
+                delete this;
+            }
+        }
+
+        std::vector<future<T>> inputs_;
+        promise<when_any_result<T>> output_ { };
+        std::atomic<bool> decided_ { false };
+    };
+
+    /*
+        Races a future against a timer. The timer, the input continuation and the task it posts each hold a
+        reference, so the state lives until the last of them is gone, whichever side wins. The input reports through
+        a task posted to the loop, so both sides run on the loop thread and decided_ needs no atomics. Whichever
+        comes first resolves the output, an arriving result cancels the timer. A result that arrives after the loop
+        is destroyed resolves the output right away, the timer died with the loop.
+    */
+    template <typename T, typename Loop>
+    class timeout_state {
+        class reference {
+        public:
+            explicit reference(timeout_state* state) noexcept
+                : state_(state)
+            {
+                state_->refcount_.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            ~reference()
+            {
+                if (state_ != nullptr && state_->refcount_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    delete state_;
+                }
+            }
+
+            reference(reference&& other) noexcept
+                : state_(std::exchange(other.state_, nullptr))
+            {
+            }
+
+            reference(const reference&)            = delete;
+            reference& operator=(const reference&) = delete;
+            reference& operator=(reference&&)      = delete;
+
+            timeout_state* operator->() const noexcept
+            {
+                return state_;
+            }
+
+        private:
+            timeout_state* state_;
+        };
+
+    public:
+        static void* operator new(size_t size)
+        {
+            return control_block_pool::allocate(size);
+        }
+
+        static void operator delete(void* pointer, size_t size) noexcept
+        {
+            control_block_pool::deallocate(pointer, size);
+        }
+
+        timeout_state(future<T>&& input, Loop& loop)
+            : input_(std::move(input))
+            , loop_(loop)
+            , anchor_(loop.anchor())
+        {
+        }
+
+        future<T> start(timer_clock::time_point deadline)
+        {
+            // the input may already be ready and settle the state inside subscribe
+            reference self(this);
+
+            auto [fut, prom] = create_future_promise<T>();
+            output_          = std::move(prom);
+
+            timer_ = loop_.post_at(deadline, [timer = reference(this)]() { timer->timed_out(); });
+            future_access::subscribe(input_, [input = reference(this)]() mutable { arrived(std::move(input)); });
+
+            return std::move(fut);
+        }
+
+    private:
+        void timed_out()
+        {
+            decided_ = true;
+            output_.set_exception(std::make_exception_ptr(timeout_error()));
+        }
+
+        static void arrived(reference self)
+        {
+            timeout_state* state          = self.operator->();
+            move_only_function<void> task = [self = std::move(self)]() { self->settle(true); };
+
+            if (!state->anchor_.post(task)) {
+                state->settle(false);
+            }
+        }
+
+        void settle(bool loop_alive)
+        {
+            if (decided_) {
+                return;
+            }
+
+            decided_ = true;
+            if (loop_alive) {
+                loop_.cancel(timer_);
+            }
+            output_.resolve(future_access::take(input_));
         }
-    } else {
-        future_promise_control_block<T>* control_block = this_future.control_block_;
 
-        control_block->continuation
-            = [prom = std::move(prom), control_block, continuation = std::move(continuation)]() mutable {
-                  try {
-                      prom.set_value(continuation(control_block->value));
-                  } catch (...) {
-                      prom.set_exception(std::current_exception());
-                  }
-              };
+        std::atomic<size_t> refcount_ { 0 };
+        future<T> input_;
+        Loop& loop_;
+        decltype(std::declval<Loop&>().anchor()) anchor_;
+        promise<T> output_ { };
+        timer_id timer_ { };
+        bool decided_ { false };
+    };
+
+    template <typename Range>
+    auto collect_futures(Range&& futures)
+    {
+        using future_type = std::ranges::range_value_t<Range>;
+
+        std::vector<future_type> inputs;
+        if constexpr (std::ranges::sized_range<Range>) {
+            inputs.reserve(std::ranges::size(futures));
+        }
+        for (auto&& input : futures) {
+            future_access::check(input);
+            inputs.push_back(std::move(input));
+        }
+        return inputs;
     }
 
-    return std::move(fut);
+}
+
+template <typename T>
+template <typename Loop, typename Rep, typename Period>
+future<T> future<T>::with_timeout(Loop& loop, std::chrono::duration<Rep, Period> timeout) &&
+{
+    timer_clock::time_point deadline = timer_clock::now() + std::chrono::ceil<timer_clock::duration>(timeout);
+    return std::move(*this).with_deadline(loop, deadline);
+}
+
+template <typename T>
+template <typename Loop>
+future<T> future<T>::with_deadline(Loop& loop, timer_clock::time_point deadline) &&
+{
+    detail::future_access::check(*this);
+
+    return (new detail::timeout_state<T, Loop>(std::move(*this), loop))->start(deadline);
+}
+
+/*
+    Future of results of all futures, ready once each of them is. Exceptions are kept per future. Costs one state
+    and one control block whatever the number of futures. Continuation runs on the thread of the last arrival.
+
+    Futures are moved out of a range, so it has to be passed as an rvalue: when_all(std::move(futures)).
+*/
+template <typename... Ts>
+future<std::tuple<con::result<Ts>...>> when_all(future<Ts>... futures)
+{
+    (detail::future_access::check(futures), ...);
+
+    return (new detail::when_all_tuple_state<Ts...>(std::move(futures)...))->start();
+}
+
+template <typename Range>
+    requires std::ranges::input_range<Range> && detail::is_future<std::ranges::range_value_t<Range>>::value
+    && (!std::is_lvalue_reference_v<Range>)
+future<std::vector<con::result<detail::range_future_value_t<Range>>>> when_all(Range&& futures)
+{
+    std::vector<future<detail::range_future_value_t<Range>>> inputs
+        = detail::collect_futures(std::forward<Range>(futures));
+
+    return (new detail::when_all_range_state<detail::range_future_value_t<Range>>(std::move(inputs)))->start();
+}
+
+/*
+    Future of the first future to finish, with its position. The state is freed after the last future finishes, a
+    future whose promise is dropped unresolved finishes with broken promise. Continuation runs on the thread of the
+    first arrival. Like when_all, takes a range only as an rvalue.
+*/
+template <typename Range>
+    requires std::ranges::input_range<Range> && detail::is_future<std::ranges::range_value_t<Range>>::value
+    && (!std::is_lvalue_reference_v<Range>)
+future<when_any_result<detail::range_future_value_t<Range>>> when_any(Range&& futures)
+{
+    using value_type = detail::range_future_value_t<Range>;
+
+    std::vector<future<value_type>> inputs = detail::collect_futures(std::forward<Range>(futures));
+
+    if (inputs.empty()) {
+        auto [fut, prom] = create_future_promise<when_any_result<value_type>>();
+        prom.set_exception(std::make_exception_ptr(con::error("when_any of no futures")));
+        return std::move(fut);
+    }
+
+    return (new detail::when_any_state<value_type>(std::move(inputs)))->start();
+}
+
+template <typename T, typename... Ts>
+    requires(std::is_same_v<T, Ts> && ...)
+future<when_any_result<T>> when_any(future<T> first, future<Ts>... rest)
+{
+    std::vector<future<T>> inputs;
+    inputs.reserve(1 + sizeof...(Ts));
+    inputs.push_back(std::move(first));
+    (inputs.push_back(std::move(rest)), ...);
+
+    return when_any(std::move(inputs));
 }
 
 } // namespace co
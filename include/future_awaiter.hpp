@@ -7,45 +7,43 @@
 
 namespace co {
 
+/*
+    Kept for code written before future became awaitable, co_await std::move(future) does the same.
+*/
 template <typename T = void>
 class future_awaiter {
 public:
     future_awaiter(future<T> future)
-        : future_(std::move(future))
+        : awaiter_(std::move(future))
     {
     }
 
-    bool await_ready() const noexcept
+    bool await_ready() const
     {
-        return false;
+        return awaiter_.await_ready();
     }
 
-    void await_suspend(std::coroutine_handle<> calling)
+    bool await_suspend(std::coroutine_handle<> calling)
     {
-        std::move(future_).then([calling, this](con::result<T> result) {
-            result_ = std::move(result);
-            calling.resume();
-            return con::unit { };
-        });
+        return awaiter_.await_suspend(calling);
     }
 
     template <typename U = T>
         requires(std::is_same_v<U, void>)
     void await_resume()
     {
-        result_.value();
+        awaiter_.await_resume();
     }
 
     template <typename U = T>
         requires(!std::is_same_v<U, void>)
     T await_resume()
     {
-        return result_.value();
+        return awaiter_.await_resume();
     }
 
 private:
-    con::result<T> result_ { };
-    future<T> future_ { };
+    typename future<T>::awaiter awaiter_;
 };
 
 }
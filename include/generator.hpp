@@ -0,0 +1,229 @@
+#pragma once
+
+#include "coroutine.hpp"
+#include "error.hpp"
+
+#include <concepts>
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace co {
+
+/*
+    Coroutine that produces a sequence of values with co_yield, one at a time as the caller iterates. Nothing runs
+    until begin() is called, then the body runs up to the next co_yield on every increment. The iterator refers to
+    the yielded object itself, which lives in the suspended coroutine frame, so values are never copied and memory
+    does not grow with the length of the sequence. Exceptions thrown by the body are rethrown from begin() or
+    operator++. The frame comes from the coroutine frame pool like other coroutines of the library.
+
+        for (const std::string& line : read_lines(file)) { ... }
+*/
+template <typename T>
+class [[nodiscard]] generator {
+public:
+    using value_type = std::remove_cvref_t<T>;
+    using reference  = std::conditional_t<std::is_reference_v<T>, T, T&>;
+    using pointer    = std::add_pointer_t<reference>;
+
+    struct promise;
+
+    using handle_type = detail::promise_handle<promise>;
+
+    struct promise : detail::pooled_frame {
+        pointer value { nullptr };
+        std::exception_ptr exception { };
+
+        template <typename Frame = promise>
+        generator get_return_object() noexcept
+        {
+            return generator { handle_type::from_promise(static_cast<Frame&>(*this)) };
+        }
+
+        std::suspend_always initial_suspend() const noexcept
+        {
+            return { };
+        }
+
+        std::suspend_always final_suspend() const noexcept
+        {
+            return { };
+        }
+
+        std::suspend_always yield_value(std::remove_reference_t<reference>& yielded) noexcept
+        {
+            value = std::addressof(yielded);
+            return { };
+        }
+
+        /*
+            Temporary lives until the end of the co_yield expression, which is after the coroutine resumes.
+        */
+        std::suspend_always yield_value(std::remove_reference_t<reference>&& yielded) noexcept
+        {
+            value = std::addressof(yielded);
+            return { };
+        }
+
+        /*
+            A const lvalue cannot be handed out as a mutable reference, so it is copied. The copy lives in the
+            returned awaiter, which stays in the frame until the coroutine resumes.
+        */
+        class copy_awaiter : public std::suspend_always {
+        public:
+            explicit copy_awaiter(const value_type& yielded)
+                : copy_(yielded)
+            {
+            }
+
+            template <typename P>
+            void await_suspend(std::coroutine_handle<P> handle) noexcept
+            {
+                handle.promise().value = std::addressof(copy_);
+            }
+
+        private:
+            value_type copy_;
+        };
+
+        copy_awaiter yield_value(const value_type& yielded)
+            requires(std::is_same_v<T, value_type> && std::copy_constructible<value_type>)
+        {
+            return copy_awaiter { yielded };
+        }
+
+        void return_void() const noexcept
+        {
+        }
+
+        void unhandled_exception() noexcept
+        {
+            exception = std::current_exception();
+        }
+
+        void rethrow_if_failed()
+        {
+            if (exception) {
+                std::rethrow_exception(std::exchange(exception, nullptr));
+            }
+        }
+
+        template <typename U>
+        std::suspend_never await_transform(U&&) = delete;
+    };
+
+    using promise_type = promise;
+
+    class iterator {
+    public:
+        using iterator_concept = std::input_iterator_tag;
+        using difference_type  = std::ptrdiff_t;
+        using value_type       = generator::value_type;
+
+        iterator() noexcept = default;
+
+        reference operator*() const noexcept
+        {
+            return static_cast<reference>(*handle_.promise().value);
+        }
+
+        pointer operator->() const noexcept
+        {
+            return handle_.promise().value;
+        }
+
+        iterator& operator++()
+        {
+            handle_.resume();
+            if (handle_.done()) {
+                handle_.promise().rethrow_if_failed();
+            }
+            return *this;
+        }
+
+        void operator++(int)
+        {
+            ++*this;
+        }
+
+        friend bool operator==(const iterator& it, std::default_sentinel_t) noexcept
+        {
+            return !it.handle_ || it.handle_.done();
+        }
+
+    private:
+        friend class generator;
+
+        explicit iterator(handle_type handle) noexcept
+            : handle_(handle)
+        {
+        }
+
+        handle_type handle_ { };
+    };
+
+    generator() noexcept = default;
+
+    generator(const generator&)            = delete;
+    generator& operator=(const generator&) = delete;
+
+    generator(generator&& other) noexcept
+        : handle_(std::exchange(other.handle_, nullptr))
+    {
+    }
+
+    generator& operator=(generator&& other) noexcept
+    {
+        if (this != std::addressof(other)) {
+            std::swap(handle_, other.handle_);
+        }
+        return *this;
+    }
+
+    ~generator()
+    {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    /*
+        Runs the body up to the first co_yield. Can be called once.
+    */
+    iterator begin()
+    {
+        if (!handle_) {
+            throw con::error("empty generator");
+        }
+
+        iterator it { handle_ };
+        ++it;
+        return it;
+    }
+
+    std::default_sentinel_t end() const noexcept
+    {
+        return std::default_sentinel;
+    }
+
+private:
+    explicit generator(handle_type handle) noexcept
+        : handle_(handle)
+    {
+    }
+
+    handle_type handle_ { };
+};
+
+}
+
+template <typename T, typename Alloc, typename... Args>
+struct std::coroutine_traits<co::generator<T>, std::allocator_arg_t, Alloc, Args...> {
+    using promise_type = co::detail::allocator_frame<
+        typename co::generator<T>::promise_type,
+        std::remove_cvref_t<Alloc>,
+        std::remove_cvref_t<Args>...>;
+};
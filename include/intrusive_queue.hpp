@@ -0,0 +1,114 @@
+#pragma once
+
+namespace co {
+
+namespace detail {
+
+    template <typename Node>
+    class intrusive_queue;
+
+    /*
+        Links of a node of intrusive_queue. queue is the queue the node is in, or null, so a node can be unlinked
+        without searching for it.
+    */
+    template <typename Node>
+    struct intrusive_link {
+        Node* next { nullptr };
+        Node* prev { nullptr };
+        intrusive_queue<Node>* queue { nullptr };
+    };
+
+    /*
+        FIFO of nodes deriving from intrusive_link, not thread safe. Used for waiters that live in awaiters inside
+        coroutine frames, so queueing a waiter allocates nothing and a waiter whose coroutine is destroyed can
+        unlink itself. Nodes point back to the queue, so it can not be moved.
+    */
+    template <typename Node>
+    class intrusive_queue {
+    public:
+        intrusive_queue() noexcept = default;
+
+        intrusive_queue(const intrusive_queue&)            = delete;
+        intrusive_queue& operator=(const intrusive_queue&) = delete;
+
+        bool empty() const noexcept
+        {
+            return head_ == nullptr;
+        }
+
+        Node* front() const noexcept
+        {
+            return head_;
+        }
+
+        void push_back(Node* node) noexcept
+        {
+            node->next  = nullptr;
+            node->prev  = tail_;
+            node->queue = this;
+            if (tail_ == nullptr) {
+                head_ = node;
+            } else {
+                tail_->next = node;
+            }
+            tail_ = node;
+        }
+
+        Node* pop_front() noexcept
+        {
+            Node* node = head_;
+            if (node != nullptr) {
+                unlink(node);
+            }
+            return node;
+        }
+
+        /*
+            Unlinks node if it is in this queue. Returns false if it is not.
+        */
+        bool remove(Node* node) noexcept
+        {
+            if (node->queue != this) {
+                return false;
+            }
+
+            unlink(node);
+            return true;
+        }
+
+        /*
+            Moves all nodes of other to the end of this queue.
+        */
+        void append(intrusive_queue& other) noexcept
+        {
+            while (Node* node = other.pop_front()) {
+                push_back(node);
+            }
+        }
+
+    private:
+        void unlink(Node* node) noexcept
+        {
+            if (node->prev == nullptr) {
+                head_ = node->next;
+            } else {
+                node->prev->next = node->next;
+            }
+            if (node->next == nullptr) {
+                tail_ = node->prev;
+            } else {
+                node->next->prev = node->prev;
+            }
+
+            node->next  = nullptr;
+            node->prev  = nullptr;
+            node->queue = nullptr;
+        }
+
+        Node* head_ { nullptr };
+        Node* tail_ { nullptr };
+    };
+
+}
+
+}
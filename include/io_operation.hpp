@@ -0,0 +1,194 @@
+#pragma once
+
+#include "io_reactor.hpp"
+#include "io_uring_engine.hpp"
+
+#if defined(COOPERATIVE_HAS_EPOLL)
+
+#include <cerrno>
+#include <coroutine>
+#include <cstdint>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace co {
+
+/*
+    Offset of read, write and readv that uses and advances the file position instead, as read(2) does.
+*/
+inline constexpr uint64_t current_offset = UINT64_MAX;
+
+namespace detail {
+
+#if !defined(COOPERATIVE_HAS_IO_URING)
+    class uring_engine;
+#endif
+
+    /*
+        Awaitable I/O operation, co_await yields what the system call would return, or minus errno. Goes to
+        io_uring when the engine supports it, otherwise the system call is made right away and, if it would block,
+        retried once epoll reports the descriptor ready. Only one reader and one writer can wait for a descriptor
+        on epoll at a time. The coroutine can be destroyed while suspended: a waiter on epoll is unlinked, an
+        operation on io_uring is cancelled and waited for, so the kernel is done with the buffer once it is gone.
+    */
+    class io_operation : io_waiter {
+    public:
+        io_operation(epoll_reactor& reactor, uring_engine* engine, const io_request& request) noexcept
+            : io_waiter { &io_operation::ready }
+            , reactor_(reactor)
+            , engine_(engine)
+            , request_(request)
+        {
+        }
+
+        io_operation(const io_operation&)            = delete;
+        io_operation& operator=(const io_operation&) = delete;
+
+        ~io_operation()
+        {
+            if (waiting_) {
+                reactor_.cancel(request_.fd, this);
+            }
+#if defined(COOPERATIVE_HAS_IO_URING)
+            if (completion_.pending) {
+                engine_->cancel(completion_);
+            }
+#endif
+        }
+
+        bool await_ready()
+        {
+            if (uses_engine()) {
+                return false;
+            }
+
+            completion_.result = perform(request_);
+            return completion_.result != -EAGAIN;
+        }
+
+        bool await_suspend(std::coroutine_handle<> calling)
+        {
+            completion_.calling = calling;
+
+#if defined(COOPERATIVE_HAS_IO_URING)
+            if (uses_engine()) {
+                engine_->submit(request_, completion_);
+                return true;
+            }
+#endif
+
+            return wait_ready();
+        }
+
+        int await_resume() const noexcept
+        {
+            return completion_.result;
+        }
+
+    private:
+        static int perform(const io_request& request) noexcept
+        {
+            ssize_t result;
+            bool positioned = request.offset != current_offset;
+            off_t offset    = static_cast<off_t>(request.offset);
+
+            do {
+                switch (request.opcode) {
+                case io_opcode::read:
+                    result = positioned ? ::pread(request.fd, request.address, request.length, offset)
+                                        : ::read(request.fd, request.address, request.length);
+                    break;
+                case io_opcode::write:
+                    result = positioned ? ::pwrite(request.fd, request.address, request.length, offset)
+                                        : ::write(request.fd, request.address, request.length);
+                    break;
+                case io_opcode::readv: {
+                    const iovec* buffers = static_cast<const iovec*>(request.address);
+                    int count            = static_cast<int>(request.length);
+                    result               = positioned ? ::preadv(request.fd, buffers, count, offset)
+                                                      : ::readv(request.fd, buffers, count);
+                    break;
+                }
+                case io_opcode::accept:
+                    result = ::accept4(request.fd, static_cast<sockaddr*>(request.address), request.address_length,
+                        static_cast<int>(request.flags));
+                    break;
+                case io_opcode::recv:
+                    result = ::recv(request.fd, request.address, request.length, static_cast<int>(request.flags));
+                    break;
+                case io_opcode::send:
+                    result = ::send(request.fd, request.address, request.length, static_cast<int>(request.flags));
+                    break;
+                }
+            } while (result < 0 && errno == EINTR);
+
+            return result < 0 ? -errno : static_cast<int>(result);
+        }
+
+        static void ready(io_waiter* self, bool cancelled)
+        {
+            io_operation* operation = static_cast<io_operation*>(self);
+            operation->waiting_     = false;
+
+            if (cancelled) {
+                operation->completion_.result = -ECANCELED;
+            } else {
+                operation->completion_.result = perform(operation->request_);
+                if (operation->completion_.result == -EAGAIN && operation->wait_ready()) {
+                    return;
+                }
+            }
+
+            detail::trace_slice slice("coroutine.resume");
+            operation->completion_.calling.resume();
+        }
+
+        bool uses_engine() const noexcept
+        {
+#if defined(COOPERATIVE_HAS_IO_URING)
+            return engine_ != nullptr && engine_->supports(request_.opcode);
+#else
+            return false;
+#endif
+        }
+
+        /*
+            Suspends until descriptor is ready. Returns false if a cached edge let the operation finish right away.
+        */
+        bool wait_ready()
+        {
+            bool write = request_.opcode == io_opcode::write || request_.opcode == io_opcode::send;
+
+            while (true) {
+                io_state& state = reactor_.watch(request_.fd);
+                bool& flag      = write ? state.writable : state.readable;
+
+                if (!flag) {
+                    (write ? state.writer : state.reader) = this;
+                    waiting_                              = true;
+                    reactor_.suspended();
+                    return true;
+                }
+
+                flag               = false;
+                completion_.result = perform(request_);
+                if (completion_.result != -EAGAIN) {
+                    return false;
+                }
+            }
+        }
+
+        epoll_reactor& reactor_;
+        uring_engine* engine_;
+        io_request request_;
+        io_completion completion_ { };
+        bool waiting_ { false };
+    };
+
+}
+
+}
+
+#endif
@@ -0,0 +1,447 @@
+#pragma once
+
+#if defined(__linux__)
+#define COOPERATIVE_HAS_EPOLL 1
+#endif
+
+#if defined(COOPERATIVE_HAS_EPOLL)
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "cancellation.hpp"
+#include "error.hpp"
+#include "timer_queue.hpp"
+#include "tracing.hpp"
+
+namespace co {
+
+namespace detail {
+
+    enum class io_opcode : uint8_t {
+        read,
+        write,
+        readv,
+        accept,
+        recv,
+        send,
+    };
+
+    /*
+        Operation and its arguments, close to the system call it describes. offset of uint64_t(-1) means the current
+        file position. For accept address and address_length receive the peer address.
+    */
+    struct io_request {
+        io_opcode opcode;
+        int fd;
+        void* address;
+        uint32_t length;
+        uint64_t offset;
+        uint32_t flags;
+        socklen_t* address_length;
+    };
+
+    /*
+        Where the completion of a submitted request goes. result is what the system call would return, or minus
+        errno. pending is set while the request is with the engine, until calling is resumed.
+    */
+    struct io_completion {
+        std::coroutine_handle<> calling { };
+        int32_t result { 0 };
+        bool pending { false };
+    };
+
+    /*
+        Something suspended until a descriptor becomes ready. notify is called on event loop thread once it does,
+        or with cancelled set when the descriptor is deregistered.
+    */
+    struct io_waiter {
+        void (*notify)(io_waiter* self, bool cancelled) { nullptr };
+    };
+
+    /*
+        Readiness of one file descriptor registered in edge-triggered mode. A ready flag remembers an edge that
+        arrived while nobody was waiting, the next await consumes it.
+    */
+    struct io_state {
+        int fd { -1 };
+        bool readable { false };
+        bool writable { false };
+        io_waiter* reader { nullptr };
+        io_waiter* writer { nullptr };
+    };
+
+    /*
+        epoll based reactor that also parks the event loop thread. Posted tasks wake it through an eventfd, so
+        readiness, tasks and timers all wake the same epoll_wait. Same park/unpark handshake as condition_parker.
+        Everything except unpark can be used only on event loop thread.
+    */
+    class epoll_reactor {
+    public:
+        epoll_reactor()
+            : epoll_fd_(::epoll_create1(EPOLL_CLOEXEC))
+        {
+            if (epoll_fd_ < 0) {
+                throw std::system_error(errno, std::system_category(), "epoll_create1");
+            }
+
+            event_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (event_fd_ < 0) {
+                int error = errno;
+                ::close(epoll_fd_);
+                throw std::system_error(error, std::system_category(), "eventfd");
+            }
+
+            epoll_event event { };
+            event.events   = EPOLLIN;
+            event.data.ptr = nullptr;
+            if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &event) < 0) {
+                int error = errno;
+                ::close(event_fd_);
+                ::close(epoll_fd_);
+                throw std::system_error(error, std::system_category(), "epoll_ctl");
+            }
+        }
+
+        epoll_reactor(const epoll_reactor&)            = delete;
+        epoll_reactor& operator=(const epoll_reactor&) = delete;
+
+        ~epoll_reactor()
+        {
+            ::close(event_fd_);
+            ::close(epoll_fd_);
+        }
+
+        template <typename Idle>
+        void park(std::optional<timer_clock::time_point> deadline, Idle idle)
+        {
+            parked_.store(true, std::memory_order_seq_cst);
+
+            int timeout = 0;
+            if (idle()) {
+                timeout = deadline ? timeout_until(*deadline) : -1;
+            }
+
+            wait(timeout);
+
+            parked_.store(false, std::memory_order_relaxed);
+
+            resume_ready();
+        }
+
+        void unpark()
+        {
+            if (!parked_.load(std::memory_order_seq_cst) || notified_.exchange(true, std::memory_order_acq_rel)) {
+                return;
+            }
+
+            uint64_t one = 1;
+            ssize_t written;
+            do {
+                written = ::write(event_fd_, &one, sizeof(one));
+            } while (written < 0 && errno == EINTR);
+        }
+
+        /*
+            Resumes coroutines waiting for descriptors that are ready now, without blocking.
+        */
+        void poll()
+        {
+            wait(0);
+            resume_ready();
+        }
+
+        /*
+            Registers descriptor on first use.
+        */
+        io_state& watch(int fd)
+        {
+            auto [it, inserted] = states_.try_emplace(fd);
+            if (inserted) {
+                it->second     = std::make_unique<io_state>();
+                it->second->fd = fd;
+
+                epoll_event event { };
+                event.events   = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+                event.data.ptr = it->second.get();
+                if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+                    int error = errno;
+                    states_.erase(it);
+                    throw std::system_error(error, std::system_category(), "epoll_ctl");
+                }
+            }
+            return *it->second;
+        }
+
+        /*
+            Lets descriptor of a completion queue wake the parked thread. It is level-triggered and has no waiters,
+            the owner drains the queue after every park.
+        */
+        void watch_completions(int fd)
+        {
+            epoll_event event { };
+            event.events   = EPOLLIN;
+            event.data.ptr = &completions_;
+            if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+                throw std::system_error(errno, std::system_category(), "epoll_ctl");
+            }
+        }
+
+        /*
+            Removes descriptor from the reactor. Waiters that were suspended on it are notified as cancelled by the
+            next resume_ready, returns true if there were any.
+        */
+        bool forget(int fd)
+        {
+            auto it = states_.find(fd);
+            if (it == states_.end()) {
+                return false;
+            }
+
+            size_t queued = ready_.size();
+
+            ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+
+            if (it->second->reader) {
+                ready_.push_back(ready_waiter { it->second->reader, true });
+                --waiting_;
+            }
+            if (it->second->writer) {
+                ready_.push_back(ready_waiter { it->second->writer, true });
+                --waiting_;
+            }
+
+            states_.erase(it);
+
+            return ready_.size() != queued;
+        }
+
+        /*
+            Unlinks waiter that goes away before it was notified, like the awaiter of a destroyed coroutine.
+        */
+        void cancel(int fd, io_waiter* waiter) noexcept
+        {
+            auto it = states_.find(fd);
+            if (it != states_.end()) {
+                if (it->second->reader == waiter) {
+                    it->second->reader = nullptr;
+                    --waiting_;
+                }
+                if (it->second->writer == waiter) {
+                    it->second->writer = nullptr;
+                    --waiting_;
+                }
+            }
+
+            for (ready_waiter& entry : ready_) {
+                if (entry.waiter == waiter) {
+                    entry.waiter = nullptr;
+                }
+            }
+        }
+
+        /*
+            Notifies waiters collected by the last wait or forget. A notified coroutine may add or cancel waiters,
+            so the list is walked by index and cancelled entries are skipped.
+        */
+        void resume_ready()
+        {
+            for (size_t index = 0; index < ready_.size(); ++index) {
+                ready_waiter entry = std::exchange(ready_[index], ready_waiter { });
+                if (entry.waiter) {
+                    entry.waiter->notify(entry.waiter, entry.cancelled);
+                }
+            }
+            ready_.clear();
+        }
+
+        void suspended() noexcept
+        {
+            ++waiting_;
+        }
+
+        /*
+            True if some coroutine waits for a descriptor, so a busy loop has to poll for readiness now and then.
+        */
+        bool has_waiters() const noexcept
+        {
+            return waiting_ != 0;
+        }
+
+    private:
+        static constexpr int max_events = 64;
+
+        struct ready_waiter {
+            io_waiter* waiter { nullptr };
+            bool cancelled { false };
+        };
+
+        static int timeout_until(timer_clock::time_point deadline) noexcept
+        {
+            timer_clock::time_point now = timer_clock::now();
+            if (deadline <= now) {
+                return 0;
+            }
+
+            auto milliseconds = std::chrono::ceil<std::chrono::milliseconds>(deadline - now).count();
+            return milliseconds > INT32_MAX ? INT32_MAX : static_cast<int>(milliseconds);
+        }
+
+        /*
+            Waits for events at most timeout milliseconds, -1 waits forever, and collects coroutines waiting for
+            descriptors that became ready.
+        */
+        void wait(int timeout)
+        {
+            epoll_event events[max_events];
+
+            int count = ::epoll_wait(epoll_fd_, events, max_events, timeout);
+            if (count < 0) {
+                if (errno == EINTR) {
+                    return;
+                }
+                throw std::system_error(errno, std::system_category(), "epoll_wait");
+            }
+
+            for (int index = 0; index < count; ++index) {
+                io_state* state = static_cast<io_state*>(events[index].data.ptr);
+
+                if (state == nullptr) {
+                    notified_.store(false, std::memory_order_release);
+                    uint64_t value = 0;
+                    while (::read(event_fd_, &value, sizeof(value)) > 0) {
+                    }
+                    continue;
+                }
+
+                if (state == &completions_) {
+                    continue;
+                }
+
+                uint32_t flags = events[index].events;
+                bool failed    = (flags & (EPOLLERR | EPOLLHUP)) != 0;
+
+                if (failed || (flags & (EPOLLIN | EPOLLRDHUP)) != 0) {
+                    wake(state->reader, state->readable);
+                }
+                if (failed || (flags & EPOLLOUT) != 0) {
+                    wake(state->writer, state->writable);
+                }
+            }
+        }
+
+        void wake(io_waiter*& waiter, bool& ready)
+        {
+            if (waiter) {
+                ready_.push_back(ready_waiter { waiter, false });
+                waiter = nullptr;
+                --waiting_;
+            } else {
+                ready = true;
+            }
+        }
+
+        int epoll_fd_ { -1 };
+        int event_fd_ { -1 };
+        std::atomic<bool> parked_ { false };
+        std::atomic<bool> notified_ { false };
+        std::unordered_map<int, std::unique_ptr<io_state>> states_ { };
+        std::vector<ready_waiter> ready_ { };
+        io_state completions_ { };
+        size_t waiting_ { 0 };
+    };
+
+    /*
+        Suspends until descriptor is readable or writable. Readiness is edge-triggered, so the awaiting coroutine
+        should do its non-blocking operation until EAGAIN before awaiting again. Wakeups can be spurious. Only one
+        reader and one writer can wait for a descriptor at a time, another one throws con::error. Resumes with
+        operation_cancelled if the descriptor is deregistered meanwhile. Destroying the coroutine while it is
+        suspended unlinks the waiter.
+    */
+    class io_awaiter : io_waiter {
+    public:
+        io_awaiter(epoll_reactor& reactor, int fd, bool write) noexcept
+            : io_waiter { &io_awaiter::resume }
+            , reactor_(reactor)
+            , fd_(fd)
+            , write_(write)
+        {
+        }
+
+        io_awaiter(const io_awaiter&)            = delete;
+        io_awaiter& operator=(const io_awaiter&) = delete;
+
+        ~io_awaiter()
+        {
+            if (calling_) {
+                reactor_.cancel(fd_, this);
+            }
+        }
+
+        bool await_ready()
+        {
+            state_     = &reactor_.watch(fd_);
+            bool& flag = write_ ? state_->writable : state_->readable;
+            if (flag) {
+                flag = false;
+                return true;
+            }
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> calling)
+        {
+            io_waiter*& slot = write_ ? state_->writer : state_->reader;
+            if (slot != nullptr) {
+                throw con::error(write_ ? "descriptor already has a waiting writer"
+                                        : "descriptor already has a waiting reader");
+            }
+
+            calling_ = calling;
+            slot     = this;
+            reactor_.suspended();
+        }
+
+        void await_resume() const
+        {
+            if (cancelled_) {
+                throw operation_cancelled();
+            }
+        }
+
+    private:
+        static void resume(io_waiter* self, bool cancelled) noexcept
+        {
+            io_awaiter* awaiter = static_cast<io_awaiter*>(self);
+            awaiter->cancelled_ = cancelled;
+            detail::trace_slice slice("coroutine.resume");
+            std::exchange(awaiter->calling_, nullptr).resume();
+        }
+
+        epoll_reactor& reactor_;
+        int fd_;
+        bool write_;
+        io_state* state_ { nullptr };
+        std::coroutine_handle<> calling_ { };
+        bool cancelled_ { false };
+    };
+
+}
+
+}
+
+#endif
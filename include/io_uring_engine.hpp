@@ -0,0 +1,584 @@
+#pragma once
+
+#if defined(COOPERATIVE_HAS_IO_URING) && !defined(__linux__)
+#error "io_uring is available only on Linux"
+#endif
+
+#if defined(COOPERATIVE_HAS_IO_URING)
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "io_reactor.hpp"
+#include "tracing.hpp"
+
+namespace co {
+
+namespace detail {
+
+    /*
+        Completion based I/O over io_uring, set up with raw system calls. Requests are queued in the submission ring
+        and handed to the kernel in batches by flush, completions are read from the shared completion ring without
+        system calls. Requests on registered files and on buffers inside registered buffers use the fixed variants
+        of the operations. If the kernel has no io_uring or lacks an operation, supports returns false and the
+        caller has to do the operation another way. Can be used only on event loop thread.
+    */
+    class uring_engine {
+    public:
+        explicit uring_engine(unsigned entries = 256)
+        {
+            io_uring_params params { };
+
+            ring_fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+            if (ring_fd_ < 0) {
+                return;
+            }
+
+            if (!map_rings(params) || !probe()) {
+                unmap_rings();
+                ::close(ring_fd_);
+                ring_fd_ = -1;
+                return;
+            }
+        }
+
+        uring_engine(const uring_engine&)            = delete;
+        uring_engine& operator=(const uring_engine&) = delete;
+
+        /*
+            Requests still in flight are cancelled by the kernel, their buffers must outlive the engine.
+        */
+        ~uring_engine()
+        {
+            if (ring_fd_ >= 0) {
+                unmap_rings();
+                ::close(ring_fd_);
+            }
+        }
+
+        bool available() const noexcept
+        {
+            return ring_fd_ >= 0;
+        }
+
+        /*
+            Descriptor that is readable while completions are waiting to be reaped.
+        */
+        int fd() const noexcept
+        {
+            return ring_fd_;
+        }
+
+        bool supports(io_opcode opcode) const noexcept
+        {
+            return available() && supported_[static_cast<size_t>(opcode)];
+        }
+
+        /*
+            Queues request, completion is resumed from reap after a later flush.
+        */
+        void submit(const io_request& request, io_completion& completion)
+        {
+            ++in_flight_;
+            completion.pending = true;
+
+            if (!backlog_.empty() || full()) {
+                flush();
+                if (!backlog_.empty() || full()) {
+                    backlog_.push_back(queued { request, &completion });
+                    return;
+                }
+            }
+
+            push(request, completion);
+        }
+
+        /*
+            Hands queued requests to the kernel with one system call.
+        */
+        void flush()
+        {
+            while (true) {
+                size_t moved = 0;
+                while (moved < backlog_.size() && !full()) {
+                    push(backlog_[moved].request, *backlog_[moved].completion);
+                    ++moved;
+                }
+                backlog_.erase(backlog_.begin(), backlog_.begin() + static_cast<std::ptrdiff_t>(moved));
+
+                unsigned pending = sq_tail_ - submitted_;
+                if (pending == 0) {
+                    return;
+                }
+
+                std::atomic_ref(*sq_tail_pointer_).store(sq_tail_, std::memory_order_release);
+
+                int result = enter(pending, 0);
+                if (result < 0) {
+                    if (result == -EINTR || result == -EAGAIN || result == -EBUSY) {
+                        // completion ring is full, retried after the next reap
+                        return;
+                    }
+                    throw std::system_error(-result, std::system_category(), "io_uring_enter");
+                }
+
+                submitted_ += static_cast<unsigned>(result);
+
+                if (backlog_.empty() || static_cast<unsigned>(result) < pending) {
+                    return;
+                }
+            }
+        }
+
+        /*
+            Takes back a pending request whose coroutine is being destroyed. A request still in the backlog is
+            dropped. One handed to the kernel is cancelled and waited for, so neither its completion nor its buffer
+            is touched once this returns. Completions of other requests reaped meanwhile are resumed by the next
+            reap.
+        */
+        void cancel(io_completion& completion)
+        {
+            completion.pending = false;
+
+            for (auto it = backlog_.begin(); it != backlog_.end(); ++it) {
+                if (it->completion == &completion) {
+                    backlog_.erase(it);
+                    --in_flight_;
+                    return;
+                }
+            }
+
+            bool queued       = false;
+            unsigned position = 0;
+            while (!finished(completion)) {
+                if (!queued && !full()) {
+                    position = sq_tail_;
+                    push_cancel(completion);
+                    ++in_flight_;
+                    queued = true;
+                }
+
+                flush();
+                collect();
+
+                if (!finished(completion)) {
+                    enter(0, IORING_ENTER_GETEVENTS, 1);
+                }
+            }
+
+            // the cancel request must not outlive the frame, another request may get the same address
+            while (queued && static_cast<int>(submitted_ - position) <= 0) {
+                collect();
+                flush();
+            }
+
+            std::replace(completed_.begin(), completed_.end(), &completion, static_cast<io_completion*>(nullptr));
+        }
+
+        /*
+            Resumes coroutines of finished requests. Returns false if there were none.
+        */
+        bool reap()
+        {
+            bool reaped = false;
+
+            while (true) {
+                collect();
+                if (completed_.empty()) {
+                    return reaped;
+                }
+
+                // a resumed coroutine may destroy one whose completion waits behind it
+                for (size_t index = 0; index < completed_.size(); ++index) {
+                    io_completion* completion = std::exchange(completed_[index], nullptr);
+                    if (completion == nullptr) {
+                        continue;
+                    }
+
+                    completion->pending = false;
+                    reaped              = true;
+                    detail::trace_slice slice("coroutine.resume");
+                    completion->calling.resume();
+                }
+                completed_.clear();
+            }
+        }
+
+        /*
+            True if some request is queued, not finished yet or not resumed yet.
+        */
+        bool busy() const noexcept
+        {
+            return in_flight_ != 0 || !completed_.empty();
+        }
+
+        /*
+            True if some request finished and waits for reap.
+        */
+        bool completed() const noexcept
+        {
+            return !completed_.empty();
+        }
+
+        /*
+            True if some request is queued and not handed to the kernel yet.
+        */
+        bool pending() const noexcept
+        {
+            return sq_tail_ != submitted_ || !backlog_.empty();
+        }
+
+        /*
+            Registers buffers, replacing previously registered ones. Reads and writes that fall inside one of them
+            skip page pinning on every request. Returns false if kernel refused.
+        */
+        bool register_buffers(std::span<const iovec> buffers)
+        {
+            if (!available()) {
+                return false;
+            }
+
+            if (!buffers_.empty()) {
+                ::syscall(__NR_io_uring_register, ring_fd_, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+                buffers_.clear();
+            }
+
+            if (buffers.empty()) {
+                return true;
+            }
+
+            if (::syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_BUFFERS, buffers.data(),
+                    static_cast<unsigned>(buffers.size()))
+                < 0) {
+                return false;
+            }
+
+            buffers_.assign(buffers.begin(), buffers.end());
+            return true;
+        }
+
+        /*
+            Registers descriptors, replacing previously registered ones. Requests on them skip taking a file
+            reference on every request. Returns false if kernel refused.
+        */
+        bool register_files(std::span<const int> fds)
+        {
+            if (!available()) {
+                return false;
+            }
+
+            if (!files_.empty()) {
+                ::syscall(__NR_io_uring_register, ring_fd_, IORING_UNREGISTER_FILES, nullptr, 0);
+                files_.clear();
+            }
+
+            if (fds.empty()) {
+                return true;
+            }
+
+            if (::syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_FILES, fds.data(),
+                    static_cast<unsigned>(fds.size()))
+                < 0) {
+                return false;
+            }
+
+            for (size_t index = 0; index < fds.size(); ++index) {
+                files_.emplace(fds[index], static_cast<unsigned>(index));
+            }
+            return true;
+        }
+
+    private:
+        static constexpr size_t opcodes = 6;
+
+        struct queued {
+            io_request request;
+            io_completion* completion;
+        };
+
+        /*
+            Moves finished requests from the completion ring to completed_, without resuming them. Completions of
+            cancel requests carry no completion and are dropped.
+        */
+        void collect()
+        {
+            while (true) {
+                unsigned head = *cq_head_;
+                unsigned tail = std::atomic_ref(*cq_tail_).load(std::memory_order_acquire);
+
+                if (head == tail) {
+                    if ((std::atomic_ref(*sq_flags_).load(std::memory_order_relaxed) & IORING_SQ_CQ_OVERFLOW) == 0) {
+                        return;
+                    }
+                    // kernel kept completions that did not fit, let it move them to the ring
+                    enter(0, IORING_ENTER_GETEVENTS);
+                    if (std::atomic_ref(*cq_tail_).load(std::memory_order_acquire) == head) {
+                        return;
+                    }
+                    continue;
+                }
+
+                const io_uring_cqe& cqe   = cqes_[head & cq_mask_];
+                io_completion* completion = reinterpret_cast<io_completion*>(cqe.user_data);
+                int32_t result            = cqe.res;
+
+                std::atomic_ref(*cq_head_).store(head + 1, std::memory_order_release);
+                --in_flight_;
+
+                if (completion != nullptr) {
+                    completion->result = result;
+                    completed_.push_back(completion);
+                }
+            }
+        }
+
+        bool finished(const io_completion& completion) const noexcept
+        {
+            return std::find(completed_.begin(), completed_.end(), &completion) != completed_.end();
+        }
+
+        bool full() const noexcept
+        {
+            return sq_tail_ - std::atomic_ref(*sq_head_).load(std::memory_order_acquire) == sq_entries_;
+        }
+
+        void push(const io_request& request, io_completion& completion) noexcept
+        {
+            unsigned index    = sq_tail_ & sq_mask_;
+            io_uring_sqe& sqe = sqes_[index];
+            std::memset(&sqe, 0, sizeof(sqe));
+
+            sqe.fd        = request.fd;
+            sqe.addr      = reinterpret_cast<uint64_t>(request.address);
+            sqe.len       = request.length;
+            sqe.off       = request.offset;
+            sqe.user_data = reinterpret_cast<uint64_t>(&completion);
+
+            switch (request.opcode) {
+            case io_opcode::read:
+            case io_opcode::write: {
+                bool write = request.opcode == io_opcode::write;
+                sqe.opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+                if (int buffer = registered_buffer(request.address, request.length); buffer >= 0) {
+                    sqe.opcode    = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+                    sqe.buf_index = static_cast<uint16_t>(buffer);
+                }
+                break;
+            }
+            case io_opcode::readv:
+                sqe.opcode = IORING_OP_READV;
+                break;
+            case io_opcode::accept:
+                sqe.opcode       = IORING_OP_ACCEPT;
+                sqe.len          = 0;
+                sqe.addr2        = reinterpret_cast<uint64_t>(request.address_length);
+                sqe.accept_flags = request.flags;
+                break;
+            case io_opcode::recv:
+                sqe.opcode    = IORING_OP_RECV;
+                sqe.off       = 0;
+                sqe.msg_flags = request.flags;
+                break;
+            case io_opcode::send:
+                sqe.opcode    = IORING_OP_SEND;
+                sqe.off       = 0;
+                sqe.msg_flags = request.flags;
+                break;
+            }
+
+            if (!files_.empty()) {
+                if (auto it = files_.find(request.fd); it != files_.end()) {
+                    sqe.fd = static_cast<int32_t>(it->second);
+                    sqe.flags |= IOSQE_FIXED_FILE;
+                }
+            }
+
+            sq_array_[index] = index;
+            ++sq_tail_;
+        }
+
+        /*
+            Queues cancellation of the request of target, its own completion has no user data.
+        */
+        void push_cancel(const io_completion& target) noexcept
+        {
+            unsigned index    = sq_tail_ & sq_mask_;
+            io_uring_sqe& sqe = sqes_[index];
+            std::memset(&sqe, 0, sizeof(sqe));
+
+            sqe.opcode    = IORING_OP_ASYNC_CANCEL;
+            sqe.fd        = -1;
+            sqe.addr      = reinterpret_cast<uint64_t>(&target);
+            sqe.user_data = 0;
+
+            sq_array_[index] = index;
+            ++sq_tail_;
+        }
+
+        int enter(unsigned to_submit, unsigned flags, unsigned min_complete = 0) noexcept
+        {
+            long result = ::syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete, flags, nullptr, 0);
+            return result < 0 ? -errno : static_cast<int>(result);
+        }
+
+        bool map_rings(const io_uring_params& params)
+        {
+            sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+            bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (single) {
+                sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+            }
+
+            sq_ring_ = map(sq_ring_size_, IORING_OFF_SQ_RING);
+            if (sq_ring_ == nullptr) {
+                return false;
+            }
+
+            cq_ring_ = single ? sq_ring_ : map(cq_ring_size_, IORING_OFF_CQ_RING);
+            if (cq_ring_ == nullptr) {
+                return false;
+            }
+
+            sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+            sqes_      = static_cast<io_uring_sqe*>(map(sqes_size_, IORING_OFF_SQES));
+            if (sqes_ == nullptr) {
+                return false;
+            }
+
+            std::byte* sq = static_cast<std::byte*>(sq_ring_);
+            std::byte* cq = static_cast<std::byte*>(cq_ring_);
+
+            sq_head_         = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+            sq_tail_pointer_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            sq_flags_        = reinterpret_cast<unsigned*>(sq + params.sq_off.flags);
+            sq_array_        = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+            sq_mask_         = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            sq_entries_      = params.sq_entries;
+            sq_tail_         = *sq_tail_pointer_;
+            submitted_       = sq_tail_;
+
+            cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            cqes_    = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+            return true;
+        }
+
+        void* map(size_t size, uint64_t offset) noexcept
+        {
+            void* pointer = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                static_cast<off_t>(offset));
+            return pointer == MAP_FAILED ? nullptr : pointer;
+        }
+
+        void unmap_rings() noexcept
+        {
+            if (sqes_ != nullptr) {
+                ::munmap(sqes_, sqes_size_);
+            }
+            if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+                ::munmap(cq_ring_, cq_ring_size_);
+            }
+            if (sq_ring_ != nullptr) {
+                ::munmap(sq_ring_, sq_ring_size_);
+            }
+        }
+
+        /*
+            Kernels before 5.6 cannot probe and lack most operations, io_uring is not used on them.
+        */
+        bool probe()
+        {
+            constexpr unsigned probed = 256;
+
+            std::vector<std::byte> storage(sizeof(io_uring_probe) + probed * sizeof(io_uring_probe_op));
+            io_uring_probe* result = reinterpret_cast<io_uring_probe*>(storage.data());
+
+            if (::syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_PROBE, result, probed) < 0) {
+                return false;
+            }
+
+            auto has = [result](unsigned opcode) {
+                return opcode <= result->last_op && (result->ops[opcode].flags & IO_URING_OP_SUPPORTED) != 0;
+            };
+
+            supported_[static_cast<size_t>(io_opcode::read)]
+                = has(IORING_OP_READ) && has(IORING_OP_READ_FIXED);
+            supported_[static_cast<size_t>(io_opcode::write)]
+                = has(IORING_OP_WRITE) && has(IORING_OP_WRITE_FIXED);
+            supported_[static_cast<size_t>(io_opcode::readv)]  = has(IORING_OP_READV);
+            supported_[static_cast<size_t>(io_opcode::accept)] = has(IORING_OP_ACCEPT);
+            supported_[static_cast<size_t>(io_opcode::recv)]   = has(IORING_OP_RECV);
+            supported_[static_cast<size_t>(io_opcode::send)]   = has(IORING_OP_SEND);
+
+            // destroying a coroutine with a request in flight relies on it
+            return has(IORING_OP_ASYNC_CANCEL);
+        }
+
+        int registered_buffer(const void* address, uint32_t length) const noexcept
+        {
+            const std::byte* begin = static_cast<const std::byte*>(address);
+            for (size_t index = 0; index < buffers_.size(); ++index) {
+                const std::byte* base = static_cast<const std::byte*>(buffers_[index].iov_base);
+                if (begin >= base && begin + length <= base + buffers_[index].iov_len) {
+                    return static_cast<int>(index);
+                }
+            }
+            return -1;
+        }
+
+        int ring_fd_ { -1 };
+
+        void* sq_ring_ { nullptr };
+        void* cq_ring_ { nullptr };
+        io_uring_sqe* sqes_ { nullptr };
+        size_t sq_ring_size_ { 0 };
+        size_t cq_ring_size_ { 0 };
+        size_t sqes_size_ { 0 };
+
+        unsigned* sq_head_ { nullptr };
+        unsigned* sq_tail_pointer_ { nullptr };
+        unsigned* sq_flags_ { nullptr };
+        unsigned* sq_array_ { nullptr };
+        unsigned sq_mask_ { 0 };
+        unsigned sq_entries_ { 0 };
+        unsigned sq_tail_ { 0 };
+        unsigned submitted_ { 0 };
+
+        unsigned* cq_head_ { nullptr };
+        unsigned* cq_tail_ { nullptr };
+        unsigned cq_mask_ { 0 };
+        io_uring_cqe* cqes_ { nullptr };
+
+        std::vector<queued> backlog_ { };
+        std::vector<io_completion*> completed_ { };
+        size_t in_flight_ { 0 };
+        bool supported_[opcodes] { };
+        std::vector<iovec> buffers_ { };
+        std::unordered_map<int, unsigned> files_ { };
+    };
+
+}
+
+}
+
+#endif
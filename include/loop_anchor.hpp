@@ -0,0 +1,89 @@
+#pragma once
+
+#include "executor.hpp"
+#include "function.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+
+namespace co {
+
+namespace detail {
+
+    /*
+        Way back to a loop for work that may outlive it, like a future racing a loop timer. Copies share one block
+        with the loop. post() queues the task under the block lock and the loop clears the block under the same
+        lock when it is destroyed, so a task is either queued while the loop is alive or handed back to the caller.
+    */
+    class loop_anchor {
+        struct block {
+            explicit block(executor* target) noexcept
+                : loop(target)
+            {
+            }
+
+            std::mutex mutex { };
+            executor* loop;
+            std::atomic<size_t> refcount { 1 };
+        };
+
+    public:
+        explicit loop_anchor(executor& loop)
+            : block_(new block(&loop))
+        {
+        }
+
+        ~loop_anchor()
+        {
+            if (block_ != nullptr && block_->refcount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                delete block_;
+            }
+        }
+
+        loop_anchor(const loop_anchor& other) noexcept
+            : block_(other.block_)
+        {
+            block_->refcount.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        loop_anchor(loop_anchor&& other) noexcept
+            : block_(std::exchange(other.block_, nullptr))
+        {
+        }
+
+        loop_anchor& operator=(const loop_anchor&) = delete;
+        loop_anchor& operator=(loop_anchor&&)      = delete;
+
+        /*
+            Takes task only if the loop is still alive, returns false and leaves task alone otherwise. Can be called
+            on any thread.
+        */
+        bool post(move_only_function<void>& task)
+        {
+            std::lock_guard lock(block_->mutex);
+            if (block_->loop == nullptr) {
+                return false;
+            }
+
+            block_->loop->execute(std::move(task));
+            return true;
+        }
+
+        /*
+            Called by the loop as the first thing of its destructor.
+        */
+        void detach() noexcept
+        {
+            std::lock_guard lock(block_->mutex);
+            block_->loop = nullptr;
+        }
+
+    private:
+        block* block_;
+    };
+
+}
+
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "task_node.hpp"
+
+namespace co {
+
+/*
+    Durations counted in power of two buckets: bucket 0 holds durations under 1ns, bucket i durations from 2^(i-1)
+    up to 2^i nanoseconds. The last bucket also takes everything longer.
+*/
+struct duration_histogram {
+    static constexpr size_t buckets = 48;
+
+    std::array<uint64_t, buckets> counts { };
+
+    uint64_t count() const noexcept
+    {
+        uint64_t total = 0;
+        for (uint64_t bucket : counts) {
+            total += bucket;
+        }
+        return total;
+    }
+
+    /*
+        Upper bound of bucket that holds given fraction of durations, fraction is in (0, 1]. Zero if empty.
+    */
+    std::chrono::nanoseconds percentile(double fraction) const noexcept
+    {
+        uint64_t total = count();
+        if (total == 0) {
+            return std::chrono::nanoseconds { 0 };
+        }
+
+        double wanted      = fraction * static_cast<double>(total);
+        uint64_t seen      = 0;
+        size_t last_bucket = 0;
+
+        for (size_t bucket = 0; bucket < buckets; ++bucket) {
+            if (counts[bucket] == 0) {
+                continue;
+            }
+
+            seen += counts[bucket];
+            last_bucket = bucket;
+            if (static_cast<double>(seen) >= wanted) {
+                break;
+            }
+        }
+
+        return std::chrono::nanoseconds { int64_t { 1 } << last_bucket };
+    }
+
+    static size_t bucket_of(std::chrono::nanoseconds duration) noexcept
+    {
+        if (duration.count() <= 0) {
+            return 0;
+        }
+
+        size_t bucket = static_cast<size_t>(std::bit_width(static_cast<uint64_t>(duration.count())));
+        return bucket < buckets ? bucket : buckets - 1;
+    }
+};
+
+/*
+    Snapshot of ev_loop counters. Posted, executed and queue_depth are always counted. The rest is collected only
+    when the library is built with ENABLE_STATISTICS and stays zero otherwise. tasks_posted and tasks_executed
+    count queued tasks only, so tasks_executed never exceeds tasks_posted, timer callbacks are counted by
+    timers_executed. busy_time is time spent running queued tasks and timers, idle_time is time the loop thread
+    was parked. queue_wait is the time from post to the start of the task, timers have none. run_time covers
+    tasks and timers.
+*/
+struct loop_statistics {
+    uint64_t tasks_posted { 0 };
+    uint64_t tasks_executed { 0 };
+    uint64_t timers_executed { 0 };
+    size_t queue_depth { 0 };
+    size_t peak_queue_depth { 0 };
+    std::chrono::nanoseconds busy_time { 0 };
+    std::chrono::nanoseconds idle_time { 0 };
+    duration_histogram queue_wait { };
+    duration_histogram run_time { };
+};
+
+namespace detail {
+
+#if defined(COOPERATIVE_ENABLE_STATISTICS)
+
+    /*
+        Counters written only by the loop thread, so every update is a plain store of a relaxed atomic and any
+        thread can read them.
+    */
+    class loop_counters {
+    public:
+        static void stamp(task_node* node) noexcept
+        {
+            node->posted_at = std::chrono::steady_clock::now();
+        }
+
+        template <typename Depth>
+        void task_started(const task_node* node, Depth depth) noexcept
+        {
+            started_ = std::chrono::steady_clock::now();
+
+            add(queue_wait_[duration_histogram::bucket_of(started_ - node->posted_at)], 1);
+
+            size_t current = depth();
+            if (current > peak_depth_.load(std::memory_order_relaxed)) {
+                peak_depth_.store(current, std::memory_order_relaxed);
+            }
+        }
+
+        void timer_started() noexcept
+        {
+            started_ = std::chrono::steady_clock::now();
+        }
+
+        void task_finished() noexcept
+        {
+            std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - started_;
+
+            add(run_time_[duration_histogram::bucket_of(elapsed)], 1);
+            add(busy_ns_, static_cast<uint64_t>(elapsed.count()));
+        }
+
+        void park_started() noexcept
+        {
+            parked_ = std::chrono::steady_clock::now();
+        }
+
+        void park_finished() noexcept
+        {
+            std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - parked_;
+            add(idle_ns_, static_cast<uint64_t>(elapsed.count()));
+        }
+
+        void fill(loop_statistics& stats) const noexcept
+        {
+            stats.peak_queue_depth = peak_depth_.load(std::memory_order_relaxed);
+            stats.busy_time        = std::chrono::nanoseconds { busy_ns_.load(std::memory_order_relaxed) };
+            stats.idle_time        = std::chrono::nanoseconds { idle_ns_.load(std::memory_order_relaxed) };
+
+            for (size_t bucket = 0; bucket < duration_histogram::buckets; ++bucket) {
+                stats.queue_wait.counts[bucket] = queue_wait_[bucket].load(std::memory_order_relaxed);
+                stats.run_time.counts[bucket]   = run_time_[bucket].load(std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        static void add(std::atomic<uint64_t>& counter, uint64_t value) noexcept
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        std::chrono::steady_clock::time_point started_ { };
+        std::chrono::steady_clock::time_point parked_ { };
+        std::atomic<size_t> peak_depth_ { 0 };
+        std::atomic<uint64_t> busy_ns_ { 0 };
+        std::atomic<uint64_t> idle_ns_ { 0 };
+        std::array<std::atomic<uint64_t>, duration_histogram::buckets> queue_wait_ { };
+        std::array<std::atomic<uint64_t>, duration_histogram::buckets> run_time_ { };
+    };
+
+#else
+
+    /*
+        Stand-in when statistics are disabled, every call compiles to nothing.
+    */
+    class loop_counters {
+    public:
+        static void stamp(task_node*) noexcept
+        {
+        }
+
+        template <typename Depth>
+        void task_started(const task_node*, Depth) noexcept
+        {
+        }
+
+        void timer_started() noexcept
+        {
+        }
+
+        void task_finished() noexcept
+        {
+        }
+
+        void park_started() noexcept
+        {
+        }
+
+        void park_finished() noexcept
+        {
+        }
+
+        void fill(loop_statistics&) const noexcept
+        {
+        }
+    };
+
+#endif
+
+}
+
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <concepts>
+
+namespace co {
+
+/*
+    Hook for intrusive queues. A node can be linked into a single queue at a time.
+*/
+struct mpsc_node {
+    std::atomic<mpsc_node*> next { nullptr };
+};
+
+/*
+    Intrusive lock-free multi-producer single-consumer queue (Vyukov's algorithm). push can be called on any
+    thread and costs one atomic exchange, pop and empty can be called only on the consumer thread. The queue does
+    not own its nodes.
+*/
+template <typename Node>
+    requires std::derived_from<Node, mpsc_node>
+class mpsc_queue {
+public:
+    mpsc_queue() = default;
+
+    mpsc_queue(const mpsc_queue&)            = delete;
+    mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+    void push(Node* node) noexcept
+    {
+        link(node);
+    }
+
+    /*
+        Pushes nodes already linked through next from first to last with a single atomic exchange, consumer sees
+        them in that order.
+    */
+    void push_chain(Node* first, Node* last) noexcept
+    {
+        last->next.store(nullptr, std::memory_order_relaxed);
+        mpsc_node* prev = head_.exchange(last, std::memory_order_seq_cst);
+        prev->next.store(first, std::memory_order_release);
+    }
+
+    /*
+        Returns nullptr when queue is empty or when a producer is in the middle of a push. In the latter case
+        empty() keeps returning false until the push completes.
+    */
+    Node* pop() noexcept
+    {
+        mpsc_node* tail = tail_;
+        mpsc_node* next = tail->next.load(std::memory_order_acquire);
+
+        if (tail == &stub_) {
+            if (next == nullptr) {
+                return nullptr;
+            }
+            tail_ = next;
+            tail  = next;
+            next  = next->next.load(std::memory_order_acquire);
+        }
+
+        if (next != nullptr) {
+            tail_ = next;
+            return static_cast<Node*>(tail);
+        }
+
+        if (tail != head_.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+
+        link(&stub_);
+
+        next = tail->next.load(std::memory_order_acquire);
+        if (next != nullptr) {
+            tail_ = next;
+            return static_cast<Node*>(tail);
+        }
+
+        return nullptr;
+    }
+
+    /*
+        Sequentially consistent with push, so it can be used in a Dekker-style handshake with producers.
+    */
+    bool empty() const noexcept
+    {
+        return tail_ == &stub_ && head_.load(std::memory_order_seq_cst) == &stub_;
+    }
+
+private:
+    void link(mpsc_node* node) noexcept
+    {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        mpsc_node* prev = head_.exchange(node, std::memory_order_seq_cst);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    mpsc_node stub_ { };
+    std::atomic<mpsc_node*> head_ { &stub_ };
+    mpsc_node* tail_ { &stub_ };
+};
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+
+#include "timer_queue.hpp"
+
+namespace co {
+
+namespace detail {
+
+    /*
+        Blocks idle event loop thread on a condition variable. parked_ and the caller's queue form a Dekker-style
+        handshake: park publishes parked_ before calling idle() to re-check the queue and producers publish their
+        work before calling unpark(), so at least one of them sees the other.
+    */
+    class condition_parker {
+    public:
+        template <typename Idle>
+        void park(std::optional<timer_clock::time_point> deadline, Idle idle)
+        {
+            std::unique_lock lock(mutex_);
+
+            parked_.store(true, std::memory_order_seq_cst);
+
+            if (idle()) {
+                if (deadline) {
+                    wakeup_.wait_until(lock, *deadline, [this]() { return signalled_; });
+                } else {
+                    wakeup_.wait(lock, [this]() { return signalled_; });
+                }
+            }
+
+            signalled_ = false;
+            parked_.store(false, std::memory_order_relaxed);
+        }
+
+        void unpark()
+        {
+            if (!parked_.load(std::memory_order_seq_cst)) {
+                return;
+            }
+
+            {
+                std::unique_lock lock(mutex_);
+                signalled_ = true;
+            }
+
+            wakeup_.notify_one();
+        }
+
+    private:
+        std::atomic<bool> parked_ { false };
+        std::mutex mutex_ { };
+        std::condition_variable wakeup_ { };
+        bool signalled_ { false };
+    };
+
+}
+
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+namespace co {
+
+/*
+    Counters of a pool on the calling thread. in_use and high_water_mark count blocks allocated and not yet freed
+    on this thread, so they are skewed when blocks migrate between threads.
+*/
+struct pool_stats {
+    size_t pool_allocations { 0 };
+    size_t heap_allocations { 0 };
+    size_t in_use { 0 };
+    size_t high_water_mark { 0 };
+
+    double hit_rate() const noexcept
+    {
+        size_t total = pool_allocations + heap_allocations;
+        return total == 0 ? 0.0 : static_cast<double>(pool_allocations) / static_cast<double>(total);
+    }
+};
+
+/*
+    Thread local free lists of blocks rounded up to multiple of Granularity bytes. Each thread keeps up to
+    MaxCached blocks per size class, requests above MaxSize bytes and blocks freed over the limit go straight to
+    the global heap. A block can be freed on any thread, it is cached by the thread that frees it. Tag separates
+    pools that share parameters.
+*/
+template <typename Tag, size_t Granularity, size_t MaxSize, size_t MaxCached>
+class size_class_pool {
+public:
+    static void* allocate(size_t size)
+    {
+        thread_state& state = local_state();
+
+        if (size <= MaxSize && size != 0) {
+            size_t index = class_index(size);
+            if (free_block* block = state.free_lists[index]) {
+                state.free_lists[index] = block->next;
+                --state.cached[index];
+                ++state.stats.pool_allocations;
+                track_allocation(state);
+                return block;
+            }
+            size = class_size(index);
+        }
+
+        void* pointer = ::operator new(size);
+
+        ++state.stats.heap_allocations;
+        track_allocation(state);
+
+        return pointer;
+    }
+
+    static void deallocate(void* pointer, size_t size) noexcept
+    {
+        thread_state& state = local_state();
+
+        if (state.stats.in_use != 0) {
+            --state.stats.in_use;
+        }
+
+        if (size > MaxSize || size == 0) {
+            ::operator delete(pointer);
+            return;
+        }
+
+        size_t index = class_index(size);
+
+        if (!state.alive || state.cached[index] == MaxCached) {
+            ::operator delete(pointer);
+            return;
+        }
+
+        if (!state.registered) {
+            state.registered = true;
+            register_cleanup();
+        }
+
+        state.free_lists[index] = ::new (pointer) free_block { state.free_lists[index] };
+        ++state.cached[index];
+    }
+
+    static pool_stats stats() noexcept
+    {
+        return local_state().stats;
+    }
+
+private:
+    static_assert(Granularity >= sizeof(void*) && Granularity % alignof(void*) == 0);
+    static_assert(MaxSize % Granularity == 0);
+
+    static constexpr size_t classes = MaxSize / Granularity;
+
+    struct free_block {
+        free_block* next;
+    };
+
+    /*
+        Trivially destructible, so it stays usable while other thread local objects are being destroyed.
+    */
+    struct thread_state {
+        free_block* free_lists[classes];
+        size_t cached[classes];
+        pool_stats stats;
+        bool registered;
+        bool alive;
+    };
+
+    struct cleanup {
+        ~cleanup()
+        {
+            thread_state& state = local_state();
+
+            state.alive = false;
+
+            for (size_t index = 0; index < classes; ++index) {
+                while (free_block* block = state.free_lists[index]) {
+                    state.free_lists[index] = block->next;
+                    ::operator delete(block);
+                }
+                state.cached[index] = 0;
+            }
+        }
+    };
+
+    static void track_allocation(thread_state& state) noexcept
+    {
+        if (++state.stats.in_use > state.stats.high_water_mark) {
+            state.stats.high_water_mark = state.stats.in_use;
+        }
+    }
+
+    static size_t class_index(size_t size) noexcept
+    {
+        return (size - 1) / Granularity;
+    }
+
+    static size_t class_size(size_t index) noexcept
+    {
+        return (index + 1) * Granularity;
+    }
+
+    static thread_state& local_state() noexcept
+    {
+        thread_local thread_state state { { }, { }, { }, false, true };
+        return state;
+    }
+
+    static void register_cleanup() noexcept
+    {
+        thread_local cleanup instance;
+        (void)instance;
+    }
+};
+
+}
@@ -0,0 +1,357 @@
+#pragma once
+
+#include "error.hpp"
+#include "function.hpp"
+#include "future.hpp"
+#include "result.hpp"
+#include "tracing.hpp"
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace co {
+
+template <typename T>
+class shared_future;
+
+namespace detail {
+
+    /*
+        Consumer of a shared result: a coroutine awaiting it or a then() continuation. Nodes of awaiters live in the
+        coroutine frame, continuation nodes are allocated once per then().
+    */
+    template <typename T>
+    struct shared_future_node {
+        shared_future_node* next { nullptr };
+        void (*run)(shared_future_node* self, const con::result<T>& value) { nullptr };
+    };
+
+    template <typename T, typename Continuation>
+    class shared_continuation : public shared_future_node<T> {
+    public:
+        using output_type = std::invoke_result_t<Continuation&, const con::result<T>&>;
+
+        static void* operator new(size_t size)
+        {
+            return control_block_pool::allocate(size);
+        }
+
+        static void operator delete(void* pointer, size_t size) noexcept
+        {
+            control_block_pool::deallocate(pointer, size);
+        }
+
+        shared_continuation(Continuation continuation, promise<output_type>&& output)
+            : continuation_(std::move(continuation))
+            , output_(std::move(output))
+        {
+            this->run = &shared_continuation::invoke;
+        }
+
+    private:
+        static void invoke(shared_future_node<T>* node, const con::result<T>& value)
+        {
+            std::unique_ptr<shared_continuation> self(static_cast<shared_continuation*>(node));
+
+            detail::trace_slice slice("future.then");
+            try {
+                self->output_.set_value(self->continuation_(value));
+            } catch (...) {
+                self->output_.set_exception(std::current_exception());
+            }
+        }
+
+        Continuation continuation_;
+        promise<output_type> output_;
+    };
+
+    /*
+        Takes the result over from the input future and keeps it for every shared_future made from it. Consumers
+        are pushed on a lock-free stack, the state itself stands for the ready state, like in concurrent_async_event.
+        The input callback holds a counted reference, so the state outlives its shared futures until the result
+        arrives and the consumers added so far run. A dropped input promise resolves the input with broken promise,
+        which runs the callback as well, so the state never outlives its input.
+    */
+    template <typename T>
+    class shared_future_state {
+    public:
+        static void* operator new(size_t size)
+        {
+            return control_block_pool::allocate(size);
+        }
+
+        static void operator delete(void* pointer, size_t size) noexcept
+        {
+            control_block_pool::deallocate(pointer, size);
+        }
+
+        explicit shared_future_state(future<T>&& input) noexcept
+            : input_(std::move(input))
+        {
+        }
+
+        void start(move_only_function<void> on_input)
+        {
+            future_access::subscribe(input_, std::move(on_input));
+        }
+
+        void retain() noexcept
+        {
+            refcount_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void release() noexcept
+        {
+            if (refcount_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                delete this;
+            }
+        }
+
+        bool ready() const noexcept
+        {
+            return waiters_.load(std::memory_order_acquire) == static_cast<const void*>(this);
+        }
+
+        /*
+            Returns false if the result is already there, node is not taken and the caller runs on its own.
+        */
+        bool add(shared_future_node<T>* node) noexcept
+        {
+            void* old = waiters_.load(std::memory_order_acquire);
+            do {
+                if (old == this) {
+                    return false;
+                }
+                node->next = static_cast<shared_future_node<T>*>(old);
+            } while (!waiters_.compare_exchange_weak(old, node, std::memory_order_acq_rel, std::memory_order_acquire));
+
+            return true;
+        }
+
+        const con::result<T>& value() const noexcept
+        {
+            return value_;
+        }
+
+        void arrived()
+        {
+            value_ = future_access::take(input_);
+
+            void* old = waiters_.exchange(this, std::memory_order_acq_rel);
+
+            // stack is newest first, run consumers in the order they were added
+            shared_future_node<T>* reversed = nullptr;
+            for (shared_future_node<T>* node = static_cast<shared_future_node<T>*>(old); node != nullptr;) {
+                shared_future_node<T>* next = node->next;
+                node->next                  = reversed;
+                reversed                    = node;
+                node                        = next;
+            }
+
+            while (reversed != nullptr) {
+                shared_future_node<T>* node = std::exchange(reversed, reversed->next);
+                node->run(node, value_);
+            }
+        }
+
+    private:
+        std::atomic<size_t> refcount_ { 0 };
+        std::atomic<void*> waiters_ { nullptr };
+        future<T> input_;
+        con::result<T> value_ { };
+    };
+
+}
+
+/*
+    Copyable future for a result that several consumers wait on. Made from a future, which it takes over. Takes any
+    number of then() continuations and awaiting coroutines, all of them get the same result by const reference, it is
+    never copied per consumer. Copies share one state, copying one is a reference count increment. Consumers run on
+    the thread that resolves the promise, or on the home executor of the original future. If the promise is dropped
+    unresolved, consumers get the broken promise error. Can be used on any thread.
+
+    References given by get(), result() and co_await are valid as long as a shared_future of the same state is.
+*/
+template <typename T>
+class shared_future {
+public:
+    /*
+        Suspends only if the result is not there yet, the node lives in the awaiter, so waiting allocates nothing.
+        Yields a const reference to the value or rethrows the exception.
+    */
+    class awaiter {
+    public:
+        explicit awaiter(const shared_future& awaited)
+            : awaited_(awaited)
+        {
+            awaited_.check();
+            node_.run = &awaiter::resume;
+        }
+
+        awaiter(const awaiter&)            = delete;
+        awaiter& operator=(const awaiter&) = delete;
+
+        bool await_ready() const noexcept
+        {
+            return awaited_.state_->ready();
+        }
+
+        bool await_suspend(std::coroutine_handle<> calling) noexcept
+        {
+            node_.handle = calling;
+            return awaited_.state_->add(&node_);
+        }
+
+        template <typename U = T>
+            requires(std::is_same_v<U, void>)
+        void await_resume() const
+        {
+            awaited_.state_->value().value();
+        }
+
+        template <typename U = T>
+            requires(!std::is_same_v<U, void>)
+        const U& await_resume() const
+        {
+            return awaited_.state_->value().value();
+        }
+
+    private:
+        struct node : detail::shared_future_node<T> {
+            std::coroutine_handle<> handle { };
+        };
+
+        static void resume(detail::shared_future_node<T>* waiting, const con::result<T>&)
+        {
+            detail::trace_slice slice("coroutine.resume");
+            static_cast<node*>(waiting)->handle.resume();
+        }
+
+        shared_future awaited_;
+        node node_ { };
+    };
+
+    shared_future() noexcept = default;
+
+    shared_future(future<T>&& fut)
+    {
+        detail::future_access::check(fut);
+
+        state_ = new detail::shared_future_state<T>(std::move(fut));
+        state_->retain();
+        state_->start([keep_alive = *this]() { keep_alive.state_->arrived(); });
+    }
+
+    ~shared_future()
+    {
+        if (state_ != nullptr) {
+            state_->release();
+        }
+    }
+
+    shared_future(const shared_future& other) noexcept
+        : state_(other.state_)
+    {
+        if (state_ != nullptr) {
+            state_->retain();
+        }
+    }
+
+    shared_future(shared_future&& other) noexcept
+        : state_(std::exchange(other.state_, nullptr))
+    {
+    }
+
+    shared_future& operator=(shared_future other) noexcept
+    {
+        std::swap(state_, other.state_);
+        return *this;
+    }
+
+    bool valid() const noexcept
+    {
+        return state_ != nullptr;
+    }
+
+    bool ready() const
+    {
+        check();
+        return state_->ready();
+    }
+
+    bool has_value() const
+    {
+        return ready() && state_->value().has_value();
+    }
+
+    bool has_exception() const
+    {
+        return ready() && state_->value().has_exception();
+    }
+
+    const con::result<T>& result() const
+    {
+        if (!ready()) {
+            throw con::error("future is not ready");
+        }
+
+        return state_->value();
+    }
+
+    template <typename U = T>
+        requires(std::is_same_v<U, void>)
+    void get() const
+    {
+        result().value();
+    }
+
+    template <typename U = T>
+        requires(!std::is_same_v<U, void>)
+    const U& get() const
+    {
+        return result().value();
+    }
+
+    /*
+        Continuation is called with the shared result by const reference. It runs right away if the result is already
+        there, otherwise it is stored in the state, one allocation for the node and the output control block each.
+    */
+    template <typename Continuation>
+    future<std::invoke_result_t<Continuation&, const con::result<T>&>> then(Continuation continuation) const
+    {
+        using continuation_type = detail::shared_continuation<T, Continuation>;
+
+        check();
+
+        auto [fut, prom] = create_future_promise<typename continuation_type::output_type>();
+
+        continuation_type* node = new continuation_type(std::move(continuation), std::move(prom));
+        if (!state_->add(node)) {
+            node->run(node, state_->value());
+        }
+
+        return std::move(fut);
+    }
+
+    awaiter operator co_await() const
+    {
+        return awaiter { *this };
+    }
+
+private:
+    void check() const
+    {
+        if (state_ == nullptr) {
+            throw con::error("empty future");
+        }
+    }
+
+    detail::shared_future_state<T>* state_ { nullptr };
+};
+
+}
@@ -0,0 +1,239 @@
+#pragma once
+
+#include "coroutine.hpp"
+#include "error.hpp"
+#include "result.hpp"
+
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace co {
+
+template <typename T>
+class task;
+
+namespace detail {
+
+    /*
+        Part of task promise that does not depend on the result type. A detached frame has no owner and destroys
+        itself when the body finishes.
+    */
+    struct task_promise_base : pooled_frame {
+        struct final_awaiter {
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+
+            template <typename P>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<P> handle) noexcept
+            {
+                task_promise_base& promise = handle.promise();
+
+                if (promise.detached) {
+                    handle.destroy();
+                    return std::noop_coroutine();
+                }
+
+                return promise.continuation;
+            }
+
+            void await_resume() const noexcept
+            {
+            }
+        };
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return { };
+        }
+
+        final_awaiter final_suspend() noexcept
+        {
+            return { };
+        }
+
+        std::coroutine_handle<> continuation { std::noop_coroutine() };
+        bool detached { false };
+    };
+
+    struct task_access {
+        /*
+            Starts task on calling thread and gives up ownership of its frame. Result and exception are dropped.
+        */
+        template <typename T>
+        static void start_detached(task<T>&& work)
+        {
+            if (!work.handle_) {
+                throw con::error("empty task");
+            }
+
+            auto handle               = std::exchange(work.handle_, nullptr);
+            handle.promise().detached = true;
+            handle.resume();
+        }
+    };
+
+}
+
+/*
+    Coroutine that does not run until it is awaited or spawned on event loop. Awaiting a task starts it on the
+    awaiting thread and the awaiting coroutine is resumed right from the task's final suspend point, both by
+    symmetric transfer, so chains of co_await do not grow the stack however deep they are.
+*/
+template <typename T = void>
+class [[nodiscard]] task {
+public:
+    struct promise;
+
+    using handle_type = detail::promise_handle<promise>;
+
+    struct promise : detail::task_promise_base {
+        con::result<T> result { };
+
+        void unhandled_exception() noexcept
+        {
+            result = std::current_exception();
+        }
+
+        template <typename Frame = promise>
+        task get_return_object()
+        {
+            return task { handle_type::from_promise(static_cast<Frame&>(*this)) };
+        }
+
+        void return_value(T&& res) noexcept
+        {
+            result = std::move(res);
+        }
+
+        void return_value(const T& res) noexcept
+        {
+            result = res;
+        }
+    };
+
+    struct awaiter {
+        handle_type handle;
+
+        bool await_ready() const noexcept
+        {
+            return handle.done();
+        }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> calling) noexcept
+        {
+            handle.promise().continuation = calling;
+            return handle;
+        }
+
+        template <typename U = T>
+            requires(std::is_same_v<U, void>)
+        void await_resume()
+        {
+            handle.promise().result.value();
+        }
+
+        template <typename U = T>
+            requires(!std::is_same_v<U, void>)
+        T await_resume()
+        {
+            return std::move(handle.promise().result.value());
+        }
+    };
+
+    using promise_type = promise;
+
+    ~task()
+    {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    task()
+        : handle_(nullptr)
+    {
+    }
+
+    task(const task& other)            = delete;
+    task& operator=(const task& other) = delete;
+
+    task(task&& other) noexcept
+    {
+        std::swap(handle_, other.handle_);
+    }
+
+    task& operator=(task&& other) noexcept
+    {
+        if (this == std::addressof(other)) {
+            return *this;
+        }
+
+        std::swap(handle_, other.handle_);
+
+        return *this;
+    }
+
+    auto operator co_await() &&
+    {
+        if (!handle_) {
+            throw con::error("empty task");
+        }
+
+        return awaiter { handle_ };
+    }
+
+    bool done() const
+    {
+        if (!handle_) {
+            throw con::error("empty task");
+        }
+
+        return handle_.done();
+    }
+
+private:
+    friend struct detail::task_access;
+
+    explicit task(handle_type handle)
+        : handle_(handle)
+    {
+    }
+
+    handle_type handle_ { };
+};
+
+template <>
+struct task<void>::promise : detail::task_promise_base {
+    con::result<con::unit> result { };
+
+    void unhandled_exception() noexcept
+    {
+        result = std::current_exception();
+    }
+
+    template <typename Frame = promise>
+    task<void> get_return_object()
+    {
+        return task<void> { handle_type::from_promise(static_cast<Frame&>(*this)) };
+    }
+
+    void return_void() noexcept
+    {
+        result = con::unit { };
+    }
+};
+
+}
+
+template <typename T, typename Alloc, typename... Args>
+struct std::coroutine_traits<co::task<T>, std::allocator_arg_t, Alloc, Args...> {
+    using promise_type = co::detail::allocator_frame<
+        typename co::task<T>::promise_type,
+        std::remove_cvref_t<Alloc>,
+        std::remove_cvref_t<Args>...>;
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+#include "mpsc_queue.hpp"
+
+namespace co {
+
+namespace detail {
+
+    inline void cpu_relax() noexcept
+    {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        _mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    /*
+        Queued task. The callable lives in the same allocation as the queue hook, so posting costs one allocation.
+    */
+    class task_node : public mpsc_node {
+    public:
+        task_node(const task_node&)            = delete;
+        task_node& operator=(const task_node&) = delete;
+
+        /*
+            Runs the task and frees the node, even if the task throws.
+        */
+        void run()
+        {
+            run_(this);
+        }
+
+        void discard() noexcept
+        {
+            discard_(this);
+        }
+
+#if defined(COOPERATIVE_ENABLE_STATISTICS)
+        std::chrono::steady_clock::time_point posted_at { };
+#endif
+#if defined(COOPERATIVE_ENABLE_TRACING)
+        uint64_t trace_flow { 0 };
+#endif
+
+    protected:
+        using run_fn     = void (*)(task_node*);
+        using discard_fn = void (*)(task_node*) noexcept;
+
+        task_node(run_fn run, discard_fn discard) noexcept
+            : run_(run)
+            , discard_(discard)
+        {
+        }
+
+        ~task_node() = default;
+
+    private:
+        run_fn run_;
+        discard_fn discard_;
+    };
+
+    template <typename Function>
+    class task_node_impl final : public task_node {
+    public:
+        explicit task_node_impl(Function&& function)
+            : task_node(&run, &discard)
+            , function_(std::move(function))
+        {
+        }
+
+    private:
+        static void run(task_node* node)
+        {
+            std::unique_ptr<task_node_impl> self(static_cast<task_node_impl*>(node));
+            self->function_();
+        }
+
+        static void discard(task_node* node) noexcept
+        {
+            delete static_cast<task_node_impl*>(node);
+        }
+
+        Function function_;
+    };
+
+}
+
+}
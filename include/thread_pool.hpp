@@ -0,0 +1,302 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "executor.hpp"
+#include "function.hpp"
+#include "future.hpp"
+#include "task_node.hpp"
+#include "work_stealing_deque.hpp"
+
+namespace co {
+
+/*
+    Multi-threaded work stealing executor. Every worker owns a Chase-Lev deque: tasks posted on a worker go to its
+    own deque, tasks posted on other threads go to a shared injection queue, idle workers steal from random victims.
+    Tasks have no ordering guarantees. Exception escaping a task terminates the program, like any exception escaping
+    a thread.
+*/
+class thread_pool : public executor {
+public:
+    class schedule_awaiter {
+    public:
+        explicit schedule_awaiter(thread_pool& pool) noexcept
+            : pool_(pool)
+        {
+        }
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> calling)
+        {
+            pool_.post([calling]() { calling.resume(); });
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+
+    private:
+        thread_pool& pool_;
+    };
+
+    explicit thread_pool(size_t threads = std::thread::hardware_concurrency())
+    {
+        threads = std::max<size_t>(threads, 1);
+
+        workers_.reserve(threads);
+        for (size_t index = 0; index < threads; ++index) {
+            workers_.push_back(std::make_unique<worker>(*this, index));
+        }
+        for (std::unique_ptr<worker>& worker : workers_) {
+            worker->thread = std::thread([this, self = worker.get()]() { run(*self); });
+        }
+    }
+
+    thread_pool(const thread_pool&)            = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    /*
+        Stops and joins workers. Tasks that did not start are destroyed without running.
+    */
+    ~thread_pool() override
+    {
+        stop_.store(true, std::memory_order_seq_cst);
+
+        {
+            std::unique_lock lock(sleep_mutex_);
+            epoch_.fetch_add(1, std::memory_order_seq_cst);
+        }
+        sleep_cv_.notify_all();
+
+        for (std::unique_ptr<worker>& worker : workers_) {
+            worker->thread.join();
+        }
+
+        for (std::unique_ptr<worker>& worker : workers_) {
+            detail::task_node* task = nullptr;
+            while (worker->deque.pop(task)) {
+                task->discard();
+            }
+        }
+
+        while (detail::task_node* task = pop_injected()) {
+            task->discard();
+        }
+    }
+
+    /*
+        Put task to thread pool without ability to get result. Can be called on any thread.
+    */
+    template <typename Function>
+        requires std::invocable<Function>
+    void post(Function function)
+    {
+        detail::task_node* task = new detail::task_node_impl<Function>(std::move(function));
+
+        worker* current = current_worker();
+        if (current != nullptr && &current->pool == this) {
+            current->deque.push(task);
+        } else {
+            std::unique_lock lock(inject_mutex_);
+            task->next.store(nullptr, std::memory_order_relaxed);
+            if (inject_tail_ == nullptr) {
+                inject_head_ = task;
+            } else {
+                inject_tail_->next.store(task, std::memory_order_relaxed);
+            }
+            inject_tail_ = task;
+            inject_size_.fetch_add(1, std::memory_order_seq_cst);
+        }
+
+        notify();
+    }
+
+    void execute(move_only_function<void> task) override
+    {
+        post(std::move(task));
+    }
+
+    /*
+        Put task to thread pool and get future. Can be called on any thread. Continuations run on the worker that
+        resolves the future, unless they were attached after that.
+    */
+    template <typename Function>
+        requires std::invocable<Function>
+    future<std::invoke_result_t<Function>> invoke(Function function)
+    {
+        auto [fut, prom] = create_future_promise<std::invoke_result_t<Function>>();
+        post([function = std::move(function), prom = std::move(prom)]() mutable {
+            try {
+                prom.set_value(function());
+            } catch (...) {
+                prom.set_exception(std::current_exception());
+            }
+        });
+        return std::move(fut);
+    }
+
+    /*
+        Resumes awaiting coroutine on one of the workers.
+    */
+    schedule_awaiter schedule() noexcept
+    {
+        return schedule_awaiter { *this };
+    }
+
+    size_t size() const noexcept
+    {
+        return workers_.size();
+    }
+
+private:
+    struct worker {
+        worker(thread_pool& owner, size_t worker_index)
+            : pool(owner)
+            , random_state(static_cast<uint32_t>(worker_index) * 2654435761u + 1u)
+        {
+        }
+
+        uint32_t next_random() noexcept
+        {
+            random_state ^= random_state << 13;
+            random_state ^= random_state >> 17;
+            random_state ^= random_state << 5;
+            return random_state;
+        }
+
+        thread_pool& pool;
+        uint32_t random_state;
+        work_stealing_deque<detail::task_node*> deque { };
+        std::thread thread { };
+    };
+
+    static worker*& current_worker() noexcept
+    {
+        thread_local worker* current = nullptr;
+        return current;
+    }
+
+    void run(worker& self)
+    {
+        current_worker() = &self;
+
+        while (!stop_.load(std::memory_order_acquire)) {
+            if (detail::task_node* task = find_task(self)) {
+                task->run();
+                continue;
+            }
+
+            sleepers_.fetch_add(1, std::memory_order_seq_cst);
+            uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+
+            if (detail::task_node* task = find_task(self)) {
+                sleepers_.fetch_sub(1, std::memory_order_relaxed);
+                task->run();
+                continue;
+            }
+
+            {
+                std::unique_lock lock(sleep_mutex_);
+                sleep_cv_.wait(lock, [this, epoch]() {
+                    return stop_.load(std::memory_order_acquire) || epoch_.load(std::memory_order_seq_cst) != epoch;
+                });
+            }
+
+            sleepers_.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        current_worker() = nullptr;
+    }
+
+    detail::task_node* find_task(worker& self)
+    {
+        detail::task_node* task = nullptr;
+
+        if (self.deque.pop(task)) {
+            return task;
+        }
+
+        if (inject_size_.load(std::memory_order_seq_cst) != 0) {
+            if ((task = pop_injected()) != nullptr) {
+                return task;
+            }
+        }
+
+        size_t count = workers_.size();
+        size_t start = self.next_random() % count;
+        for (size_t offset = 0; offset < count; ++offset) {
+            worker& victim = *workers_[(start + offset) % count];
+            if (&victim != &self && victim.deque.steal(task)) {
+                return task;
+            }
+        }
+
+        return nullptr;
+    }
+
+    detail::task_node* pop_injected()
+    {
+        std::unique_lock lock(inject_mutex_);
+
+        detail::task_node* task = inject_head_;
+        if (task == nullptr) {
+            return nullptr;
+        }
+
+        inject_head_ = static_cast<detail::task_node*>(task->next.load(std::memory_order_relaxed));
+        if (inject_head_ == nullptr) {
+            inject_tail_ = nullptr;
+        }
+        inject_size_.fetch_sub(1, std::memory_order_relaxed);
+
+        return task;
+    }
+
+    /*
+        Sleeping workers announce themselves in sleepers_ before their last look for work and posters check
+        sleepers_ after publishing the task. All of these accesses are sequentially consistent, so at least one side
+        sees the other.
+    */
+    void notify()
+    {
+        if (sleepers_.load(std::memory_order_seq_cst) == 0) {
+            return;
+        }
+
+        {
+            std::unique_lock lock(sleep_mutex_);
+            epoch_.fetch_add(1, std::memory_order_seq_cst);
+        }
+        sleep_cv_.notify_one();
+    }
+
+    std::vector<std::unique_ptr<worker>> workers_ { };
+
+    std::mutex inject_mutex_ { };
+    detail::task_node* inject_head_ { nullptr };
+    detail::task_node* inject_tail_ { nullptr };
+    std::atomic<size_t> inject_size_ { 0 };
+
+    std::atomic<bool> stop_ { false };
+    std::atomic<size_t> sleepers_ { 0 };
+    std::atomic<uint64_t> epoch_ { 0 };
+    std::mutex sleep_mutex_ { };
+    std::condition_variable sleep_cv_ { };
+};
+
+}
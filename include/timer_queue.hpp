@@ -0,0 +1,256 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "function.hpp"
+
+namespace co {
+
+using timer_clock = std::chrono::steady_clock;
+
+/*
+    Handle of a scheduled timer. Stays valid after the timer fires or is cancelled, cancelling it then does nothing.
+*/
+struct timer_id {
+    uint32_t slot { 0 };
+    uint32_t generation { 0 };
+
+    bool operator==(const timer_id&) const = default;
+};
+
+/*
+    Timers ordered by deadline in a 4-ary min heap. Callbacks live in a slot table, heap entries only refer to
+    their slot and generation. Cancel frees the callback right away and leaves the heap entry behind as stale, so
+    it is O(1). Stale entries are dropped when they reach the top or, once they outnumber live timers, by
+    rebuilding the heap in O(n), which keeps cancel amortized O(1) and memory proportional to live timers. Timers
+    with equal deadlines fire in the order they were added. Not thread safe.
+*/
+class timer_queue {
+public:
+    timer_queue() = default;
+
+    timer_queue(const timer_queue&)            = delete;
+    timer_queue& operator=(const timer_queue&) = delete;
+
+    timer_id add(timer_clock::time_point deadline, move_only_function<void> task)
+    {
+        uint32_t index = allocate_slot();
+        slot& target   = slots_[index];
+
+        target.task = std::move(task);
+        target.live = true;
+
+        heap_.push_back(entry { deadline, sequence_++, index, target.generation });
+        sift_up(heap_.size() - 1);
+
+        ++live_;
+
+        return timer_id { index, target.generation };
+    }
+
+    /*
+        Returns false if timer already fired or was cancelled.
+    */
+    bool cancel(timer_id id) noexcept
+    {
+        if (id.slot >= slots_.size()) {
+            return false;
+        }
+
+        slot& target = slots_[id.slot];
+        if (!target.live || target.generation != id.generation) {
+            return false;
+        }
+
+        move_only_function<void> task = std::move(target.task);
+        release_slot(id.slot);
+        --live_;
+
+        if (heap_.size() > compaction_threshold && heap_.size() - live_ > live_) {
+            compact();
+        }
+
+        return true;
+    }
+
+    /*
+        Deadline of the earliest live timer.
+    */
+    std::optional<timer_clock::time_point> next_deadline() noexcept
+    {
+        drop_stale();
+
+        if (heap_.empty()) {
+            return std::nullopt;
+        }
+
+        return heap_.front().deadline;
+    }
+
+    /*
+        Removes the earliest timer if it is due at now and returns its callback, otherwise returns empty function.
+    */
+    move_only_function<void> pop_expired(timer_clock::time_point now) noexcept
+    {
+        drop_stale();
+
+        if (heap_.empty() || heap_.front().deadline > now) {
+            return { };
+        }
+
+        uint32_t index = heap_.front().slot;
+        pop_top();
+
+        move_only_function<void> task = std::move(slots_[index].task);
+        release_slot(index);
+        --live_;
+
+        return task;
+    }
+
+    bool empty() const noexcept
+    {
+        return live_ == 0;
+    }
+
+    size_t size() const noexcept
+    {
+        return live_;
+    }
+
+private:
+    static constexpr size_t arity                = 4;
+    static constexpr size_t compaction_threshold = 64;
+    static constexpr uint32_t no_slot            = UINT32_MAX;
+
+    struct entry {
+        timer_clock::time_point deadline;
+        uint64_t sequence;
+        uint32_t slot;
+        uint32_t generation;
+
+        bool operator<(const entry& other) const noexcept
+        {
+            return deadline < other.deadline || (deadline == other.deadline && sequence < other.sequence);
+        }
+    };
+
+    struct slot {
+        move_only_function<void> task { };
+        uint32_t generation { 0 };
+        uint32_t next_free { no_slot };
+        bool live { false };
+    };
+
+    bool stale(const entry& item) const noexcept
+    {
+        const slot& target = slots_[item.slot];
+        return !target.live || target.generation != item.generation;
+    }
+
+    uint32_t allocate_slot()
+    {
+        if (free_slot_ != no_slot) {
+            uint32_t index = free_slot_;
+            free_slot_     = slots_[index].next_free;
+            return index;
+        }
+
+        slots_.emplace_back();
+        return static_cast<uint32_t>(slots_.size() - 1);
+    }
+
+    void release_slot(uint32_t index) noexcept
+    {
+        slot& target     = slots_[index];
+        target.live      = false;
+        target.next_free = free_slot_;
+        ++target.generation;
+        free_slot_ = index;
+    }
+
+    void drop_stale() noexcept
+    {
+        while (!heap_.empty() && stale(heap_.front())) {
+            pop_top();
+        }
+    }
+
+    void pop_top() noexcept
+    {
+        heap_.front() = heap_.back();
+        heap_.pop_back();
+        if (!heap_.empty()) {
+            sift_down(0);
+        }
+    }
+
+    void compact() noexcept
+    {
+        size_t kept = 0;
+        for (size_t index = 0; index < heap_.size(); ++index) {
+            if (!stale(heap_[index])) {
+                heap_[kept++] = heap_[index];
+            }
+        }
+        heap_.resize(kept);
+
+        if (heap_.size() > 1) {
+            for (size_t index = (heap_.size() - 2) / arity + 1; index-- > 0;) {
+                sift_down(index);
+            }
+        }
+    }
+
+    void sift_up(size_t index) noexcept
+    {
+        entry item = heap_[index];
+        while (index > 0) {
+            size_t parent = (index - 1) / arity;
+            if (!(item < heap_[parent])) {
+                break;
+            }
+            heap_[index] = heap_[parent];
+            index        = parent;
+        }
+        heap_[index] = item;
+    }
+
+    void sift_down(size_t index) noexcept
+    {
+        entry item  = heap_[index];
+        size_t size = heap_.size();
+        while (true) {
+            size_t first = index * arity + 1;
+            if (first >= size) {
+                break;
+            }
+            size_t last     = first + arity < size ? first + arity : size;
+            size_t smallest = first;
+            for (size_t child = first + 1; child < last; ++child) {
+                if (heap_[child] < heap_[smallest]) {
+                    smallest = child;
+                }
+            }
+            if (!(heap_[smallest] < item)) {
+                break;
+            }
+            heap_[index] = heap_[smallest];
+            index        = smallest;
+        }
+        heap_[index] = item;
+    }
+
+    std::vector<entry> heap_ { };
+    std::vector<slot> slots_ { };
+    uint32_t free_slot_ { no_slot };
+    uint64_t sequence_ { 0 };
+    size_t live_ { 0 };
+};
+
+}
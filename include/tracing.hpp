@@ -0,0 +1,280 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#if defined(COOPERATIVE_ENABLE_TRACING)
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#endif
+
+namespace co {
+
+namespace detail {
+
+#if defined(COOPERATIVE_ENABLE_TRACING)
+
+    /*
+        One Chrome trace event. Fields are atomics, so a dump can read a ring while its thread keeps writing. An
+        event overwritten during the dump is dropped by the reader.
+    */
+    struct trace_event {
+        std::atomic<const char*> name { nullptr };
+        std::atomic<uint64_t> timestamp { 0 };
+        std::atomic<uint64_t> flow { 0 };
+        std::atomic<uint32_t> thread { 0 };
+        std::atomic<char> phase { 0 };
+    };
+
+    /*
+        Ring of the latest events of one thread. Only the owning thread writes, so recording is a few plain stores
+        without read-modify-write. Head grows by two per event and is odd while a slot is written, like a seqlock.
+        A ring outlives its thread and is handed to the next new thread, so short lived threads do not pile up
+        rings and events of exited threads stay in the dump until overwritten. Every event carries the id of the
+        thread that wrote it, so events of the old and the new owner land on their own tracks.
+    */
+    class trace_ring {
+    public:
+        static constexpr size_t capacity = 1 << 16;
+
+        /*
+            Called by the registry under its lock before the ring is handed to a new thread.
+        */
+        void assign(uint32_t thread) noexcept
+        {
+            thread_ = thread;
+        }
+
+        void record(char phase, const char* name, uint64_t flow) noexcept
+        {
+            uint64_t head     = head_.load(std::memory_order_relaxed);
+            trace_event& slot = events_[head / 2 % capacity];
+
+            // a reader that sees any of the new fields also sees the odd head
+            head_.store(head + 1, std::memory_order_relaxed);
+            slot.name.store(name, std::memory_order_release);
+            slot.timestamp.store(now(), std::memory_order_release);
+            slot.flow.store(flow, std::memory_order_release);
+            slot.thread.store(thread_, std::memory_order_release);
+            slot.phase.store(phase, std::memory_order_release);
+
+            head_.store(head + 2, std::memory_order_release);
+        }
+
+        /*
+            Appends events still in the ring to out as Chrome trace JSON objects, each followed by a comma.
+        */
+        void dump(std::string& out) const
+        {
+            uint64_t end   = head_.load(std::memory_order_acquire) & ~uint64_t { 1 };
+            uint64_t begin = end > capacity * 2 ? end - capacity * 2 : 0;
+
+            for (uint64_t position = begin; position < end; position += 2) {
+                const trace_event& slot = events_[position / 2 % capacity];
+
+                const char* name   = slot.name.load(std::memory_order_acquire);
+                uint64_t timestamp = slot.timestamp.load(std::memory_order_acquire);
+                uint64_t flow      = slot.flow.load(std::memory_order_acquire);
+                uint32_t thread    = slot.thread.load(std::memory_order_acquire);
+                char phase         = slot.phase.load(std::memory_order_acquire);
+
+                // slot was reused by the writer while being read
+                if (head_.load(std::memory_order_acquire) > position + capacity * 2) {
+                    continue;
+                }
+
+                append(out, phase, name, timestamp, flow, thread);
+            }
+        }
+
+    private:
+        static uint64_t now() noexcept
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch())
+                    .count());
+        }
+
+        static void append(
+            std::string& out, char phase, const char* name, uint64_t timestamp, uint64_t flow, uint32_t thread)
+        {
+            char line[256];
+            int length;
+
+            if (phase == 's' || phase == 'f') {
+                length = std::snprintf(line, sizeof(line),
+                    "{\"name\":\"%s\",\"cat\":\"flow\",\"ph\":\"%c\",\"bp\":\"e\",\"id\":%llu,\"ts\":%.3f,"
+                    "\"pid\":1,\"tid\":%u},\n",
+                    name, phase, static_cast<unsigned long long>(flow), static_cast<double>(timestamp) / 1000.0,
+                    thread);
+            } else {
+                length = std::snprintf(line, sizeof(line),
+                    "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u},\n", name, phase,
+                    static_cast<double>(timestamp) / 1000.0, thread);
+            }
+
+            if (length > 0) {
+                out.append(line, static_cast<size_t>(length) < sizeof(line) ? static_cast<size_t>(length) : 0);
+            }
+        }
+
+        uint32_t thread_ { 0 };
+        std::atomic<uint64_t> head_ { 0 };
+        std::array<trace_event, capacity> events_ { };
+    };
+
+    class trace_registry {
+    public:
+        static trace_registry& instance()
+        {
+            static trace_registry registry;
+            return registry;
+        }
+
+        static trace_ring& local()
+        {
+            thread_local lease current { instance().acquire() };
+            return *current.ring;
+        }
+
+        std::string dump()
+        {
+            std::string out = "{\"traceEvents\":[\n";
+
+            {
+                std::unique_lock lock(mutex_);
+                for (const std::unique_ptr<trace_ring>& ring : rings_) {
+                    ring->dump(out);
+                }
+            }
+
+            if (out.size() >= 2 && out[out.size() - 2] == ',') {
+                out.erase(out.size() - 2, 1);
+            }
+            out += "]}\n";
+
+            return out;
+        }
+
+    private:
+        struct lease {
+            trace_ring* ring;
+
+            ~lease()
+            {
+                instance().release(ring);
+            }
+        };
+
+        trace_ring* acquire()
+        {
+            std::unique_lock lock(mutex_);
+
+            trace_ring* ring;
+            if (!free_.empty()) {
+                ring = free_.back();
+                free_.pop_back();
+            } else {
+                rings_.push_back(std::make_unique<trace_ring>());
+                ring = rings_.back().get();
+            }
+
+            ring->assign(next_thread_++);
+            return ring;
+        }
+
+        void release(trace_ring* ring)
+        {
+            std::unique_lock lock(mutex_);
+            free_.push_back(ring);
+        }
+
+        std::mutex mutex_ { };
+        std::vector<std::unique_ptr<trace_ring>> rings_ { };
+        std::vector<trace_ring*> free_ { };
+        uint32_t next_thread_ { 1 };
+    };
+
+    inline uint64_t next_flow_id() noexcept
+    {
+        static std::atomic<uint64_t> next { 1 };
+        return next.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /*
+        Start of an arrow from the current point of this thread to wherever trace_slice with the same flow begins.
+    */
+    inline uint64_t trace_flow_start(const char* name) noexcept
+    {
+        uint64_t flow = next_flow_id();
+        trace_registry::local().record('s', name, flow);
+        return flow;
+    }
+
+    /*
+        Begin and end events around a scope, with the end of a flow arrow at its start if flow is not zero.
+    */
+    class trace_slice {
+    public:
+        explicit trace_slice(const char* name, uint64_t flow = 0) noexcept
+            : ring_(trace_registry::local())
+            , name_(name)
+        {
+            ring_.record('B', name_, 0);
+            if (flow != 0) {
+                ring_.record('f', name_, flow);
+            }
+        }
+
+        ~trace_slice()
+        {
+            ring_.record('E', name_, 0);
+        }
+
+        trace_slice(const trace_slice&)            = delete;
+        trace_slice& operator=(const trace_slice&) = delete;
+
+    private:
+        trace_ring& ring_;
+        const char* name_;
+    };
+
+#else
+
+    inline uint64_t trace_flow_start(const char*) noexcept
+    {
+        return 0;
+    }
+
+    class trace_slice {
+    public:
+        explicit trace_slice(const char*, uint64_t = 0) noexcept
+        {
+        }
+    };
+
+#endif
+
+}
+
+/*
+    Events recorded so far on all threads as Chrome trace event JSON, which chrome://tracing and Perfetto open.
+    Only the latest events of every thread are kept. Empty trace unless the library is built with ENABLE_TRACING.
+*/
+inline std::string chrome_trace()
+{
+#if defined(COOPERATIVE_ENABLE_TRACING)
+    return detail::trace_registry::instance().dump();
+#else
+    return "{\"traceEvents\":[]}\n";
+#endif
+}
+
+}
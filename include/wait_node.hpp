@@ -0,0 +1,74 @@
+#pragma once
+
+#include "executor.hpp"
+#include "intrusive_queue.hpp"
+#include "tracing.hpp"
+
+#include <coroutine>
+#include <mutex>
+
+namespace co {
+
+namespace detail {
+
+    /*
+        Coroutine waiting on a synchronization primitive. Lives in the awaiter inside the coroutine frame, so waiting
+        allocates nothing. Resumed on home if it is set, otherwise right on the thread that wakes it. An awaiter
+        destroyed with its coroutine while the node is still queued unlinks it, once the node is taken off the
+        queues the coroutine has to be resumed.
+    */
+    struct wait_node : intrusive_link<wait_node> {
+        std::coroutine_handle<> handle { };
+        executor* home { nullptr };
+    };
+
+    /*
+        Node may be gone once this returns, the resumed coroutine owns it.
+    */
+    inline void resume_waiter(wait_node* node)
+    {
+        std::coroutine_handle<> handle = node->handle;
+        if (node->home != nullptr) {
+            node->home->execute([handle]() {
+                detail::trace_slice slice("coroutine.resume");
+                handle.resume();
+            });
+        } else {
+            detail::trace_slice slice("coroutine.resume");
+            handle.resume();
+        }
+    }
+
+    /*
+        Resumes ready nodes one by one. They stay queued until their turn, so a resumed coroutine can still destroy
+        one that waits behind it.
+    */
+    inline void resume_waiters(intrusive_queue<wait_node>& ready)
+    {
+        while (wait_node* node = ready.pop_front()) {
+            resume_waiter(node);
+        }
+    }
+
+    /*
+        Same for a queue guarded by mutex, which is not held while a coroutine is resumed.
+    */
+    inline void resume_waiters(std::mutex& mutex, intrusive_queue<wait_node>& ready)
+    {
+        while (true) {
+            wait_node* node = nullptr;
+            {
+                std::unique_lock lock(mutex);
+                node = ready.pop_front();
+            }
+
+            if (node == nullptr) {
+                return;
+            }
+            resume_waiter(node);
+        }
+    }
+
+}
+
+}
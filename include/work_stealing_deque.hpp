@@ -0,0 +1,169 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+#if defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable : 4324) // structure was padded due to alignment specifier
+#endif
+
+namespace co {
+
+/*
+    Chase-Lev work stealing deque (Le, Pop, Cohen, Nardelli, "Correct and Efficient Work-Stealing for Weak Memory
+    Models"). The owner thread pushes and pops at the bottom, any thread can steal from the top. Buffer grows when
+    it is full, retired buffers are kept until the deque is destroyed because a stealer may still read them.
+    Sequentially consistent accesses to bottom and top replace the paper's fences, which thread sanitizer does not
+    understand, and let push take part in a Dekker-style handshake with stealers.
+*/
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+class work_stealing_deque {
+public:
+    explicit work_stealing_deque(size_t capacity = 256)
+        : buffer_(new buffer(round_up(capacity), nullptr))
+    {
+    }
+
+    work_stealing_deque(const work_stealing_deque&)            = delete;
+    work_stealing_deque& operator=(const work_stealing_deque&) = delete;
+
+    ~work_stealing_deque()
+    {
+        buffer* current = buffer_.load(std::memory_order_relaxed);
+        while (current != nullptr) {
+            buffer* previous = current->previous;
+            delete current;
+            current = previous;
+        }
+    }
+
+    /*
+        Can be called only on owner thread.
+    */
+    void push(T value)
+    {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        int64_t top    = top_.load(std::memory_order_acquire);
+        buffer* data   = buffer_.load(std::memory_order_relaxed);
+
+        if (bottom - top > static_cast<int64_t>(data->mask)) {
+            data = grow(data, top, bottom);
+        }
+
+        data->put(bottom, value);
+        bottom_.store(bottom + 1, std::memory_order_seq_cst);
+    }
+
+    /*
+        Can be called only on owner thread. Returns false if deque is empty.
+    */
+    bool pop(T& value)
+    {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        buffer* data   = buffer_.load(std::memory_order_relaxed);
+
+        bottom_.store(bottom, std::memory_order_seq_cst);
+
+        int64_t top = top_.load(std::memory_order_seq_cst);
+
+        if (top > bottom) {
+            bottom_.store(bottom + 1, std::memory_order_release);
+            return false;
+        }
+
+        value = data->get(bottom);
+
+        if (top == bottom) {
+            bool won = top_.compare_exchange_strong(
+                top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom_.store(bottom + 1, std::memory_order_release);
+            return won;
+        }
+
+        return true;
+    }
+
+    /*
+        Can be called on any thread. Returns false if deque is empty or another thread won the race.
+    */
+    bool steal(T& value)
+    {
+        int64_t top    = top_.load(std::memory_order_seq_cst);
+        int64_t bottom = bottom_.load(std::memory_order_seq_cst);
+
+        if (top >= bottom) {
+            return false;
+        }
+
+        buffer* data = buffer_.load(std::memory_order_acquire);
+        value        = data->get(top);
+
+        return top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    /*
+        Approximate when called not on owner thread.
+    */
+    bool empty() const noexcept
+    {
+        return top_.load(std::memory_order_acquire) >= bottom_.load(std::memory_order_acquire);
+    }
+
+private:
+    struct buffer {
+        buffer(size_t capacity, buffer* previous_buffer)
+            : mask(capacity - 1)
+            , slots(new std::atomic<T>[capacity])
+            , previous(previous_buffer)
+        {
+        }
+
+        T get(int64_t index) const noexcept
+        {
+            return slots[static_cast<size_t>(index) & mask].load(std::memory_order_relaxed);
+        }
+
+        void put(int64_t index, T value) noexcept
+        {
+            slots[static_cast<size_t>(index) & mask].store(value, std::memory_order_relaxed);
+        }
+
+        size_t mask;
+        std::unique_ptr<std::atomic<T>[]> slots;
+        buffer* previous;
+    };
+
+    static size_t round_up(size_t capacity) noexcept
+    {
+        size_t result = 2;
+        while (result < capacity) {
+            result *= 2;
+        }
+        return result;
+    }
+
+    buffer* grow(buffer* data, int64_t top, int64_t bottom)
+    {
+        buffer* bigger = new buffer((data->mask + 1) * 2, data);
+        for (int64_t index = top; index < bottom; ++index) {
+            bigger->put(index, data->get(index));
+        }
+        buffer_.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+    alignas(64) std::atomic<int64_t> top_ { 0 };
+    alignas(64) std::atomic<int64_t> bottom_ { 0 };
+    alignas(64) std::atomic<buffer*> buffer_;
+};
+
+}
+
+#if defined(_MSC_VER)
+#pragma warning(pop)
+#endif
@@ -0,0 +1,211 @@
+#include "unittest.hpp"
+
+#include "async_event.hpp"
+#include "coroutine.hpp"
+#include "event_loop.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+co::coroutine<void> wait_and_record(co::async_event& event, int id, std::vector<int>& order)
+{
+    co_await event.wait();
+    order.push_back(id);
+}
+
+SIMPLE_TEST(async_event_test)
+{
+    co::async_event event;
+    std::vector<int> order;
+
+    std::vector<co::coroutine<void>> coroutines;
+    for (int i = 0; i < 3; ++i) {
+        coroutines.push_back(wait_and_record(event, i, order));
+    }
+
+    ASSERT_FALSE(event.is_set());
+    ASSERT_TRUE(order.empty());
+
+    event.set();
+
+    ASSERT_TRUE(event.is_set());
+    ASSERT_EQ(order.size(), 3);
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_EQ(order[i], i);
+    }
+
+    co::coroutine<void> late = wait_and_record(event, 3, order);
+    ASSERT_TRUE(late.done());
+
+    event.reset();
+
+    co::coroutine<void> after_reset = wait_and_record(event, 4, order);
+    ASSERT_FALSE(after_reset.done());
+
+    event.set();
+    ASSERT_TRUE(after_reset.done());
+    ASSERT_EQ(order.size(), 5);
+}
+
+co::coroutine<void> wait_latch(co::async_latch& latch, bool& passed)
+{
+    co_await latch.wait();
+    passed = true;
+}
+
+SIMPLE_TEST(async_latch_test)
+{
+    co::async_latch latch(3);
+
+    bool passed                   = false;
+    co::coroutine<void> coroutine = wait_latch(latch, passed);
+
+    latch.count_down();
+    latch.count_down();
+    ASSERT_FALSE(passed);
+    ASSERT_FALSE(latch.try_wait());
+
+    latch.count_down();
+    ASSERT_TRUE(passed);
+    ASSERT_TRUE(latch.try_wait());
+
+    co::async_latch empty(0);
+    ASSERT_TRUE(empty.try_wait());
+}
+
+template <typename Event>
+co::coroutine<void> wait_and_drop(Event& event, co::coroutine<void>& other)
+{
+    co_await event.wait();
+    other = { };
+}
+
+template <typename Event>
+co::coroutine<void> wait_once(Event& event, bool& resumed)
+{
+    co_await event.wait();
+    resumed = true;
+}
+
+template <typename Event>
+void check_destroyed_waiter()
+{
+    Event event;
+    bool dropped_resumed = false;
+    bool resumed         = false;
+
+    {
+        co::coroutine<void> dropped = wait_once(event, dropped_resumed);
+    }
+    co::coroutine<void> kept = wait_once(event, resumed);
+
+    // the waiter behind the first one is destroyed by it while both are being resumed
+    co::coroutine<void> second { };
+    co::coroutine<void> first = wait_and_drop(event, second);
+    second                    = wait_once(event, dropped_resumed);
+
+    event.set();
+
+    ASSERT_TRUE(kept.done());
+    ASSERT_TRUE(first.done());
+    ASSERT_TRUE(resumed);
+    ASSERT_FALSE(dropped_resumed);
+}
+
+template <typename Latch>
+void check_destroyed_latch_waiter()
+{
+    Latch latch(1);
+    bool dropped_resumed = false;
+
+    {
+        co::coroutine<void> dropped = wait_once(latch, dropped_resumed);
+    }
+
+    latch.count_down();
+    ASSERT_TRUE(latch.try_wait());
+    ASSERT_FALSE(dropped_resumed);
+}
+
+SIMPLE_TEST(async_event_destroyed_waiter_test)
+{
+    check_destroyed_waiter<co::async_event>();
+    check_destroyed_waiter<co::concurrent_async_event>();
+    check_destroyed_latch_waiter<co::async_latch>();
+    check_destroyed_latch_waiter<co::concurrent_async_latch>();
+}
+
+co::coroutine<void> wait_on_loop(
+    co::concurrent_async_event& event, co::ev_loop& loop, std::atomic<int>& woken, std::thread::id& woken_on)
+{
+    co_await event.wait(loop);
+    woken_on = std::this_thread::get_id();
+    if (woken.fetch_add(1) + 1 == 2) {
+        loop.stop();
+    }
+}
+
+SIMPLE_TEST(concurrent_async_event_test)
+{
+    co::concurrent_async_event event;
+    co::ev_loop loop;
+
+    std::atomic<int> woken { 0 };
+    std::thread::id first;
+    std::thread::id second;
+
+    co::coroutine<void> a = wait_on_loop(event, loop, woken, first);
+    co::coroutine<void> b = wait_on_loop(event, loop, woken, second);
+
+    ASSERT_FALSE(a.done());
+    ASSERT_FALSE(b.done());
+
+    std::thread setter([&]() { event.set(); });
+
+    loop.start();
+    setter.join();
+
+    ASSERT_TRUE(a.done());
+    ASSERT_TRUE(b.done());
+    ASSERT_TRUE(first == std::this_thread::get_id());
+    ASSERT_TRUE(second == std::this_thread::get_id());
+    ASSERT_TRUE(event.is_set());
+
+    event.reset();
+    ASSERT_FALSE(event.is_set());
+}
+
+co::coroutine<void> wait_concurrent_latch(co::concurrent_async_latch& latch, std::atomic<bool>& passed)
+{
+    co_await latch.wait();
+    passed.store(true);
+}
+
+SIMPLE_TEST(concurrent_async_latch_test)
+{
+    constexpr int threads_count = 4;
+
+    co::concurrent_async_latch latch(threads_count * 100);
+    std::atomic<bool> passed { false };
+
+    co::coroutine<void> coroutine = wait_concurrent_latch(latch, passed);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threads_count; ++i) {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < 100; ++j) {
+                latch.count_down();
+            }
+        });
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_TRUE(passed.load());
+    ASSERT_TRUE(coroutine.done());
+}
+
+TEST_MAIN()
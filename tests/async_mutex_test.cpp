@@ -0,0 +1,257 @@
+#include "unittest.hpp"
+
+#include "async_event.hpp"
+#include "async_mutex.hpp"
+#include "async_semaphore.hpp"
+#include "coroutine.hpp"
+#include "event_loop.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+co::coroutine<void> hold_semaphore(co::async_semaphore& semaphore, co::async_event& done, int& inside, int& peak)
+{
+    co_await semaphore.acquire();
+
+    ++inside;
+    peak = std::max(peak, inside);
+    co_await done.wait();
+    --inside;
+
+    semaphore.release();
+}
+
+SIMPLE_TEST(async_semaphore_limit_test)
+{
+    co::async_semaphore semaphore(2);
+    co::async_event done;
+
+    int inside = 0;
+    int peak   = 0;
+
+    std::vector<co::coroutine<void>> coroutines;
+    for (int i = 0; i < 5; ++i) {
+        coroutines.push_back(hold_semaphore(semaphore, done, inside, peak));
+    }
+
+    ASSERT_EQ(inside, 2);
+    ASSERT_EQ(semaphore.available(), 0);
+    ASSERT_FALSE(semaphore.try_acquire());
+
+    done.set();
+
+    for (co::coroutine<void>& coroutine : coroutines) {
+        ASSERT_TRUE(coroutine.done());
+    }
+    ASSERT_EQ(peak, 2);
+    ASSERT_EQ(inside, 0);
+    ASSERT_EQ(semaphore.available(), 2);
+}
+
+template <typename Mutex>
+co::coroutine<void> lock_and_record(Mutex& mutex, int id, std::vector<int>& order)
+{
+    auto guard = co_await mutex.scoped_lock();
+    order.push_back(id);
+}
+
+SIMPLE_TEST(async_mutex_fifo_test)
+{
+    co::async_mutex mutex;
+    std::vector<int> order;
+
+    ASSERT_TRUE(mutex.try_lock());
+    ASSERT_TRUE(mutex.locked());
+
+    std::vector<co::coroutine<void>> coroutines;
+    for (int i = 0; i < 4; ++i) {
+        coroutines.push_back(lock_and_record(mutex, i, order));
+    }
+
+    ASSERT_TRUE(order.empty());
+
+    mutex.unlock();
+
+    ASSERT_EQ(order.size(), 4);
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_EQ(order[i], i);
+    }
+    ASSERT_FALSE(mutex.locked());
+}
+
+SIMPLE_TEST(async_mutex_handoff_test)
+{
+    co::async_mutex mutex;
+    std::vector<int> order;
+
+    ASSERT_TRUE(mutex.try_lock());
+
+    co::coroutine<void> waiter = lock_and_record(mutex, 1, order);
+
+    // unlock hands the mutex over, so try_lock after it can not overtake the waiter
+    mutex.unlock();
+
+    ASSERT_TRUE(waiter.done());
+    ASSERT_EQ(order.size(), 1);
+    ASSERT_TRUE(mutex.try_lock());
+    mutex.unlock();
+}
+
+template <typename Semaphore>
+co::coroutine<void> acquire_and_drop(Semaphore& semaphore, co::coroutine<void>& other)
+{
+    co_await semaphore.acquire();
+    other = { };
+    semaphore.release();
+}
+
+template <typename Semaphore>
+co::coroutine<void> acquire_once(Semaphore& semaphore)
+{
+    co_await semaphore.acquire();
+    semaphore.release();
+}
+
+template <typename Mutex>
+void check_destroyed_waiter()
+{
+    Mutex mutex;
+    std::vector<int> order;
+
+    ASSERT_TRUE(mutex.try_lock());
+    {
+        co::coroutine<void> dropped = lock_and_record(mutex, 0, order);
+    }
+    co::coroutine<void> kept = lock_and_record(mutex, 1, order);
+
+    // the destroyed waiter left the queue, the next one gets the mutex
+    mutex.unlock();
+
+    ASSERT_TRUE(kept.done());
+    ASSERT_EQ(order.size(), 1);
+    ASSERT_EQ(order[0], 1);
+    ASSERT_TRUE(mutex.try_lock());
+    mutex.unlock();
+}
+
+template <typename Semaphore>
+void check_waiter_destroyed_by_resumed()
+{
+    Semaphore semaphore(0);
+
+    co::coroutine<void> second { };
+    co::coroutine<void> first = acquire_and_drop(semaphore, second);
+    second                    = acquire_once(semaphore);
+
+    semaphore.release();
+
+    ASSERT_TRUE(first.done());
+    ASSERT_EQ(semaphore.available(), 1);
+}
+
+SIMPLE_TEST(async_mutex_destroyed_waiter_test)
+{
+    check_destroyed_waiter<co::async_mutex>();
+    check_destroyed_waiter<co::concurrent_async_mutex>();
+    check_waiter_destroyed_by_resumed<co::async_semaphore>();
+    check_waiter_destroyed_by_resumed<co::concurrent_async_semaphore>();
+}
+
+co::coroutine<void> increment_locked(
+    co::concurrent_async_mutex& mutex, int rounds, int& counter, co::concurrent_async_latch& finished)
+{
+    for (int i = 0; i < rounds; ++i) {
+        co_await mutex.lock();
+        ++counter;
+        mutex.unlock();
+    }
+
+    finished.count_down();
+}
+
+SIMPLE_TEST(concurrent_async_mutex_test)
+{
+    constexpr int threads_count = 4;
+    constexpr int rounds        = 5000;
+
+    co::concurrent_async_mutex mutex;
+    co::concurrent_async_latch finished(threads_count);
+
+    int counter = 0;
+
+    std::vector<co::coroutine<void>> coroutines(threads_count);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threads_count; ++i) {
+        threads.emplace_back([&, i]() { coroutines[i] = increment_locked(mutex, rounds, counter, finished); });
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    while (!finished.try_wait()) {
+        std::this_thread::yield();
+    }
+
+    ASSERT_TRUE(mutex.try_lock());
+    ASSERT_EQ(counter, threads_count * rounds);
+    mutex.unlock();
+}
+
+co::coroutine<void> limited_on_loop(co::concurrent_async_semaphore& semaphore, co::ev_loop& loop,
+    std::atomic<int>& inside, std::atomic<int>& peak, co::concurrent_async_latch& finished)
+{
+    co_await semaphore.acquire(loop);
+
+    int now = inside.fetch_add(1) + 1;
+    int old = peak.load();
+    while (old < now && !peak.compare_exchange_weak(old, now)) { }
+
+    std::this_thread::yield();
+    inside.fetch_sub(1);
+
+    semaphore.release();
+    finished.count_down();
+}
+
+SIMPLE_TEST(concurrent_async_semaphore_test)
+{
+    constexpr int threads_count = 4;
+    constexpr int per_thread    = 200;
+
+    co::concurrent_async_semaphore semaphore(3);
+    co::concurrent_async_latch finished(threads_count * per_thread);
+    co::ev_loop loop;
+
+    std::atomic<int> inside { 0 };
+    std::atomic<int> peak { 0 };
+
+    std::vector<std::vector<co::coroutine<void>>> coroutines(threads_count);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threads_count; ++i) {
+        threads.emplace_back([&, i]() {
+            for (int j = 0; j < per_thread; ++j) {
+                coroutines[i].push_back(limited_on_loop(semaphore, loop, inside, peak, finished));
+            }
+        });
+    }
+
+    std::thread stopper([&]() {
+        while (!finished.try_wait()) {
+            std::this_thread::yield();
+        }
+        loop.post([&]() { loop.stop(); });
+    });
+
+    loop.start();
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    stopper.join();
+
+    ASSERT_TRUE(peak.load() <= 3);
+    ASSERT_EQ(semaphore.available(), 3);
+}
+
+TEST_MAIN()
@@ -0,0 +1,198 @@
+#include "unittest.hpp"
+
+#include "async_event.hpp"
+#include "async_rwlock.hpp"
+#include "coroutine.hpp"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+co::coroutine<void> read(co::async_rwlock& lock, co::async_event& release, std::string& log, char name)
+{
+    co_await lock.lock_shared();
+    log += name;
+    co_await release.wait();
+    lock.unlock_shared();
+}
+
+co::coroutine<void> write(co::async_rwlock& lock, co::async_event& release, std::string& log, char name)
+{
+    co_await lock.lock();
+    log += name;
+    co_await release.wait();
+    lock.unlock();
+}
+
+SIMPLE_TEST(async_rwlock_readers_share_test)
+{
+    co::async_rwlock lock;
+    co::async_event release;
+    std::string log;
+
+    co::coroutine<void> a = read(lock, release, log, 'a');
+    co::coroutine<void> b = read(lock, release, log, 'b');
+
+    ASSERT_EQ(log, "ab");
+    ASSERT_FALSE(lock.try_lock());
+
+    release.set();
+
+    ASSERT_TRUE(a.done());
+    ASSERT_TRUE(b.done());
+    ASSERT_TRUE(lock.try_lock());
+    ASSERT_FALSE(lock.try_lock_shared());
+    lock.unlock();
+}
+
+SIMPLE_TEST(async_rwlock_no_starvation_test)
+{
+    co::async_rwlock lock;
+    co::async_event first_release;
+    co::async_event second_release;
+    co::async_event third_release;
+    std::string log;
+
+    co::coroutine<void> r1 = read(lock, first_release, log, 'r');
+
+    // a waiting writer holds back readers that come after it
+    co::coroutine<void> w1 = write(lock, second_release, log, 'W');
+    co::coroutine<void> r2 = read(lock, third_release, log, 's');
+    co::coroutine<void> w2 = write(lock, third_release, log, 'X');
+
+    ASSERT_EQ(log, "r");
+
+    first_release.set();
+    ASSERT_EQ(log, "rW");
+
+    // the unlocking writer lets the waiting reader in before the next writer
+    second_release.set();
+    ASSERT_EQ(log, "rWs");
+
+    third_release.set();
+    ASSERT_EQ(log, "rWsX");
+
+    ASSERT_TRUE(w2.done());
+    ASSERT_TRUE(lock.try_lock());
+    lock.unlock();
+}
+
+template <typename Lock>
+co::coroutine<void> read_once(Lock& lock, std::string& log, char name)
+{
+    co_await lock.lock_shared();
+    log += name;
+    lock.unlock_shared();
+}
+
+template <typename Lock>
+co::coroutine<void> write_once(Lock& lock, std::string& log, char name)
+{
+    co_await lock.lock();
+    log += name;
+    lock.unlock();
+}
+
+template <typename Lock>
+co::coroutine<void> read_and_drop(Lock& lock, co::coroutine<void>& other)
+{
+    co_await lock.lock_shared();
+    other = { };
+    lock.unlock_shared();
+}
+
+template <typename Lock>
+void check_destroyed_waiter()
+{
+    Lock lock;
+    std::string log;
+
+    // a reader held back only by a destroyed writer gets in
+    ASSERT_TRUE(lock.try_lock_shared());
+    co::coroutine<void> writer = write_once(lock, log, 'W');
+    {
+        co::coroutine<void> dropped = write_once(lock, log, 'X');
+    }
+    co::coroutine<void> reader = read_once(lock, log, 'r');
+    writer                     = { };
+
+    ASSERT_EQ(log, "r");
+    lock.unlock_shared();
+    ASSERT_TRUE(lock.try_lock());
+
+    // a reader let in by the unlock is destroyed before its turn, its shared lock goes away with it
+    co::coroutine<void> second { };
+    co::coroutine<void> first = read_and_drop(lock, second);
+    second                    = read_once(lock, log, 's');
+
+    lock.unlock();
+
+    ASSERT_TRUE(first.done());
+    ASSERT_EQ(log, "r");
+    ASSERT_TRUE(lock.try_lock());
+    lock.unlock();
+}
+
+SIMPLE_TEST(async_rwlock_destroyed_waiter_test)
+{
+    check_destroyed_waiter<co::async_rwlock>();
+    check_destroyed_waiter<co::concurrent_async_rwlock>();
+}
+
+co::coroutine<void> mixed_access(co::concurrent_async_rwlock& lock, int rounds, int& value, std::atomic<int>& readers,
+    std::atomic<bool>& broken, std::atomic<int>& finished)
+{
+    for (int i = 0; i < rounds; ++i) {
+        if (i % 4 == 0) {
+            co_await lock.lock();
+            if (readers.load() != 0) {
+                broken.store(true);
+            }
+            ++value;
+            lock.unlock();
+        } else {
+            co_await lock.lock_shared();
+            readers.fetch_add(1);
+            int seen = value;
+            if (seen != value) {
+                broken.store(true);
+            }
+            readers.fetch_sub(1);
+            lock.unlock_shared();
+        }
+    }
+
+    finished.fetch_add(1);
+}
+
+SIMPLE_TEST(concurrent_async_rwlock_test)
+{
+    constexpr int threads_count = 4;
+    constexpr int rounds        = 4000;
+
+    co::concurrent_async_rwlock lock;
+    std::atomic<int> readers { 0 };
+    std::atomic<bool> broken { false };
+    std::atomic<int> finished { 0 };
+    int value = 0;
+
+    std::vector<co::coroutine<void>> coroutines(threads_count);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threads_count; ++i) {
+        threads.emplace_back(
+            [&, i]() { coroutines[i] = mixed_access(lock, rounds, value, readers, broken, finished); });
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_EQ(finished.load(), threads_count);
+    ASSERT_FALSE(broken.load());
+    ASSERT_EQ(value, threads_count * rounds / 4);
+    ASSERT_TRUE(lock.try_lock());
+    lock.unlock();
+}
+
+TEST_MAIN()
@@ -0,0 +1,219 @@
+#include "unittest.hpp"
+
+#include "cancellation.hpp"
+#include "coroutine.hpp"
+#include "event_loop.hpp"
+#include "future.hpp"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+SIMPLE_TEST(cancellation_token_test)
+{
+    co::cancellation_token never;
+    ASSERT_FALSE(never.can_be_cancelled());
+    ASSERT_FALSE(never.cancellation_requested());
+
+    co::cancellation_source source;
+    co::cancellation_token token = source.token();
+
+    ASSERT_TRUE(token.can_be_cancelled());
+    ASSERT_FALSE(token.cancellation_requested());
+
+    int calls  = 0;
+    auto count = [&calls]() { ++calls; };
+
+    co::cancellation_registration kept(token, count);
+    {
+        co::cancellation_registration dropped(token, count);
+    }
+
+    ASSERT_TRUE(source.request_cancellation());
+    ASSERT_FALSE(source.request_cancellation());
+    ASSERT_EQ(calls, 1);
+    ASSERT_TRUE(token.cancellation_requested());
+
+    co::cancellation_registration late(token, count);
+    ASSERT_EQ(calls, 2);
+
+    try {
+        token.throw_if_cancellation_requested();
+        ASSERT_TRUE(false);
+    } catch (const co::operation_cancelled&) {
+    }
+}
+
+SIMPLE_TEST(post_cancelled_task_test)
+{
+    co::ev_loop loop;
+    co::cancellation_source source;
+
+    std::vector<int> ran;
+    loop.post(source.token(), [&]() { ran.push_back(1); });
+    loop.post([&]() { ran.push_back(2); });
+    loop.post(co::priority::low, source.token(), [&]() { ran.push_back(3); });
+    loop.post(co::priority::low, [&]() { loop.stop(); });
+
+    source.request_cancellation();
+    loop.start();
+
+    ASSERT_EQ(ran.size(), 1);
+    ASSERT_EQ(ran[0], 2);
+}
+
+SIMPLE_TEST(invoke_cancelled_test)
+{
+    co::ev_loop loop;
+    co::cancellation_source source;
+
+    bool ran = false;
+
+    co::future<int> cancelled = loop.invoke(source.token(), [&]() {
+        ran = true;
+        return 1;
+    });
+    co::future<int> kept = loop.invoke(co::cancellation_token { }, []() { return 2; });
+
+    source.request_cancellation();
+    loop.post([&]() { loop.stop(); });
+    loop.start();
+
+    ASSERT_FALSE(ran);
+    ASSERT_TRUE(cancelled.has_exception());
+    try {
+        cancelled.get();
+        ASSERT_TRUE(false);
+    } catch (const co::operation_cancelled&) {
+    }
+    ASSERT_EQ(kept.get(), 2);
+}
+
+co::coroutine<std::string> await_result(co::future<int> fut)
+{
+    try {
+        int value = co_await std::move(fut);
+        co_return std::to_string(value);
+    } catch (const co::operation_cancelled&) {
+        co_return "cancelled";
+    }
+}
+
+SIMPLE_TEST(await_cancelled_future_test)
+{
+    co::cancellation_source source;
+    auto [fut, prom] = co::create_future_promise<int>(source.token());
+
+    co::coroutine<std::string> waiter = await_result(std::move(fut));
+    ASSERT_FALSE(waiter.done());
+
+    source.request_cancellation();
+
+    ASSERT_TRUE(waiter.done());
+    ASSERT_EQ(waiter.get(), "cancelled");
+
+    // the producer sees the request and its late value is dropped
+    ASSERT_TRUE(prom.cancellation_requested());
+    prom.set_value(1);
+}
+
+SIMPLE_TEST(await_resolved_before_cancel_test)
+{
+    co::cancellation_source source;
+    auto [fut, prom] = co::create_future_promise<int>(source.token());
+
+    co::coroutine<std::string> waiter = await_result(std::move(fut));
+
+    prom.set_value(7);
+    source.request_cancellation();
+
+    ASSERT_EQ(waiter.get(), "7");
+
+    co::cancellation_source early;
+    auto [early_fut, early_prom] = co::create_future_promise<int>(early.token());
+    early.request_cancellation();
+
+    co::coroutine<std::string> never_suspends = await_result(std::move(early_fut));
+    ASSERT_EQ(never_suspends.get(), "cancelled");
+}
+
+SIMPLE_TEST(resolve_twice_after_cancel_test)
+{
+    co::cancellation_source source;
+    auto [fut, prom] = co::create_future_promise<int>(source.token());
+
+    co::coroutine<std::string> waiter = await_result(std::move(fut));
+
+    prom.set_value(1);
+    source.request_cancellation();
+
+    // the promise won the claim, so the second value is a bug of the caller
+    try {
+        prom.set_value(2);
+        ASSERT_TRUE(false);
+    } catch (const con::error&) {
+    }
+
+    ASSERT_EQ(waiter.get(), "1");
+}
+
+SIMPLE_TEST(await_cancel_race_test)
+{
+    for (int round = 0; round < 200; ++round) {
+        co::cancellation_source source;
+        auto [fut, prom] = co::create_future_promise<int>(source.token());
+
+        co::coroutine<std::string> waiter = await_result(std::move(fut));
+
+        std::thread resolver([prom = std::move(prom), round]() mutable { prom.set_value(round); });
+        std::thread canceller([&source]() { source.request_cancellation(); });
+
+        resolver.join();
+        canceller.join();
+
+        ASSERT_TRUE(waiter.done());
+        std::string result = waiter.get();
+        ASSERT_TRUE(result == "cancelled" || result == std::to_string(round));
+    }
+}
+
+co::coroutine<void> sleep_long(co::ev_loop& loop, co::cancellation_token token, bool& cancelled)
+{
+    using namespace std::chrono_literals;
+
+    try {
+        co_await loop.sleep_for(10s, std::move(token));
+    } catch (const co::operation_cancelled&) {
+        cancelled = true;
+    }
+    loop.stop();
+}
+
+SIMPLE_TEST(sleep_cancelled_test)
+{
+    using namespace std::chrono_literals;
+
+    co::ev_loop loop;
+    co::cancellation_source source;
+
+    bool cancelled = false;
+    co::coroutine<void> sleeper;
+
+    loop.post([&]() { sleeper = sleep_long(loop, source.token(), cancelled); });
+
+    std::thread canceller([&source]() {
+        std::this_thread::sleep_for(5ms);
+        source.request_cancellation();
+    });
+
+    auto started = std::chrono::steady_clock::now();
+    loop.start();
+    canceller.join();
+
+    ASSERT_TRUE(cancelled);
+    ASSERT_TRUE(sleeper.done());
+    ASSERT_TRUE(std::chrono::steady_clock::now() - started < 5s);
+}
+
+TEST_MAIN()
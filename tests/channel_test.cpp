@@ -0,0 +1,306 @@
+#include "unittest.hpp"
+
+#include "channel.hpp"
+#include "coroutine.hpp"
+#include "event_loop.hpp"
+
+#include <atomic>
+#include <optional>
+#include <thread>
+#include <vector>
+
+co::coroutine<void> produce(co::channel<int>& channel, int count, int& sent)
+{
+    for (int i = 0; i < count; ++i) {
+        bool ok = co_await channel.send(i);
+        if (!ok) {
+            co_return;
+        }
+        ++sent;
+    }
+}
+
+co::coroutine<void> consume(co::channel<int>& channel, std::vector<int>& received)
+{
+    while (true) {
+        std::optional<int> item = co_await channel.receive();
+        if (!item) {
+            co_return;
+        }
+        received.push_back(*item);
+    }
+}
+
+co::coroutine<void> consume_batches(co::channel<int>& channel, std::vector<size_t>& batches)
+{
+    std::vector<int> items;
+    while (true) {
+        size_t taken = co_await channel.receive_batch(items, 8);
+        if (taken == 0) {
+            co_return;
+        }
+        batches.push_back(taken);
+    }
+}
+
+SIMPLE_TEST(channel_backpressure_test)
+{
+    co::channel<int> channel(2);
+
+    int sent = 0;
+    co::coroutine<void> producer = produce(channel, 5, sent);
+
+    ASSERT_EQ(sent, 2);
+    ASSERT_EQ(channel.size(), 2);
+    ASSERT_FALSE(producer.done());
+
+    ASSERT_EQ(channel.try_receive().value(), 0);
+
+    ASSERT_EQ(sent, 3);
+    ASSERT_EQ(channel.size(), 2);
+
+    std::vector<int> received;
+    co::coroutine<void> consumer = consume(channel, received);
+
+    ASSERT_TRUE(producer.done());
+    ASSERT_EQ(sent, 5);
+    ASSERT_EQ(received.size(), 4);
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_EQ(received[i], i + 1);
+    }
+
+    ASSERT_FALSE(consumer.done());
+    channel.close();
+    ASSERT_TRUE(consumer.done());
+}
+
+SIMPLE_TEST(channel_close_test)
+{
+    co::channel<int> channel(1);
+
+    int sent = 0;
+    co::coroutine<void> producer = produce(channel, 3, sent);
+
+    ASSERT_EQ(sent, 1);
+
+    channel.close();
+
+    ASSERT_TRUE(producer.done());
+    ASSERT_EQ(sent, 1);
+    ASSERT_FALSE(channel.try_send(7));
+
+    std::vector<int> received;
+    co::coroutine<void> consumer = consume(channel, received);
+
+    ASSERT_TRUE(consumer.done());
+    ASSERT_EQ(received.size(), 1);
+    ASSERT_EQ(received[0], 0);
+}
+
+SIMPLE_TEST(channel_batch_test)
+{
+    co::channel<int> channel(16);
+
+    for (int i = 0; i < 12; ++i) {
+        ASSERT_TRUE(channel.try_send(int { i }));
+    }
+
+    std::vector<size_t> batches;
+    co::coroutine<void> consumer = consume_batches(channel, batches);
+
+    ASSERT_EQ(batches.size(), 2);
+    ASSERT_EQ(batches[0], 8);
+    ASSERT_EQ(batches[1], 4);
+    ASSERT_EQ(channel.size(), 0);
+
+    int sent = 0;
+    co::coroutine<void> producer = produce(channel, 1, sent);
+
+    ASSERT_TRUE(producer.done());
+    ASSERT_EQ(batches.size(), 3);
+    ASSERT_EQ(batches[2], 1);
+
+    channel.close();
+
+    ASSERT_TRUE(consumer.done());
+    ASSERT_EQ(batches.size(), 3);
+}
+
+co::coroutine<void> produce_concurrent(
+    co::concurrent_channel<int>& channel, int from, int count, std::atomic<int>& producers_left)
+{
+    for (int i = from; i < from + count; ++i) {
+        co_await channel.send(i);
+    }
+
+    if (producers_left.fetch_sub(1) == 1) {
+        channel.close();
+    }
+}
+
+co::coroutine<void> consume_concurrent(co::concurrent_channel<int>& channel, co::ev_loop& loop, long long& sum,
+    int& count, std::atomic<int>& consumers_left)
+{
+    std::vector<int> items;
+    while (true) {
+        items.clear();
+        size_t taken = co_await channel.receive_batch(items, 4, loop);
+        if (taken == 0) {
+            break;
+        }
+        for (int item : items) {
+            sum += item;
+        }
+        count += static_cast<int>(taken);
+    }
+
+    if (consumers_left.fetch_sub(1) == 1) {
+        loop.stop();
+    }
+}
+
+SIMPLE_TEST(concurrent_channel_mpmc_test)
+{
+    constexpr int producers = 3;
+    constexpr int items     = 2000;
+
+    co::concurrent_channel<int> channel(8);
+    co::ev_loop loop;
+
+    std::atomic<int> producers_left { producers };
+    std::atomic<int> consumers_left { 2 };
+
+    long long sum = 0;
+    int count     = 0;
+
+    std::vector<co::coroutine<void>> consumers;
+    loop.post([&]() {
+        consumers.push_back(consume_concurrent(channel, loop, sum, count, consumers_left));
+        consumers.push_back(consume_concurrent(channel, loop, sum, count, consumers_left));
+    });
+
+    std::vector<std::thread> threads;
+    std::vector<co::coroutine<void>> senders(producers);
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() { senders[p] = produce_concurrent(channel, p * items, items, producers_left); });
+    }
+
+    loop.start();
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    long long total = static_cast<long long>(producers) * items;
+    ASSERT_EQ(count, producers * items);
+    ASSERT_EQ(sum, total * (total - 1) / 2);
+}
+
+SIMPLE_TEST(concurrent_channel_try_test)
+{
+    co::concurrent_channel<int> channel(3);
+
+    ASSERT_EQ(channel.capacity(), 4);
+
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(channel.try_send(int { i }));
+    }
+    ASSERT_FALSE(channel.try_send(4));
+    ASSERT_EQ(channel.size(), 4);
+
+    ASSERT_EQ(channel.try_receive().value(), 0);
+
+    channel.close();
+
+    ASSERT_FALSE(channel.try_send(5));
+    ASSERT_EQ(channel.try_receive().value(), 1);
+}
+
+template <typename Channel>
+co::coroutine<void> receive_once(Channel& channel, std::optional<int>& item)
+{
+    item = co_await channel.receive();
+}
+
+template <typename Channel>
+co::coroutine<void> send_once(Channel& channel, int value, bool& sent)
+{
+    sent = co_await channel.send(value);
+}
+
+template <typename Channel>
+co::coroutine<void> receive_and_drop(Channel& channel, co::coroutine<void>& other)
+{
+    co_await channel.receive();
+    other = { };
+}
+
+template <typename Channel>
+co::coroutine<size_t> receive_none(Channel& channel, std::vector<int>& out)
+{
+    co_return co_await channel.receive_batch(out, 0);
+}
+
+template <typename Channel>
+void check_destroyed_waiters()
+{
+    Channel channel(2);
+
+    std::optional<int> dropped_item;
+    {
+        co::coroutine<void> dropped = receive_once(channel, dropped_item);
+    }
+    ASSERT_TRUE(channel.try_send(7));
+    ASSERT_FALSE(dropped_item);
+    ASSERT_EQ(channel.try_receive().value(), 7);
+
+    // a sender destroyed while the channel is full takes its value with it
+    ASSERT_TRUE(channel.try_send(1));
+    ASSERT_TRUE(channel.try_send(2));
+    bool dropped_sent = false;
+    {
+        co::coroutine<void> dropped = send_once(channel, 3, dropped_sent);
+    }
+    ASSERT_EQ(channel.try_receive().value(), 1);
+    ASSERT_EQ(channel.try_receive().value(), 2);
+    ASSERT_FALSE(channel.try_receive());
+    ASSERT_FALSE(dropped_sent);
+
+    // close wakes the first receiver, which destroys the one behind it
+    co::coroutine<void> second { };
+    co::coroutine<void> first = receive_and_drop(channel, second);
+    second                    = receive_once(channel, dropped_item);
+
+    channel.close();
+
+    ASSERT_TRUE(first.done());
+    ASSERT_FALSE(dropped_item);
+}
+
+template <typename Channel>
+void check_empty_batch()
+{
+    Channel channel(2);
+    std::vector<int> out;
+
+    co::coroutine<size_t> empty = receive_none(channel, out);
+    ASSERT_TRUE(empty.done());
+    ASSERT_EQ(empty.get(), 0);
+
+    ASSERT_TRUE(channel.try_send(1));
+    co::coroutine<size_t> filled = receive_none(channel, out);
+    ASSERT_TRUE(filled.done());
+    ASSERT_EQ(filled.get(), 0);
+    ASSERT_TRUE(out.empty());
+    ASSERT_EQ(channel.size(), 1);
+}
+
+SIMPLE_TEST(channel_destroyed_waiter_test)
+{
+    check_destroyed_waiters<co::channel<int>>();
+    check_destroyed_waiters<co::concurrent_channel<int>>();
+    check_empty_batch<co::channel<int>>();
+    check_empty_batch<co::concurrent_channel<int>>();
+}
+
+TEST_MAIN()
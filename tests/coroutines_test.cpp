@@ -1,7 +1,11 @@
 #include "coroutine.hpp"
+#include "generator.hpp"
+#include "task.hpp"
 #include "unittest.hpp"
 
+#include <cstddef>
 #include <exception>
+#include <memory>
 #include <stdexcept>
 
 inline int calls = 0;
@@ -79,4 +83,101 @@ SIMPLE_TEST(exception_test)
     }
 }
 
+SIMPLE_TEST(coroutine_frame_pool_test)
+{
+    increment_calls_1_return_1().get();
+
+    co::pool_stats before = co::coroutine_frame_pool_stats();
+
+    increment_calls_1_return_1().get();
+
+    co::pool_stats after = co::coroutine_frame_pool_stats();
+
+    ASSERT_EQ(after.pool_allocations, before.pool_allocations + 1);
+    ASSERT_EQ(after.heap_allocations, before.heap_allocations);
+    ASSERT_EQ(after.in_use, before.in_use);
+    ASSERT_TRUE(after.high_water_mark >= 1);
+    ASSERT_TRUE(after.hit_rate() > 0.0);
+}
+
+inline size_t allocated_bytes = 0;
+
+template <typename T>
+struct counting_allocator {
+    using value_type = T;
+
+    counting_allocator() = default;
+
+    template <typename U>
+    counting_allocator(const counting_allocator<U>&)
+    {
+    }
+
+    T* allocate(size_t n)
+    {
+        allocated_bytes += n * sizeof(T);
+        return std::allocator<T> { }.allocate(n);
+    }
+
+    void deallocate(T* pointer, size_t n)
+    {
+        allocated_bytes -= n * sizeof(T);
+        std::allocator<T> { }.deallocate(pointer, n);
+    }
+
+    bool operator==(const counting_allocator&) const = default;
+};
+
+co::coroutine<int> allocator_aware_coroutine(std::allocator_arg_t, counting_allocator<std::byte>, int value)
+{
+    co_return value + 1;
+}
+
+SIMPLE_TEST(coroutine_allocator_test)
+{
+    allocated_bytes = 0;
+
+    co::coroutine<int> coro = allocator_aware_coroutine(std::allocator_arg, { }, 1);
+
+    ASSERT_TRUE(allocated_bytes > 0);
+    ASSERT_EQ(coro.get(), 2);
+    ASSERT_EQ(allocated_bytes, 0);
+}
+
+co::task<int> allocator_aware_task(std::allocator_arg_t, counting_allocator<std::byte>, int value)
+{
+    co_return value * 2;
+}
+
+co::coroutine<int> await_allocator_aware_task(int value)
+{
+    co_return co_await allocator_aware_task(std::allocator_arg, { }, value);
+}
+
+co::generator<int> allocator_aware_generator(std::allocator_arg_t, counting_allocator<std::byte>, int count)
+{
+    for (int value = 0; value < count; ++value) {
+        co_yield value;
+    }
+}
+
+SIMPLE_TEST(task_and_generator_allocator_test)
+{
+    allocated_bytes = 0;
+
+    ASSERT_EQ(await_allocator_aware_task(3).get(), 6);
+    ASSERT_EQ(allocated_bytes, 0);
+
+    int sum = 0;
+    {
+        co::generator<int> values = allocator_aware_generator(std::allocator_arg, { }, 4);
+        ASSERT_TRUE(allocated_bytes > 0);
+        for (int value : values) {
+            sum += value;
+        }
+    }
+    ASSERT_EQ(sum, 6);
+    ASSERT_EQ(allocated_bytes, 0);
+}
+
 TEST_MAIN()
@@ -5,6 +5,8 @@
 #include "result.hpp"
 #include "unittest.hpp"
 
+#include <chrono>
+
 inline int iters = 0;
 
 class event_loop_awaiter {
@@ -92,4 +94,37 @@ SIMPLE_TEST(event_loop_test_2)
     ASSERT_EQ(iters, 3);
 }
 
+co::coroutine<void> sleep_twice(co::ev_loop& loop)
+{
+    using namespace std::chrono_literals;
+
+    iters++;
+    co_await loop.sleep_for(5ms);
+    iters++;
+    co_await loop.sleep_for(0ms);
+    iters++;
+    loop.stop();
+}
+
+SIMPLE_TEST(event_loop_sleep_for_test)
+{
+    using namespace std::chrono_literals;
+
+    co::ev_loop loop;
+
+    iters = 0;
+
+    co::coroutine<void> coro { };
+
+    loop.post([&]() { coro = sleep_twice(loop); });
+
+    auto begin = std::chrono::steady_clock::now();
+
+    loop.start();
+
+    ASSERT_TRUE(std::chrono::steady_clock::now() - begin >= 5ms);
+    ASSERT_EQ(iters, 3);
+    ASSERT_TRUE(coro.done());
+}
+
 TEST_MAIN()
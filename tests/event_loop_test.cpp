@@ -1,10 +1,13 @@
+#include "function.hpp"
 #include "future.hpp"
 #include "result.hpp"
 #include "unittest.hpp"
 
 #include "event_loop.hpp"
 
+#include <chrono>
 #include <thread>
+#include <vector>
 
 SIMPLE_TEST(event_loop_test_1)
 {
@@ -64,4 +67,238 @@ SIMPLE_TEST(event_loop_test_2)
     thread_2.join();
 }
 
+SIMPLE_TEST(event_loop_invoke_continuation_thread_test)
+{
+    co::ev_loop loop_1;
+    co::ev_loop loop_2;
+
+    std::thread::id loop_1_thread;
+    std::thread::id continuation_thread;
+
+    std::thread thread_2([&loop_2]() { loop_2.start(); });
+
+    loop_1.post([&]() {
+        loop_1_thread = std::this_thread::get_id();
+        for (int index = 0; index < 100; ++index) {
+            loop_1.invoke(loop_2, [index]() { return index; }).then([&](con::result<int> result) {
+                if (result.value() == 99) {
+                    continuation_thread = std::this_thread::get_id();
+                    loop_2.stop();
+                    loop_1.stop();
+                }
+                return con::unit { };
+            });
+        }
+    });
+
+    loop_1.start();
+    thread_2.join();
+
+    ASSERT_TRUE(continuation_thread == loop_1_thread);
+}
+
+SIMPLE_TEST(event_loop_parked_wakeup_test)
+{
+    co::ev_loop loop;
+
+    int iters = 0;
+
+    std::thread thread([&loop, &iters]() { loop.start(); });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    loop.post([&]() {
+        iters++;
+        loop.stop();
+    });
+
+    thread.join();
+
+    ASSERT_EQ(iters, 1);
+}
+
+SIMPLE_TEST(event_loop_spin_then_park_test)
+{
+    co::ev_loop loop(co::idle_policy { .spin_iterations = 1000 });
+
+    int iters = 0;
+
+    std::thread thread([&loop]() { loop.start(); });
+
+    for (int i = 0; i < 100; ++i) {
+        loop.post([&]() { iters++; });
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    loop.post([&]() { loop.stop(); });
+
+    thread.join();
+
+    ASSERT_EQ(iters, 100);
+}
+
+SIMPLE_TEST(event_loop_post_bulk_test)
+{
+    co::ev_loop loop;
+
+    std::vector<int> order;
+    std::vector<co::move_only_function<void>> tasks;
+
+    for (int i = 0; i < 200; ++i) {
+        tasks.push_back([&order, i]() { order.push_back(i); });
+    }
+    tasks.push_back([&]() { loop.stop(); });
+
+    std::thread producer([&]() { loop.post_bulk(tasks); });
+
+    loop.start();
+    producer.join();
+
+    ASSERT_EQ(order.size(), 200);
+    for (int i = 0; i < 200; ++i) {
+        ASSERT_EQ(order[i], i);
+    }
+}
+
+SIMPLE_TEST(event_loop_post_bulk_empty_test)
+{
+    co::ev_loop loop;
+
+    std::vector<co::move_only_function<void>> tasks;
+
+    loop.post_bulk(tasks);
+    loop.post([&]() { loop.stop(); });
+
+    loop.start();
+}
+
+SIMPLE_TEST(event_loop_stop_inside_batch_test)
+{
+    co::ev_loop loop;
+
+    int iters = 0;
+
+    loop.post([&]() { loop.stop(); });
+    loop.post([&]() { iters++; });
+
+    loop.start();
+
+    ASSERT_EQ(iters, 0);
+}
+
+SIMPLE_TEST(event_loop_priority_weights_test)
+{
+    co::ev_loop loop(co::idle_policy { }, co::lane_weights { .high = 2, .normal = 1, .low = 1 });
+
+    std::vector<char> order;
+
+    for (int i = 0; i < 4; ++i) {
+        loop.post(co::priority::low, [&]() { order.push_back('l'); });
+        loop.post(co::priority::normal, [&]() { order.push_back('n'); });
+        loop.post(co::priority::high, [&]() { order.push_back('h'); });
+    }
+    loop.post(co::priority::low, [&]() { loop.stop(); });
+
+    loop.start();
+
+    std::vector<char> expected { 'h', 'h', 'n', 'l', 'h', 'h', 'n', 'l', 'n', 'l', 'n', 'l' };
+    ASSERT_TRUE(order == expected);
+}
+
+SIMPLE_TEST(event_loop_priority_no_starvation_test)
+{
+    co::ev_loop loop;
+
+    int high_runs = 0;
+
+    co::move_only_function<void> repost;
+    repost = [&]() {
+        high_runs++;
+        loop.post(co::priority::high, [&]() { repost(); });
+    };
+
+    loop.post(co::priority::high, [&]() { repost(); });
+    loop.post(co::priority::low, [&]() { loop.stop(); });
+
+    loop.start();
+
+    ASSERT_TRUE(high_runs < 100);
+}
+
+SIMPLE_TEST(event_loop_lane_statistics_test)
+{
+    co::ev_loop loop;
+
+    std::vector<co::move_only_function<void>> tasks;
+    for (int i = 0; i < 3; ++i) {
+        tasks.push_back([]() { });
+    }
+
+    loop.post_bulk(co::priority::low, tasks);
+    loop.post(co::priority::high, []() { });
+
+    ASSERT_EQ(loop.statistics(co::priority::low).depth(), 3);
+    ASSERT_EQ(loop.statistics(co::priority::high).depth(), 1);
+    ASSERT_EQ(loop.statistics(co::priority::normal).depth(), 0);
+
+    loop.post(co::priority::low, [&]() { loop.stop(); });
+    loop.start();
+
+    co::lane_stats low = loop.statistics(co::priority::low);
+    ASSERT_EQ(low.posted, 4);
+    ASSERT_EQ(low.run, 4);
+    ASSERT_EQ(low.depth(), 0);
+    ASSERT_EQ(loop.statistics(co::priority::high).run, 1);
+}
+
+SIMPLE_TEST(event_loop_timer_test)
+{
+    using namespace std::chrono_literals;
+
+    co::ev_loop loop;
+
+    std::vector<int> fired;
+
+    loop.post([&]() {
+        loop.post_after(20ms, [&]() {
+            fired.push_back(3);
+            loop.stop();
+        });
+        loop.post_after(10ms, [&]() { fired.push_back(2); });
+        co::timer_id cancelled = loop.post_after(5ms, [&]() { fired.push_back(0); });
+        loop.post([&]() { fired.push_back(1); });
+        ASSERT_TRUE(loop.cancel(cancelled));
+    });
+
+    auto begin = std::chrono::steady_clock::now();
+
+    loop.start();
+
+    ASSERT_TRUE(std::chrono::steady_clock::now() - begin >= 20ms);
+    ASSERT_TRUE(fired == std::vector<int>({ 1, 2, 3 }));
+}
+
+SIMPLE_TEST(event_loop_timer_wakes_parked_loop_test)
+{
+    using namespace std::chrono_literals;
+
+    co::ev_loop loop;
+
+    std::vector<int> fired;
+
+    std::thread thread([&loop]() { loop.start(); });
+
+    loop.post([&]() {
+        loop.post_after(10ms, [&]() {
+            fired.push_back(1);
+            loop.stop();
+        });
+    });
+
+    thread.join();
+
+    ASSERT_TRUE(fired == std::vector<int>({ 1 }));
+}
+
 TEST_MAIN()
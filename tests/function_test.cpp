@@ -0,0 +1,89 @@
+#include "unittest.hpp"
+
+#include "function.hpp"
+
+#include <array>
+#include <memory>
+#include <string>
+
+SIMPLE_TEST(function_empty_test)
+{
+    co::move_only_function<void> function;
+
+    ASSERT_FALSE(function);
+
+    try {
+        function();
+        ASSERT_TRUE(false);
+    } catch (const std::bad_function_call&) {
+    }
+}
+
+SIMPLE_TEST(function_inline_test)
+{
+    int calls   = 0;
+    auto lambda = [&calls](int value) {
+        calls += value;
+        return calls;
+    };
+
+    static_assert(co::move_only_function<int, int>::stored_inline<decltype(lambda)>);
+
+    co::move_only_function<int, int> function = lambda;
+
+    ASSERT_TRUE(function);
+    ASSERT_EQ(function(2), 2);
+    ASSERT_EQ(function(3), 5);
+}
+
+SIMPLE_TEST(function_heap_test)
+{
+    std::array<int, 64> values { };
+    values[63] = 42;
+
+    auto lambda = [values]() { return values[63]; };
+
+    static_assert(!co::move_only_function<int>::stored_inline<decltype(lambda)>);
+    static_assert(co::basic_move_only_function<sizeof(values), int>::stored_inline<decltype(lambda)>);
+
+    co::move_only_function<int> function = lambda;
+
+    ASSERT_EQ(function(), 42);
+
+    co::move_only_function<int> moved = std::move(function);
+
+    ASSERT_FALSE(function);
+    ASSERT_EQ(moved(), 42);
+}
+
+SIMPLE_TEST(function_move_only_capture_test)
+{
+    auto pointer = std::make_shared<int>(7);
+
+    co::move_only_function<int> function = [owned = std::unique_ptr<int>(new int(7)), pointer]() {
+        return *owned + *pointer - 7;
+    };
+
+    co::move_only_function<int> other;
+    other = std::move(function);
+
+    ASSERT_FALSE(function);
+    ASSERT_EQ(other(), 7);
+    ASSERT_EQ(pointer.use_count(), 2);
+
+    other = []() { return 1; };
+
+    ASSERT_EQ(other(), 1);
+    ASSERT_EQ(pointer.use_count(), 1);
+}
+
+SIMPLE_TEST(function_forwarding_test)
+{
+    co::move_only_function<std::string, std::string&&> function = [](std::string&& str) {
+        return std::move(str) + "!";
+    };
+
+    ASSERT_EQ(function(std::string("hi")), "hi!");
+}
+
+TEST_MAIN()
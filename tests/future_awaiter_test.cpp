@@ -5,6 +5,8 @@
 #include "future.hpp"
 #include "future_awaiter.hpp"
 
+#include <vector>
+
 co::coroutine<int> test_coroutine_1(co::future<int> future)
 {
     int result = co_await co::future_awaiter<int> { std::move(future) };
@@ -71,4 +73,71 @@ SIMPLE_TEST(future_awaiter_exception_test)
     }
 }
 
+co::coroutine<int> test_coroutine_3(co::future<int> future)
+{
+    int result = co_await std::move(future);
+    co_return result + 1;
+}
+
+SIMPLE_TEST(future_co_await_pending_test)
+{
+    auto [fut, prom] = co::create_future_promise<int>();
+
+    co::pool_stats before = co::control_block_pool_stats();
+
+    co::coroutine<int> coro = test_coroutine_3(std::move(fut));
+
+    ASSERT_FALSE(coro.done());
+
+    prom.set_value(41);
+
+    co::pool_stats after = co::control_block_pool_stats();
+
+    ASSERT_TRUE(coro.done());
+    ASSERT_EQ(coro.get(), 42);
+    ASSERT_EQ(after.pool_allocations, before.pool_allocations);
+    ASSERT_EQ(after.heap_allocations, before.heap_allocations);
+}
+
+SIMPLE_TEST(future_co_await_ready_test)
+{
+    auto [fut, prom] = co::create_future_promise<int>();
+
+    prom.set_value(41);
+
+    co::coroutine<int> coro = test_coroutine_3(std::move(fut));
+
+    ASSERT_TRUE(coro.done());
+    ASSERT_EQ(coro.get(), 42);
+}
+
+class manual_executor : public co::executor {
+public:
+    void execute(co::move_only_function<void> task) override
+    {
+        tasks.push_back(std::move(task));
+    }
+
+    std::vector<co::move_only_function<void>> tasks;
+};
+
+SIMPLE_TEST(future_co_await_home_executor_test)
+{
+    manual_executor home;
+
+    auto [fut, prom] = co::create_future_promise<int>(home);
+
+    co::coroutine<int> coro = test_coroutine_3(std::move(fut));
+
+    prom.set_value(1);
+
+    ASSERT_FALSE(coro.done());
+    ASSERT_EQ(home.tasks.size(), 1);
+
+    home.tasks.front()();
+
+    ASSERT_TRUE(coro.done());
+    ASSERT_EQ(coro.get(), 2);
+}
+
 TEST_MAIN()
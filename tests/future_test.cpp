@@ -3,6 +3,13 @@
 
 #include "future.hpp"
 
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
 SIMPLE_TEST(unresolved_future_test)
 {
     auto [fut, prom] = co::create_future_promise<int>();
@@ -148,4 +155,297 @@ SIMPLE_TEST(future_unresolved_continuation_test)
     auto f2 = std::move(f).then([](con::result<int> res) { return res.value() + 1; });
 }
 
+SIMPLE_TEST(future_move_out_test)
+{
+    auto [fut, prom] = co::create_future_promise<std::unique_ptr<int>>();
+    prom.set_value(std::make_unique<int>(5));
+
+    // lvalue access gives the same object by reference
+    const std::unique_ptr<int>& first = fut.get();
+    ASSERT_EQ(&first, &fut.get());
+    ASSERT_EQ(&fut.result(), &fut.result());
+    ASSERT_EQ(*first, 5);
+
+    std::unique_ptr<int> taken = std::move(fut).get();
+    ASSERT_EQ(*taken, 5);
+
+    try {
+        fut.ready();
+        ASSERT_TRUE(false);
+    } catch (const con::error&) {
+    }
+
+    auto [fut2, prom2] = co::create_future_promise<std::unique_ptr<int>>();
+    prom2.set_value(std::make_unique<int>(6));
+
+    con::result<std::unique_ptr<int>> result = std::move(fut2).result();
+    ASSERT_EQ(*result.value(), 6);
+}
+
+SIMPLE_TEST(future_continuation_move_test)
+{
+    auto [fut, prom] = co::create_future_promise<std::unique_ptr<int>>();
+
+    co::future<std::unique_ptr<int>> doubled
+        = std::move(fut).then([](con::result<std::unique_ptr<int>>&& result) {
+              std::unique_ptr<int> value = std::move(result.value());
+              *value *= 2;
+              return value;
+          });
+
+    co::future<int> plain = std::move(doubled).then([](con::result<std::unique_ptr<int>> result) {
+        return *result.value(); //
+    });
+
+    prom.set_value(std::make_unique<int>(4));
+
+    ASSERT_EQ(plain.get(), 8);
+}
+
+SIMPLE_TEST(future_control_block_pool_test)
+{
+    {
+        auto [f, p] = co::create_future_promise<int>();
+    }
+
+    co::pool_stats before = co::control_block_pool_stats();
+
+    {
+        auto [f, p] = co::create_future_promise<int>();
+        p.set_value(1);
+        ASSERT_EQ(f.get(), 1);
+    }
+
+    co::pool_stats after = co::control_block_pool_stats();
+
+    ASSERT_EQ(after.pool_allocations, before.pool_allocations + 1);
+    ASSERT_EQ(after.heap_allocations, before.heap_allocations);
+}
+
+SIMPLE_TEST(future_cross_thread_test)
+{
+    for (int round = 0; round < 1000; ++round) {
+        auto [f, p] = co::create_future_promise<int>();
+
+        std::atomic<int> calls { 0 };
+        int seen = 0;
+
+        std::thread resolver([p = std::move(p), round]() mutable { p.set_value(round); });
+
+        auto f2 = std::move(f).then([&](con::result<int> res) {
+            seen = res.value();
+            calls.fetch_add(1);
+            return con::unit { };
+        });
+
+        resolver.join();
+
+        ASSERT_EQ(calls.load(), 1);
+        ASSERT_EQ(seen, round);
+        ASSERT_TRUE(f2.ready());
+    }
+}
+
+class manual_executor : public co::executor {
+public:
+    void execute(co::move_only_function<void> task) override
+    {
+        tasks.push_back(std::move(task));
+    }
+
+    std::vector<co::move_only_function<void>> tasks;
+};
+
+SIMPLE_TEST(future_home_executor_test)
+{
+    manual_executor home;
+
+    auto [f, p] = co::create_future_promise<int>(home);
+
+    int seen = 0;
+    auto f2  = std::move(f).then([&](con::result<int> res) { return seen = res.value(); });
+
+    p.set_value(7);
+
+    ASSERT_EQ(seen, 0);
+    ASSERT_EQ(home.tasks.size(), 1);
+    ASSERT_FALSE(f2.ready());
+
+    home.tasks.front()();
+
+    ASSERT_EQ(seen, 7);
+    ASSERT_EQ(f2.get(), 7);
+}
+
+SIMPLE_TEST(future_home_executor_dropped_test)
+{
+    manual_executor home;
+
+    co::future<int> f2;
+    {
+        auto [f, p] = co::create_future_promise<int>(home);
+        f2          = std::move(f).then([](con::result<int> res) { return res.value(); });
+        p.set_value(7);
+    }
+
+    ASSERT_EQ(home.tasks.size(), 1);
+
+    // control block is freed together with the dropped task, the continuation promise goes with it unresolved
+    home.tasks.clear();
+
+    ASSERT_TRUE(f2.has_exception());
+}
+
+SIMPLE_TEST(when_all_tuple_test)
+{
+    auto [f1, p1] = co::create_future_promise<int>();
+    auto [f2, p2] = co::create_future_promise<std::string>();
+    auto [f3, p3] = co::create_future_promise<int>();
+
+    p2.set_value("two");
+
+    auto all = co::when_all(std::move(f1), std::move(f2), std::move(f3));
+
+    ASSERT_FALSE(all.ready());
+
+    p3.set_exception(std::make_exception_ptr(con::error("three")));
+    ASSERT_FALSE(all.ready());
+
+    p1.set_value(1);
+    ASSERT_TRUE(all.ready());
+
+    auto [r1, r2, r3] = all.get();
+    ASSERT_EQ(r1.value(), 1);
+    ASSERT_TRUE(r2.value() == "two");
+    ASSERT_TRUE(r3.has_exception());
+}
+
+SIMPLE_TEST(when_all_range_test)
+{
+    std::vector<co::future<int>> futures;
+    std::vector<co::promise<int>> promises;
+
+    for (int index = 0; index < 100; ++index) {
+        auto [f, p] = co::create_future_promise<int>();
+        futures.push_back(std::move(f));
+        promises.push_back(std::move(p));
+    }
+
+    promises[10].set_value(10);
+
+    co::pool_stats before = co::control_block_pool_stats();
+
+    auto all = co::when_all(std::move(futures));
+
+    co::pool_stats after = co::control_block_pool_stats();
+
+    // one combinator state and one control block for the result
+    ASSERT_EQ(after.pool_allocations + after.heap_allocations, before.pool_allocations + before.heap_allocations + 2);
+
+    for (int index = 99; index >= 0; --index) {
+        if (index != 10) {
+            promises[static_cast<size_t>(index)].set_value(index);
+        }
+    }
+
+    ASSERT_TRUE(all.ready());
+
+    std::vector<con::result<int>> results = all.get();
+    ASSERT_EQ(results.size(), 100);
+    for (int index = 0; index < 100; ++index) {
+        ASSERT_EQ(results[static_cast<size_t>(index)].value(), index);
+    }
+
+    std::vector<co::future<int>> none;
+    ASSERT_TRUE(co::when_all(std::move(none)).get().empty());
+}
+
+SIMPLE_TEST(when_all_cross_thread_test)
+{
+    std::vector<co::future<int>> futures;
+    std::vector<std::thread> threads;
+
+    for (int index = 0; index < 8; ++index) {
+        auto [f, p] = co::create_future_promise<int>();
+        futures.push_back(std::move(f));
+        threads.emplace_back([p = std::move(p), index]() mutable { p.set_value(index); });
+    }
+
+    std::atomic<int> sum { -1 };
+    auto done = co::when_all(std::move(futures)).then([&](con::result<std::vector<con::result<int>>> results) {
+        int total = 0;
+        for (con::result<int>& result : results.value()) {
+            total += result.value();
+        }
+        sum.store(total);
+        return con::unit { };
+    });
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_EQ(sum.load(), 28);
+}
+
+SIMPLE_TEST(when_any_test)
+{
+    auto [f1, p1] = co::create_future_promise<int>();
+    auto [f2, p2] = co::create_future_promise<int>();
+    auto [f3, p3] = co::create_future_promise<int>();
+
+    auto any = co::when_any(std::move(f1), std::move(f2), std::move(f3));
+
+    ASSERT_FALSE(any.ready());
+
+    p2.set_value(2);
+    ASSERT_TRUE(any.ready());
+
+    p1.set_value(1);
+    p3.set_value(3);
+
+    co::when_any_result<int> first = any.get();
+    ASSERT_EQ(first.index, 1);
+    ASSERT_EQ(first.result.value(), 2);
+
+    std::vector<co::future<int>> none;
+    ASSERT_TRUE(co::when_any(std::move(none)).has_exception());
+}
+
+SIMPLE_TEST(when_any_promise_dropped_test)
+{
+    co::future<co::when_any_result<int>> any;
+    {
+        auto [f1, p1] = co::create_future_promise<int>();
+        auto [f2, p2] = co::create_future_promise<int>();
+
+        any = co::when_any(std::move(f1), std::move(f2));
+        p2.set_value(2);
+
+        // p1 is dropped unresolved, its broken promise is the last arrival and frees the state
+    }
+
+    co::when_any_result<int> first = any.get();
+    ASSERT_EQ(first.index, 1);
+    ASSERT_EQ(first.result.value(), 2);
+}
+
+SIMPLE_TEST(when_all_promise_dropped_test)
+{
+    std::vector<co::future<int>> futures;
+    {
+        auto [f1, p1] = co::create_future_promise<int>();
+        auto [f2, p2] = co::create_future_promise<int>();
+        futures.push_back(std::move(f1));
+        futures.push_back(std::move(f2));
+        p1.set_value(1);
+    }
+
+    auto all = co::when_all(std::move(futures));
+
+    ASSERT_TRUE(all.ready());
+    ASSERT_EQ(all.get()[0].value(), 1);
+    ASSERT_TRUE(all.get()[1].has_exception());
+}
+
 TEST_MAIN()
@@ -0,0 +1,343 @@
+#include "unittest.hpp"
+
+#include "async_event.hpp"
+#include "async_generator.hpp"
+#include "coroutine.hpp"
+#include "generator.hpp"
+#include "task.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+co::generator<int> iota(int count)
+{
+    for (int i = 0; i < count; ++i) {
+        co_yield i;
+    }
+}
+
+SIMPLE_TEST(generator_iterate_test)
+{
+    std::vector<int> values;
+    for (int value : iota(5)) {
+        values.push_back(value);
+    }
+
+    ASSERT_EQ(values.size(), 5);
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_EQ(values[i], i);
+    }
+
+    int count = 0;
+    for (int value : iota(0)) {
+        count += value + 1;
+    }
+    ASSERT_EQ(count, 0);
+}
+
+struct copy_counter {
+    static inline int copies = 0;
+
+    int value;
+
+    explicit copy_counter(int v)
+        : value(v)
+    {
+    }
+
+    copy_counter(const copy_counter& other)
+        : value(other.value)
+    {
+        ++copies;
+    }
+
+    copy_counter& operator=(const copy_counter& other)
+    {
+        value = other.value;
+        ++copies;
+        return *this;
+    }
+};
+
+co::generator<const copy_counter&> counters(int count)
+{
+    copy_counter current { 0 };
+    for (int i = 0; i < count; ++i) {
+        current.value = i;
+        co_yield current;
+    }
+}
+
+SIMPLE_TEST(generator_no_copy_test)
+{
+    copy_counter::copies = 0;
+
+    int sum = 0;
+    for (const copy_counter& counter : counters(100)) {
+        sum += counter.value;
+    }
+
+    ASSERT_EQ(sum, 4950);
+    ASSERT_EQ(copy_counter::copies, 0);
+}
+
+co::generator<std::string> constants()
+{
+    const std::string greeting = "hello";
+    co_yield greeting;
+    co_yield greeting;
+}
+
+co::generator<copy_counter> const_counters(int count)
+{
+    for (int i = 0; i < count; ++i) {
+        const copy_counter current { i };
+        co_yield current;
+    }
+}
+
+SIMPLE_TEST(generator_const_lvalue_test)
+{
+    // a value generator hands out mutable references, a const lvalue is copied for that
+    std::vector<std::string> seen;
+    for (std::string& value : constants()) {
+        value += "!";
+        seen.push_back(value);
+    }
+
+    ASSERT_EQ(seen.size(), 2);
+    ASSERT_EQ(seen[0], "hello!");
+    ASSERT_EQ(seen[1], "hello!");
+
+    copy_counter::copies = 0;
+
+    int sum = 0;
+    for (const copy_counter& counter : const_counters(10)) {
+        sum += counter.value;
+    }
+
+    ASSERT_EQ(sum, 45);
+    ASSERT_EQ(copy_counter::copies, 10);
+}
+
+co::generator<std::string> throwing(bool& cleaned)
+{
+    struct cleanup {
+        bool& flag;
+
+        ~cleanup()
+        {
+            flag = true;
+        }
+    } guard { cleaned };
+
+    co_yield "first";
+    throw std::runtime_error("broken stream");
+}
+
+SIMPLE_TEST(generator_exception_test)
+{
+    bool cleaned = false;
+
+    std::vector<std::string> seen;
+    try {
+        for (const std::string& value : throwing(cleaned)) {
+            seen.push_back(value);
+        }
+        ASSERT_TRUE(false);
+    } catch (const std::runtime_error& ex) {
+        ASSERT_EQ(std::string(ex.what()), "broken stream");
+    }
+
+    ASSERT_EQ(seen.size(), 1);
+    ASSERT_TRUE(cleaned);
+}
+
+SIMPLE_TEST(generator_early_exit_test)
+{
+    bool cleaned = false;
+
+    {
+        co::generator<std::string> stream = throwing(cleaned);
+        for (const std::string& value : stream) {
+            ASSERT_EQ(value, "first");
+            break;
+        }
+        ASSERT_FALSE(cleaned);
+    }
+
+    ASSERT_TRUE(cleaned);
+}
+
+SIMPLE_TEST(generator_frame_pool_test)
+{
+    for (int value : iota(1)) {
+        (void)value;
+    }
+
+    co::pool_stats before = co::coroutine_frame_pool_stats();
+
+    for (int i = 0; i < 10; ++i) {
+        for (int value : iota(3)) {
+            (void)value;
+        }
+    }
+
+    co::pool_stats after = co::coroutine_frame_pool_stats();
+
+    ASSERT_EQ(after.pool_allocations, before.pool_allocations + 10);
+    ASSERT_EQ(after.heap_allocations, before.heap_allocations);
+    ASSERT_EQ(after.in_use, before.in_use);
+}
+
+co::task<int> fetch_page_size(int page)
+{
+    co_return page * 10;
+}
+
+co::async_generator<int> pages(co::async_event& ready, int count)
+{
+    for (int page = 0; page < count; ++page) {
+        if (page == 2) {
+            co_await ready.wait();
+        }
+
+        int size = co_await fetch_page_size(page);
+        co_yield size;
+    }
+}
+
+co::coroutine<void> consume_with_next(co::async_generator<int>& stream, std::vector<int>& out)
+{
+    while (int* size = co_await stream.next()) {
+        out.push_back(*size);
+    }
+}
+
+SIMPLE_TEST(async_generator_next_test)
+{
+    co::async_event ready;
+    co::async_generator<int> stream = pages(ready, 4);
+
+    std::vector<int> sizes;
+    co::coroutine<void> consumer = consume_with_next(stream, sizes);
+
+    ASSERT_FALSE(consumer.done());
+    ASSERT_EQ(sizes.size(), 2);
+
+    ready.set();
+
+    ASSERT_TRUE(consumer.done());
+    ASSERT_EQ(sizes.size(), 4);
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_EQ(sizes[i], i * 10);
+    }
+}
+
+co::coroutine<int> consume_with_iterator(co::async_generator<int> stream)
+{
+    int sum = 0;
+    for (auto it = co_await stream.begin(); it != stream.end(); co_await ++it) {
+        sum += *it;
+    }
+    co_return sum;
+}
+
+SIMPLE_TEST(async_generator_iterator_test)
+{
+    co::async_event ready { true };
+
+    co::coroutine<int> consumer = consume_with_iterator(pages(ready, 5));
+
+    ASSERT_TRUE(consumer.done());
+    ASSERT_EQ(consumer.get(), 100);
+}
+
+co::async_generator<std::string> async_constants(co::async_event& ready)
+{
+    const std::string greeting = "hello";
+    co_yield greeting;
+    co_await ready.wait();
+    co_yield greeting;
+}
+
+co::coroutine<void> consume_constants(co::async_generator<std::string>& stream, std::vector<std::string>& out)
+{
+    while (std::string* value = co_await stream.next()) {
+        *value += "!";
+        out.push_back(*value);
+    }
+}
+
+SIMPLE_TEST(async_generator_const_lvalue_test)
+{
+    co::async_event ready;
+    co::async_generator<std::string> stream = async_constants(ready);
+
+    std::vector<std::string> seen;
+    co::coroutine<void> consumer = consume_constants(stream, seen);
+
+    ASSERT_EQ(seen.size(), 1);
+    ready.set();
+
+    ASSERT_TRUE(consumer.done());
+    ASSERT_EQ(seen.size(), 2);
+    ASSERT_EQ(seen[0], "hello!");
+    ASSERT_EQ(seen[1], "hello!");
+}
+
+co::async_generator<const copy_counter&> async_counters(int count)
+{
+    copy_counter current { 0 };
+    for (int i = 0; i < count; ++i) {
+        current.value = i;
+        co_yield current;
+    }
+}
+
+co::async_generator<int> failing_after(int count)
+{
+    for (int i = 0; i < count; ++i) {
+        co_yield i;
+    }
+    throw std::runtime_error("page missing");
+}
+
+co::coroutine<void> consume_counters(int& sum)
+{
+    co::async_generator<const copy_counter&> stream = async_counters(100);
+    while (const copy_counter* counter = co_await stream.next()) {
+        sum += counter->value;
+    }
+}
+
+co::coroutine<std::string> consume_failing(int& seen)
+{
+    co::async_generator<int> stream = failing_after(2);
+    try {
+        while (co_await stream.next() != nullptr) {
+            ++seen;
+        }
+    } catch (const std::runtime_error& ex) {
+        co_return ex.what();
+    }
+    co_return "";
+}
+
+SIMPLE_TEST(async_generator_no_copy_and_exception_test)
+{
+    copy_counter::copies = 0;
+
+    int sum = 0;
+    consume_counters(sum).get();
+
+    ASSERT_EQ(sum, 4950);
+    ASSERT_EQ(copy_counter::copies, 0);
+
+    int seen = 0;
+    ASSERT_EQ(consume_failing(seen).get(), "page missing");
+    ASSERT_EQ(seen, 2);
+}
+
+TEST_MAIN()
@@ -0,0 +1,232 @@
+#include "coroutine.hpp"
+#include "event_loop.hpp"
+#include "unittest.hpp"
+
+#if defined(COOPERATIVE_HAS_EPOLL)
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+inline std::span<const std::byte> bytes(const char* text)
+{
+    return std::as_bytes(std::span(text, std::strlen(text)));
+}
+
+inline std::string text(std::span<const std::byte> data)
+{
+    return std::string(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+struct temporary_file {
+    temporary_file()
+    {
+        char path[] = "/tmp/cooperative-io-XXXXXX";
+        fd          = ::mkstemp(path);
+        ASSERT_TRUE(fd >= 0);
+        ::unlink(path);
+    }
+
+    ~temporary_file()
+    {
+        ::close(fd);
+    }
+
+    int fd;
+};
+
+co::coroutine<void> write_then_read(co::ev_loop& loop, int fd, std::string& result)
+{
+    int written = co_await loop.write(fd, bytes("hello, io"), 0);
+    ASSERT_EQ(written, 9);
+
+    std::byte buffer[16];
+    int count = co_await loop.read(fd, buffer, 7);
+    ASSERT_EQ(count, 2);
+    result = text(std::span(buffer, static_cast<size_t>(count)));
+
+    char first[5];
+    char second[4];
+    iovec buffers[2] { { first, sizeof(first) }, { second, sizeof(second) } };
+    count = co_await loop.readv(fd, buffers, 0);
+    ASSERT_EQ(count, 9);
+    result += std::string(first, sizeof(first)) + std::string(second, sizeof(second));
+
+    loop.stop();
+}
+
+SIMPLE_TEST(io_operation_file_test)
+{
+    co::ev_loop loop;
+    temporary_file file;
+    std::string result;
+
+    co::coroutine<void> coro { };
+    loop.post([&]() { coro = write_then_read(loop, file.fd, result); });
+
+    loop.start();
+
+    ASSERT_TRUE(coro.done());
+    ASSERT_TRUE(result == "iohello, io");
+}
+
+co::coroutine<void> registered_read(co::ev_loop& loop, int fd, std::byte* storage, std::string& result)
+{
+    int written = co_await loop.write(fd, std::span<const std::byte>(storage, 4), 0);
+    ASSERT_EQ(written, 4);
+
+    int count = co_await loop.read(fd, std::span(storage + 8, 4), 0);
+    ASSERT_EQ(count, 4);
+    result = text(std::span(storage + 8, 4));
+
+    loop.stop();
+}
+
+SIMPLE_TEST(io_operation_registered_test)
+{
+    co::ev_loop loop;
+    temporary_file file;
+    std::string result;
+
+    std::byte storage[64] { };
+    std::memcpy(storage, "data", 4);
+
+    iovec buffer { storage, sizeof(storage) };
+    int fds[] { file.fd };
+    bool registered = loop.register_buffers(std::span(&buffer, 1)) && loop.register_files(fds);
+
+#if defined(COOPERATIVE_HAS_IO_URING)
+    (void)registered;
+#else
+    ASSERT_FALSE(registered);
+#endif
+
+    co::coroutine<void> coro { };
+    loop.post([&]() { coro = registered_read(loop, file.fd, storage, result); });
+
+    loop.start();
+
+    ASSERT_TRUE(coro.done());
+    ASSERT_TRUE(result == "data");
+}
+
+co::coroutine<void> serve_once(co::ev_loop& loop, int listener, std::string& received)
+{
+    int client = co_await loop.accept(listener);
+    ASSERT_TRUE(client >= 0);
+
+    std::byte buffer[16];
+    int count = co_await loop.recv(client, buffer);
+    ASSERT_TRUE(count > 0);
+    received = text(std::span(buffer, static_cast<size_t>(count)));
+
+    int sent = co_await loop.send(client, bytes("pong"));
+    ASSERT_EQ(sent, 4);
+
+    loop.deregister(client);
+    ::close(client);
+    loop.stop();
+}
+
+SIMPLE_TEST(io_operation_socket_test)
+{
+    co::ev_loop loop;
+    std::string received;
+
+    int listener = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    ASSERT_TRUE(listener >= 0);
+
+    sockaddr_in address { };
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+    ASSERT_EQ(::listen(listener, 1), 0);
+
+    socklen_t length = sizeof(address);
+    ASSERT_EQ(::getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length), 0);
+
+    std::string reply;
+    std::thread client([&]() {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        ASSERT_EQ(::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+        ASSERT_EQ(::send(fd, "ping", 4, MSG_NOSIGNAL), 4);
+        char buffer[4];
+        ASSERT_EQ(::recv(fd, buffer, sizeof(buffer), MSG_WAITALL), 4);
+        reply.assign(buffer, sizeof(buffer));
+        ::close(fd);
+    });
+
+    co::coroutine<void> coro { };
+    loop.post([&]() { coro = serve_once(loop, listener, received); });
+
+    loop.start();
+    client.join();
+
+    ASSERT_TRUE(coro.done());
+    ASSERT_TRUE(received == "ping");
+    ASSERT_TRUE(reply == "pong");
+
+    loop.deregister(listener);
+    ::close(listener);
+}
+
+co::coroutine<void> receive(co::ev_loop& loop, int fd, bool& resumed)
+{
+    std::byte buffer[4];
+    co_await loop.recv(fd, buffer);
+    resumed = true;
+}
+
+SIMPLE_TEST(io_operation_destroyed_waiter_test)
+{
+    using namespace std::chrono_literals;
+
+    co::ev_loop loop;
+    bool resumed = false;
+
+    int fds[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+
+    loop.post([&]() {
+        {
+            co::coroutine<void> dropped = receive(loop, fds[0], resumed);
+        }
+
+        // more requests than the submission ring holds, some still queued when their coroutines go away
+        {
+            std::vector<co::coroutine<void>> dropped;
+            for (int i = 0; i < 300; ++i) {
+                dropped.push_back(receive(loop, fds[0], resumed));
+            }
+        }
+
+        ASSERT_EQ(::send(fds[1], "ping", 4, MSG_NOSIGNAL), 4);
+        loop.post_after(1ms, [&]() { loop.stop(); });
+    });
+
+    loop.start();
+
+    ASSERT_FALSE(resumed);
+
+    // cancelled receives took nothing
+    char buffer[8];
+    ASSERT_EQ(::recv(fds[0], buffer, sizeof(buffer), 0), 4);
+
+    loop.deregister(fds[0]);
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+#endif
+
+TEST_MAIN()
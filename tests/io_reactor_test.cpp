@@ -0,0 +1,256 @@
+#include "coroutine.hpp"
+#include "event_loop.hpp"
+#include "unittest.hpp"
+
+#if defined(COOPERATIVE_HAS_EPOLL)
+
+#include <cerrno>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+
+struct nonblocking_pipe {
+    nonblocking_pipe()
+    {
+        int fds[2];
+        ASSERT_EQ(::pipe2(fds, O_NONBLOCK | O_CLOEXEC), 0);
+        read_fd  = fds[0];
+        write_fd = fds[1];
+    }
+
+    ~nonblocking_pipe()
+    {
+        ::close(read_fd);
+        ::close(write_fd);
+    }
+
+    int read_fd;
+    int write_fd;
+};
+
+co::coroutine<void> read_until_eof(co::ev_loop& loop, int fd, std::string& received)
+{
+    char buffer[16];
+
+    while (true) {
+        ssize_t count = ::read(fd, buffer, sizeof(buffer));
+        if (count > 0) {
+            received.append(buffer, static_cast<size_t>(count));
+            continue;
+        }
+        if (count < 0 && errno == EAGAIN) {
+            co_await loop.readable(fd);
+            continue;
+        }
+        break;
+    }
+
+    loop.stop();
+}
+
+SIMPLE_TEST(io_reactor_read_pipe_test)
+{
+    co::ev_loop loop;
+    nonblocking_pipe pipe;
+    std::string received;
+
+    co::coroutine<void> coro { };
+    loop.post([&]() { coro = read_until_eof(loop, pipe.read_fd, received); });
+
+    std::thread writer([&]() {
+        std::this_thread::sleep_for(5ms);
+        ASSERT_EQ(::write(pipe.write_fd, "hello ", 6), 6);
+        std::this_thread::sleep_for(5ms);
+        ASSERT_EQ(::write(pipe.write_fd, "world", 5), 5);
+        ::close(pipe.write_fd);
+        pipe.write_fd = -1;
+    });
+
+    loop.start();
+    writer.join();
+
+    ASSERT_TRUE(received == "hello world");
+    ASSERT_TRUE(coro.done());
+
+    loop.deregister(pipe.read_fd);
+}
+
+co::coroutine<void> wait_readable(co::ev_loop& loop, int fd, bool& resumed)
+{
+    co_await loop.readable(fd);
+    resumed = true;
+    loop.stop();
+}
+
+void keep_busy(co::ev_loop& loop)
+{
+    loop.post([&loop]() { keep_busy(loop); });
+}
+
+SIMPLE_TEST(io_reactor_busy_loop_test)
+{
+    co::ev_loop loop;
+    nonblocking_pipe pipe;
+    bool resumed = false;
+
+    co::coroutine<void> coro { };
+    loop.post([&]() {
+        coro = wait_readable(loop, pipe.read_fd, resumed);
+        ASSERT_EQ(::write(pipe.write_fd, "x", 1), 1);
+        keep_busy(loop);
+    });
+
+    loop.start();
+
+    ASSERT_TRUE(resumed);
+    loop.deregister(pipe.read_fd);
+}
+
+co::coroutine<std::string> wait_outcome(co::ev_loop& loop, int fd)
+{
+    std::string outcome;
+    try {
+        co_await loop.readable(fd);
+        outcome = "ready";
+    } catch (const co::operation_cancelled&) {
+        outcome = "cancelled";
+    } catch (const con::error& error) {
+        outcome = error.what();
+    }
+    co_return outcome;
+}
+
+SIMPLE_TEST(io_reactor_deregister_test)
+{
+    co::ev_loop loop;
+    nonblocking_pipe pipe;
+
+    co::coroutine<std::string> coro { };
+    loop.post([&]() {
+        coro = wait_outcome(loop, pipe.read_fd);
+        loop.deregister(pipe.read_fd);
+        loop.post(co::priority::low, [&]() { loop.stop(); });
+    });
+
+    loop.start();
+
+    ASSERT_TRUE(coro.done());
+    ASSERT_EQ(coro.get(), "cancelled");
+}
+
+SIMPLE_TEST(io_reactor_second_reader_test)
+{
+    co::ev_loop loop;
+    nonblocking_pipe pipe;
+
+    co::coroutine<std::string> first { };
+    co::coroutine<std::string> second { };
+    loop.post([&]() {
+        first  = wait_outcome(loop, pipe.read_fd);
+        second = wait_outcome(loop, pipe.read_fd);
+        ASSERT_EQ(::write(pipe.write_fd, "x", 1), 1);
+        loop.post_after(1ms, [&]() { loop.stop(); });
+    });
+
+    loop.start();
+
+    // the second reader is refused, the first one keeps its place and is resumed
+    ASSERT_TRUE(second.done());
+    ASSERT_EQ(second.get(), "descriptor already has a waiting reader");
+    ASSERT_TRUE(first.done());
+    ASSERT_EQ(first.get(), "ready");
+
+    loop.deregister(pipe.read_fd);
+}
+
+SIMPLE_TEST(io_reactor_destroyed_waiter_test)
+{
+    co::ev_loop loop;
+    nonblocking_pipe pipe;
+    nonblocking_pipe other;
+    bool dropped_resumed = false;
+    bool resumed         = false;
+
+    co::coroutine<void> coro { };
+    loop.post([&]() {
+        {
+            co::coroutine<void> dropped = wait_readable(loop, pipe.read_fd, dropped_resumed);
+        }
+        // the edge finds nobody waiting and is remembered for the next await
+        ASSERT_EQ(::write(pipe.write_fd, "x", 1), 1);
+
+        {
+            co::coroutine<void> dropped = wait_readable(loop, other.read_fd, dropped_resumed);
+            loop.deregister(other.read_fd);
+        }
+
+        loop.post_after(1ms, [&]() { coro = wait_readable(loop, pipe.read_fd, resumed); });
+    });
+
+    loop.start();
+
+    ASSERT_FALSE(dropped_resumed);
+    ASSERT_TRUE(resumed);
+    ASSERT_TRUE(coro.done());
+    loop.deregister(pipe.read_fd);
+}
+
+co::coroutine<void> echo_once(co::ev_loop& loop, int fd, std::string& received)
+{
+    co_await loop.writable(fd);
+    ASSERT_EQ(::send(fd, "ping", 4, 0), 4);
+
+    char buffer[4];
+    ssize_t count;
+    while ((count = ::recv(fd, buffer, sizeof(buffer), 0)) < 0 && errno == EAGAIN) {
+        co_await loop.readable(fd);
+    }
+    received.assign(buffer, static_cast<size_t>(count));
+
+    loop.stop();
+}
+
+SIMPLE_TEST(io_reactor_socketpair_test)
+{
+    co::ev_loop loop;
+    std::string received;
+
+    int fds[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+
+    std::thread peer([&]() {
+        char buffer[4];
+        size_t total = 0;
+        while (total < sizeof(buffer)) {
+            ssize_t count = ::recv(fds[1], buffer + total, sizeof(buffer) - total, 0);
+            if (count > 0) {
+                total += static_cast<size_t>(count);
+            } else {
+                std::this_thread::sleep_for(1ms);
+            }
+        }
+        ASSERT_EQ(::send(fds[1], "pong", 4, 0), 4);
+    });
+
+    co::coroutine<void> coro { };
+    loop.post([&]() { coro = echo_once(loop, fds[0], received); });
+
+    loop.start();
+    peer.join();
+
+    ASSERT_TRUE(received == "pong");
+
+    loop.deregister(fds[0]);
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+#endif
+
+TEST_MAIN()
@@ -0,0 +1,142 @@
+#include "unittest.hpp"
+
+#include "event_loop.hpp"
+#include "loop_statistics.hpp"
+
+#include <chrono>
+#include <thread>
+
+SIMPLE_TEST(duration_histogram_bucket_test)
+{
+    using namespace std::chrono_literals;
+
+    ASSERT_EQ(co::duration_histogram::bucket_of(0ns), 0);
+    ASSERT_EQ(co::duration_histogram::bucket_of(1ns), 1);
+    ASSERT_EQ(co::duration_histogram::bucket_of(3ns), 2);
+    ASSERT_EQ(co::duration_histogram::bucket_of(4ns), 3);
+    ASSERT_EQ(co::duration_histogram::bucket_of(std::chrono::hours(1000)), co::duration_histogram::buckets - 1);
+}
+
+SIMPLE_TEST(duration_histogram_percentile_test)
+{
+    using namespace std::chrono_literals;
+
+    co::duration_histogram histogram;
+
+    ASSERT_TRUE(histogram.percentile(0.5) == 0ns);
+
+    histogram.counts[co::duration_histogram::bucket_of(100ns)] = 99;
+    histogram.counts[co::duration_histogram::bucket_of(10us)]  = 1;
+
+    ASSERT_EQ(histogram.count(), 100);
+    ASSERT_TRUE(histogram.percentile(0.5) == 128ns);
+    ASSERT_TRUE(histogram.percentile(0.99) == 128ns);
+    ASSERT_TRUE(histogram.percentile(1.0) == 16384ns);
+}
+
+SIMPLE_TEST(loop_statistics_counts_test)
+{
+    co::ev_loop loop;
+
+    for (int i = 0; i < 10; ++i) {
+        loop.post([]() { });
+    }
+    loop.post(co::priority::high, [&]() { loop.stop(); });
+
+    co::loop_statistics before = loop.statistics();
+
+    ASSERT_EQ(before.tasks_posted, 11);
+    ASSERT_EQ(before.tasks_executed, 0);
+    ASSERT_EQ(before.queue_depth, 11);
+
+    loop.start();
+
+    co::loop_statistics after = loop.statistics();
+
+    ASSERT_EQ(after.tasks_posted, 11);
+    ASSERT_EQ(after.tasks_executed, 1);
+    ASSERT_EQ(after.queue_depth, 10);
+}
+
+SIMPLE_TEST(loop_statistics_timers_test)
+{
+    using namespace std::chrono_literals;
+
+    co::ev_loop loop;
+
+    for (int i = 0; i < 3; ++i) {
+        loop.post_after(0ms, []() { std::this_thread::sleep_for(1ms); });
+    }
+    loop.post_after(1ms, [&]() { loop.stop(); });
+
+    loop.start();
+
+    co::loop_statistics stats = loop.statistics();
+
+    ASSERT_EQ(stats.tasks_posted, 0);
+    ASSERT_EQ(stats.timers_executed, 4);
+    ASSERT_EQ(stats.tasks_executed, 0);
+    ASSERT_EQ(stats.queue_depth, 0);
+
+#if defined(COOPERATIVE_ENABLE_STATISTICS)
+    ASSERT_TRUE(stats.busy_time >= 3ms);
+    ASSERT_EQ(stats.run_time.count(), 4);
+    ASSERT_EQ(stats.queue_wait.count(), 0);
+#endif
+}
+
+SIMPLE_TEST(loop_statistics_posted_covers_executed_test)
+{
+    using namespace std::chrono_literals;
+
+    co::ev_loop loop;
+
+    for (int i = 0; i < 3; ++i) {
+        loop.post([&loop]() { loop.post_after(0ms, []() { }); });
+    }
+    loop.post_after(1ms, [&loop]() { loop.post([&loop]() { loop.stop(); }); });
+
+    loop.start();
+
+    co::loop_statistics stats = loop.statistics();
+
+    ASSERT_EQ(stats.tasks_posted, 4);
+    ASSERT_EQ(stats.tasks_executed, 4);
+    ASSERT_EQ(stats.timers_executed, 4);
+    ASSERT_TRUE(stats.tasks_executed <= stats.tasks_posted);
+    ASSERT_EQ(stats.tasks_posted - stats.tasks_executed, stats.queue_depth);
+}
+
+#if defined(COOPERATIVE_ENABLE_STATISTICS)
+
+SIMPLE_TEST(loop_statistics_timing_test)
+{
+    using namespace std::chrono_literals;
+
+    co::ev_loop loop;
+
+    std::thread thread([&loop]() { loop.start(); });
+
+    std::this_thread::sleep_for(10ms);
+
+    for (int i = 0; i < 5; ++i) {
+        loop.post([]() { std::this_thread::sleep_for(1ms); });
+    }
+    loop.post([&]() { loop.stop(); });
+
+    thread.join();
+
+    co::loop_statistics stats = loop.statistics();
+
+    ASSERT_EQ(stats.tasks_executed, 6);
+    ASSERT_TRUE(stats.peak_queue_depth >= 1);
+    ASSERT_TRUE(stats.busy_time >= 5ms);
+    ASSERT_TRUE(stats.idle_time >= 5ms);
+    ASSERT_EQ(stats.queue_wait.count(), 6);
+    ASSERT_EQ(stats.run_time.count(), 6);
+    ASSERT_TRUE(stats.run_time.percentile(0.5) >= 1ms);
+}
+
+#endif
+
+TEST_MAIN()
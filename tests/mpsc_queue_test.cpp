@@ -0,0 +1,115 @@
+#include "unittest.hpp"
+
+#include "mpsc_queue.hpp"
+
+#include <thread>
+#include <vector>
+
+struct test_node : co::mpsc_node {
+    int producer { 0 };
+    int value { 0 };
+};
+
+SIMPLE_TEST(mpsc_queue_empty_test)
+{
+    co::mpsc_queue<test_node> queue;
+
+    ASSERT_TRUE(queue.empty());
+    ASSERT_TRUE(queue.pop() == nullptr);
+}
+
+SIMPLE_TEST(mpsc_queue_fifo_test)
+{
+    co::mpsc_queue<test_node> queue;
+    std::vector<test_node> nodes(3);
+
+    for (int i = 0; i < 3; ++i) {
+        nodes[i].value = i;
+        queue.push(&nodes[i]);
+    }
+
+    ASSERT_FALSE(queue.empty());
+
+    for (int i = 0; i < 3; ++i) {
+        test_node* node = queue.pop();
+        ASSERT_TRUE(node != nullptr);
+        ASSERT_EQ(node->value, i);
+    }
+
+    ASSERT_TRUE(queue.empty());
+    ASSERT_TRUE(queue.pop() == nullptr);
+
+    queue.push(&nodes[0]);
+
+    ASSERT_FALSE(queue.empty());
+    ASSERT_EQ(queue.pop(), &nodes[0]);
+    ASSERT_TRUE(queue.empty());
+}
+
+SIMPLE_TEST(mpsc_queue_push_chain_test)
+{
+    co::mpsc_queue<test_node> queue;
+    std::vector<test_node> nodes(4);
+
+    nodes[0].value = 0;
+    queue.push(&nodes[0]);
+
+    for (int i = 1; i < 4; ++i) {
+        nodes[i].value = i;
+        if (i > 1) {
+            nodes[i - 1].next.store(&nodes[i], std::memory_order_relaxed);
+        }
+    }
+
+    queue.push_chain(&nodes[1], &nodes[3]);
+
+    for (int i = 0; i < 4; ++i) {
+        test_node* node = queue.pop();
+        ASSERT_TRUE(node != nullptr);
+        ASSERT_EQ(node->value, i);
+    }
+
+    ASSERT_TRUE(queue.empty());
+}
+
+SIMPLE_TEST(mpsc_queue_multiple_producers_test)
+{
+    constexpr int producers = 4;
+    constexpr int items     = 10000;
+
+    co::mpsc_queue<test_node> queue;
+    std::vector<test_node> nodes(producers * items);
+    std::vector<std::thread> threads;
+
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&queue, &nodes, p]() {
+            for (int i = 0; i < items; ++i) {
+                test_node& node = nodes[p * items + i];
+                node.producer   = p;
+                node.value      = i;
+                queue.push(&node);
+            }
+        });
+    }
+
+    std::vector<int> expected(producers, 0);
+    int received = 0;
+
+    while (received < producers * items) {
+        test_node* node = queue.pop();
+        if (node == nullptr) {
+            continue;
+        }
+        ASSERT_EQ(node->value, expected[node->producer]);
+        ++expected[node->producer];
+        ++received;
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_TRUE(queue.empty());
+}
+
+TEST_MAIN()
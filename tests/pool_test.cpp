@@ -0,0 +1,96 @@
+#include "unittest.hpp"
+
+#include "pool.hpp"
+
+#include <thread>
+
+struct test_tag { };
+
+using test_pool = co::size_class_pool<test_tag, 16, 64, 2>;
+
+SIMPLE_TEST(pool_reuse_test)
+{
+    co::pool_stats before = test_pool::stats();
+
+    void* first = test_pool::allocate(20);
+    test_pool::deallocate(first, 20);
+
+    void* second = test_pool::allocate(32);
+
+    ASSERT_EQ(first, second);
+
+    test_pool::deallocate(second, 32);
+
+    co::pool_stats after = test_pool::stats();
+
+    ASSERT_EQ(after.heap_allocations, before.heap_allocations + 1);
+    ASSERT_EQ(after.pool_allocations, before.pool_allocations + 1);
+}
+
+SIMPLE_TEST(pool_size_classes_test)
+{
+    void* small = test_pool::allocate(16);
+    test_pool::deallocate(small, 16);
+
+    void* big = test_pool::allocate(17);
+
+    ASSERT_NE(small, big);
+
+    test_pool::deallocate(big, 17);
+}
+
+SIMPLE_TEST(pool_oversized_test)
+{
+    co::pool_stats before = test_pool::stats();
+
+    void* block = test_pool::allocate(65);
+    test_pool::deallocate(block, 65);
+    block = test_pool::allocate(65);
+    test_pool::deallocate(block, 65);
+
+    co::pool_stats after = test_pool::stats();
+
+    ASSERT_EQ(after.heap_allocations, before.heap_allocations + 2);
+    ASSERT_EQ(after.pool_allocations, before.pool_allocations);
+}
+
+SIMPLE_TEST(pool_cache_limit_test)
+{
+    void* blocks[3] = { test_pool::allocate(48), test_pool::allocate(48), test_pool::allocate(48) };
+
+    for (void* block : blocks) {
+        test_pool::deallocate(block, 48);
+    }
+
+    co::pool_stats before = test_pool::stats();
+
+    for (void*& block : blocks) {
+        block = test_pool::allocate(48);
+    }
+
+    co::pool_stats after = test_pool::stats();
+
+    ASSERT_EQ(after.pool_allocations, before.pool_allocations + 2);
+    ASSERT_EQ(after.heap_allocations, before.heap_allocations + 1);
+
+    for (void* block : blocks) {
+        test_pool::deallocate(block, 48);
+    }
+}
+
+SIMPLE_TEST(pool_cross_thread_test)
+{
+    void* block = test_pool::allocate(16);
+
+    std::thread thread([block]() {
+        test_pool::deallocate(block, 16);
+
+        ASSERT_EQ(test_pool::allocate(16), block);
+
+        test_pool::deallocate(block, 16);
+    });
+
+    thread.join();
+}
+
+TEST_MAIN()
@@ -0,0 +1,227 @@
+#include "unittest.hpp"
+
+#include "coroutine.hpp"
+#include "future.hpp"
+#include "shared_future.hpp"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct counted {
+    static inline int copies = 0;
+
+    explicit counted(int value)
+        : value(value)
+    {
+    }
+
+    counted(const counted& other)
+        : value(other.value)
+    {
+        ++copies;
+    }
+
+    counted(counted&&) noexcept            = default;
+    counted& operator=(counted&&) noexcept = default;
+    counted& operator=(const counted&)     = delete;
+
+    int value;
+};
+
+}
+
+SIMPLE_TEST(then_fan_out_test)
+{
+    auto [fut, prom] = co::create_future_promise<counted>();
+    co::shared_future<counted> shared(std::move(fut));
+    co::shared_future<counted> copy = shared;
+
+    std::vector<int> order;
+    std::vector<const counted*> seen;
+
+    std::vector<co::future<int>> outputs;
+    for (int index = 0; index < 3; ++index) {
+        const co::shared_future<counted>& source = index % 2 == 0 ? shared : copy;
+        outputs.push_back(source.then([&order, &seen, index](const con::result<counted>& result) {
+            order.push_back(index);
+            seen.push_back(&result.value());
+            return result.value().value + index;
+        }));
+    }
+
+    ASSERT_FALSE(shared.ready());
+    ASSERT_TRUE(order.empty());
+
+    counted::copies = 0;
+    prom.set_value(counted(10));
+
+    ASSERT_TRUE(copy.ready());
+    ASSERT_EQ(order.size(), 3);
+    ASSERT_EQ(order[0], 0);
+    ASSERT_EQ(order[1], 1);
+    ASSERT_EQ(order[2], 2);
+    ASSERT_EQ(seen[0], &shared.get());
+    ASSERT_EQ(seen[2], &copy.get());
+    ASSERT_EQ(counted::copies, 0);
+
+    ASSERT_EQ(outputs[0].get(), 10);
+    ASSERT_EQ(outputs[1].get(), 11);
+    ASSERT_EQ(outputs[2].get(), 12);
+
+    // continuation added after the result runs right away
+    co::future<int> late = shared.then([](const con::result<counted>& result) { return result.value().value * 2; });
+    ASSERT_EQ(late.get(), 20);
+    ASSERT_EQ(counted::copies, 0);
+}
+
+co::coroutine<int> await_shared(co::shared_future<std::string> shared, const std::string*& seen)
+{
+    const std::string& value = co_await shared;
+    seen                     = &value;
+    co_return static_cast<int>(value.size());
+}
+
+SIMPLE_TEST(await_shared_test)
+{
+    auto [fut, prom] = co::create_future_promise<std::string>();
+    co::shared_future<std::string> shared(std::move(fut));
+
+    const std::string* first_seen  = nullptr;
+    const std::string* second_seen = nullptr;
+
+    co::coroutine<int> first  = await_shared(shared, first_seen);
+    co::coroutine<int> second = await_shared(shared, second_seen);
+
+    ASSERT_FALSE(first.done());
+    ASSERT_FALSE(second.done());
+
+    prom.set_value("shared");
+
+    ASSERT_EQ(first.get(), 6);
+    ASSERT_EQ(second.get(), 6);
+    ASSERT_EQ(first_seen, &shared.get());
+    ASSERT_EQ(second_seen, &shared.get());
+
+    const std::string* ready_seen = nullptr;
+    co::coroutine<int> ready      = await_shared(shared, ready_seen);
+    ASSERT_TRUE(ready.done());
+    ASSERT_EQ(ready_seen, &shared.get());
+}
+
+co::coroutine<std::string> await_failure(co::shared_future<int> shared)
+{
+    try {
+        co_await shared;
+        co_return "value";
+    } catch (const con::error& error) {
+        co_return error.what();
+    }
+}
+
+SIMPLE_TEST(shared_exception_test)
+{
+    co::shared_future<int> shared;
+    {
+        auto [fut, prom] = co::create_future_promise<int>();
+        shared           = co::shared_future<int>(std::move(fut));
+
+        co::coroutine<std::string> waiter = await_failure(shared);
+        co::future<bool> failed = shared.then([](const con::result<int>& result) { return result.has_exception(); });
+
+        prom.set_exception(std::make_exception_ptr(con::error("failed")));
+
+        ASSERT_EQ(waiter.get(), "failed");
+        ASSERT_TRUE(failed.get());
+    }
+
+    ASSERT_TRUE(shared.has_exception());
+    try {
+        shared.get();
+        ASSERT_TRUE(false);
+    } catch (const con::error&) {
+    }
+
+    co::shared_future<int> empty;
+    ASSERT_FALSE(empty.valid());
+    try {
+        empty.ready();
+        ASSERT_TRUE(false);
+    } catch (const con::error&) {
+    }
+}
+
+SIMPLE_TEST(shared_future_outlived_test)
+{
+    auto [fut, prom] = co::create_future_promise<int>();
+
+    co::future<int> output;
+    {
+        co::shared_future<int> shared(std::move(fut));
+        output = shared.then([](const con::result<int>& result) { return result.value() + 1; });
+    }
+
+    // the state waits for the result although no shared_future is left
+    prom.set_value(1);
+    ASSERT_EQ(output.get(), 2);
+}
+
+SIMPLE_TEST(shared_future_promise_dropped_test)
+{
+    co::shared_future<int> shared;
+    co::future<bool> failed;
+    co::coroutine<std::string> waiter;
+    {
+        auto [fut, prom] = co::create_future_promise<int>();
+        shared           = co::shared_future<int>(std::move(fut));
+
+        failed = shared.then([](const con::result<int>& result) { return result.has_exception(); });
+        waiter = await_failure(shared);
+        ASSERT_FALSE(waiter.done());
+    }
+
+    ASSERT_TRUE(shared.has_exception());
+    ASSERT_TRUE(failed.get());
+    ASSERT_TRUE(waiter.done());
+    ASSERT_EQ(waiter.get(), "broken promise");
+
+    // nothing holds the state but the dropped input, it is freed with it
+    co::future<int> output;
+    {
+        auto [fut, prom] = co::create_future_promise<int>();
+        co::shared_future<int> unused(std::move(fut));
+        output = unused.then([](const con::result<int>& result) { return result.value(); });
+    }
+    ASSERT_TRUE(output.has_exception());
+}
+
+SIMPLE_TEST(shared_future_threads_test)
+{
+    for (int round = 0; round < 100; ++round) {
+        auto [fut, prom] = co::create_future_promise<int>();
+        co::shared_future<int> shared(std::move(fut));
+
+        std::vector<co::future<int>> outputs(4);
+        std::vector<std::thread> consumers;
+        for (size_t index = 0; index < outputs.size(); ++index) {
+            consumers.emplace_back([&outputs, shared, index]() {
+                outputs[index] = shared.then([](const con::result<int>& result) { return result.value(); });
+            });
+        }
+
+        std::thread producer([prom = std::move(prom), round]() mutable { prom.set_value(round); });
+
+        for (std::thread& consumer : consumers) {
+            consumer.join();
+        }
+        producer.join();
+
+        for (co::future<int>& output : outputs) {
+            ASSERT_EQ(output.get(), round);
+        }
+    }
+}
+
+TEST_MAIN()
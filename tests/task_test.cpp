@@ -0,0 +1,170 @@
+#include "coroutine.hpp"
+#include "event_loop.hpp"
+#include "task.hpp"
+#include "unittest.hpp"
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+inline int calls = 0;
+
+co::task<int> return_1()
+{
+    calls += 1;
+    co_return 1;
+}
+
+co::task<int> return_2()
+{
+    calls += 1;
+    int a = co_await return_1();
+    co_return a + 1;
+}
+
+co::task<void> throw_exception()
+{
+    calls += 1;
+    throw std::runtime_error("throw_exception");
+    co_return;
+}
+
+co::coroutine<int> await_task(co::task<int> work)
+{
+    int result = co_await std::move(work);
+    co_return result;
+}
+
+co::coroutine<int> await_throwing_task()
+{
+    try {
+        co_await throw_exception();
+    } catch (const std::runtime_error& ex) {
+        co_return std::string(ex.what()) == "throw_exception" ? 1 : 0;
+    }
+
+    co_return 0;
+}
+
+co::task<int> depth(int levels)
+{
+    if (levels == 0) {
+        co_return 0;
+    }
+
+    int below = co_await depth(levels - 1);
+    co_return below + 1;
+}
+
+SIMPLE_TEST(task_lazy_start_test)
+{
+    calls = 0;
+
+    co::task<int> work = return_2();
+
+    ASSERT_EQ(calls, 0);
+    ASSERT_FALSE(work.done());
+
+    co::coroutine<int> coro = await_task(std::move(work));
+
+    ASSERT_EQ(calls, 2);
+    ASSERT_TRUE(coro.done());
+    ASSERT_EQ(coro.get(), 2);
+}
+
+SIMPLE_TEST(task_never_started_test)
+{
+    calls = 0;
+
+    {
+        co::task<int> work = return_1();
+    }
+
+    ASSERT_EQ(calls, 0);
+}
+
+SIMPLE_TEST(task_exception_test)
+{
+    calls = 0;
+
+    co::coroutine<int> coro = await_throwing_task();
+
+    ASSERT_EQ(calls, 1);
+    ASSERT_TRUE(coro.done());
+    ASSERT_EQ(coro.get(), 1);
+}
+
+SIMPLE_TEST(task_deep_chain_test)
+{
+    co::coroutine<int> coro = await_task(depth(10000));
+
+    ASSERT_TRUE(coro.done());
+    ASSERT_EQ(coro.get(), 10000);
+}
+
+co::task<void> sleep_and_stop(co::ev_loop& loop)
+{
+    using namespace std::chrono_literals;
+
+    calls += 1;
+    co_await loop.sleep_for(1ms);
+    calls += co_await return_1();
+    loop.stop();
+}
+
+SIMPLE_TEST(task_spawn_test)
+{
+    co::ev_loop loop;
+
+    calls = 0;
+
+    loop.spawn(sleep_and_stop(loop));
+
+    ASSERT_EQ(calls, 0);
+
+    loop.start();
+
+    ASSERT_EQ(calls, 3);
+}
+
+SIMPLE_TEST(task_spawn_other_thread_test)
+{
+    co::ev_loop loop;
+
+    calls = 0;
+
+    std::thread producer([&]() { loop.spawn(sleep_and_stop(loop)); });
+
+    loop.start();
+    producer.join();
+
+    ASSERT_EQ(calls, 3);
+}
+
+struct destruction_counter {
+    ~destruction_counter()
+    {
+        calls += 1;
+    }
+};
+
+co::task<void> hold_counter(destruction_counter)
+{
+    co_return;
+}
+
+SIMPLE_TEST(task_spawn_dropped_test)
+{
+    calls = 0;
+
+    {
+        co::ev_loop loop;
+        loop.spawn(hold_counter(destruction_counter { }));
+        calls = 0;
+    }
+
+    ASSERT_EQ(calls, 1);
+}
+
+TEST_MAIN()
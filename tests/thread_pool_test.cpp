@@ -0,0 +1,111 @@
+#include "result.hpp"
+#include "unittest.hpp"
+
+#include "coroutine.hpp"
+#include "event_loop.hpp"
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <thread>
+
+static void wait_for(const std::atomic<int>& counter, int value)
+{
+    while (counter.load() != value) {
+        std::this_thread::yield();
+    }
+}
+
+SIMPLE_TEST(thread_pool_post_test)
+{
+    co::thread_pool pool(4);
+
+    std::atomic<int> executed { 0 };
+
+    for (int i = 0; i < 1000; ++i) {
+        pool.post([&]() { executed++; });
+    }
+
+    wait_for(executed, 1000);
+}
+
+static void tree(co::thread_pool& pool, std::atomic<int>& leaves, int depth)
+{
+    if (depth == 0) {
+        leaves++;
+        return;
+    }
+
+    pool.post([&pool, &leaves, depth]() { tree(pool, leaves, depth - 1); });
+    pool.post([&pool, &leaves, depth]() { tree(pool, leaves, depth - 1); });
+}
+
+SIMPLE_TEST(thread_pool_fan_out_test)
+{
+    co::thread_pool pool(4);
+
+    std::atomic<int> leaves { 0 };
+
+    pool.post([&]() { tree(pool, leaves, 12); });
+
+    wait_for(leaves, 1 << 12);
+}
+
+co::coroutine<int> resume_on_pool(co::thread_pool& pool, std::thread::id caller, std::atomic<int>& finished)
+{
+    co_await pool.schedule();
+    ASSERT_TRUE(std::this_thread::get_id() != caller);
+    finished++;
+    co_return 42;
+}
+
+SIMPLE_TEST(thread_pool_schedule_test)
+{
+    std::atomic<int> finished { 0 };
+    co::coroutine<int> coro { };
+
+    {
+        co::thread_pool pool(2);
+        coro = resume_on_pool(pool, std::this_thread::get_id(), finished);
+        wait_for(finished, 1);
+    }
+
+    ASSERT_TRUE(coro.done());
+    ASSERT_EQ(coro.get(), 42);
+}
+
+SIMPLE_TEST(thread_pool_invoke_from_ev_loop_test)
+{
+    co::ev_loop loop;
+    co::thread_pool pool(2);
+
+    int answer = 0;
+
+    loop.post([&]() {
+        loop.invoke(pool, []() { return 42; }).then([&](con::result<int> result) {
+            answer = result.value();
+            loop.stop();
+            return con::unit { };
+        });
+    });
+
+    loop.start();
+
+    ASSERT_EQ(answer, 42);
+}
+
+SIMPLE_TEST(thread_pool_invoke_test)
+{
+    co::thread_pool pool(2);
+
+    co::future<int> answer = pool.invoke([]() { return 42; });
+    co::future<int> failed = pool.invoke([]() -> int { throw con::error("failed"); });
+
+    while (!answer.ready() || !failed.ready()) {
+        std::this_thread::yield();
+    }
+
+    ASSERT_EQ(answer.get(), 42);
+    ASSERT_TRUE(failed.has_exception());
+}
+
+TEST_MAIN()
@@ -0,0 +1,190 @@
+#include "unittest.hpp"
+
+#include "coroutine.hpp"
+#include "event_loop.hpp"
+#include "future.hpp"
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+SIMPLE_TEST(with_timeout_in_time_test)
+{
+    using namespace std::chrono_literals;
+
+    co::ev_loop loop;
+
+    auto [fut, prom] = co::create_future_promise<int>();
+    co::future<int> limited;
+    size_t timers_while_waiting = 0;
+    size_t timers_after         = 0;
+
+    loop.post([&]() {
+        limited              = std::move(fut).with_timeout(loop, 10s);
+        timers_while_waiting = loop.pending_timers();
+        prom.set_value(5);
+    });
+    loop.post(co::priority::low, [&]() {
+        timers_after = loop.pending_timers();
+        loop.stop();
+    });
+
+    loop.start();
+
+    ASSERT_EQ(timers_while_waiting, 1);
+    ASSERT_EQ(timers_after, 0);
+    ASSERT_EQ(limited.get(), 5);
+}
+
+SIMPLE_TEST(with_timeout_expired_test)
+{
+    using namespace std::chrono_literals;
+
+    co::ev_loop loop;
+
+    auto [fut, prom] = co::create_future_promise<int>();
+    co::future<std::string> outcome;
+
+    loop.post([&]() {
+        outcome = std::move(fut).with_timeout(loop, 1ms).then([&](con::result<int> result) {
+            // a late result is dropped, the state goes away with it
+            prom.set_value(1);
+            loop.post(co::priority::low, [&]() { loop.stop(); });
+
+            try {
+                return std::to_string(result.value());
+            } catch (const co::timeout_error&) {
+                return std::string("timeout");
+            }
+        });
+    });
+
+    loop.start();
+
+    ASSERT_EQ(outcome.get(), "timeout");
+    ASSERT_EQ(loop.pending_timers(), 0);
+}
+
+co::coroutine<std::string> await_with_deadline(co::ev_loop& loop, co::future<int> fut)
+{
+    using namespace std::chrono_literals;
+
+    std::string outcome;
+    try {
+        int value = co_await std::move(fut).with_deadline(loop, co::timer_clock::now() + 1s);
+        outcome   = std::to_string(value);
+    } catch (const co::timeout_error&) {
+        outcome = "timeout";
+    }
+
+    loop.stop();
+    co_return outcome;
+}
+
+SIMPLE_TEST(await_with_deadline_test)
+{
+    using namespace std::chrono_literals;
+
+    co::ev_loop loop;
+
+    auto [fut, prom] = co::create_future_promise<int>();
+    co::coroutine<std::string> waiter;
+
+    loop.post([&]() { waiter = await_with_deadline(loop, std::move(fut)); });
+
+    std::thread producer([prom = std::move(prom)]() mutable {
+        std::this_thread::sleep_for(2ms);
+        prom.set_value(3);
+    });
+
+    loop.start();
+    producer.join();
+
+    ASSERT_EQ(waiter.get(), "3");
+    ASSERT_EQ(loop.pending_timers(), 0);
+}
+
+SIMPLE_TEST(with_timeout_ready_future_test)
+{
+    using namespace std::chrono_literals;
+
+    co::ev_loop loop;
+
+    auto [fut, prom] = co::create_future_promise<int>();
+    prom.set_value(9);
+
+    co::future<int> limited;
+    loop.post([&]() { limited = std::move(fut).with_timeout(loop, 0ms); });
+    loop.post(co::priority::low, [&]() { loop.stop(); });
+
+    loop.start();
+
+    ASSERT_EQ(limited.get(), 9);
+    ASSERT_EQ(loop.pending_timers(), 0);
+}
+
+SIMPLE_TEST(with_timeout_loop_destroyed_test)
+{
+    using namespace std::chrono_literals;
+
+    auto [pending, pending_prom] = co::create_future_promise<int>();
+    auto [late, late_prom]       = co::create_future_promise<int>();
+
+    co::future<int> in_time;
+    co::future<int> expired;
+    {
+        co::ev_loop loop;
+
+        in_time = std::move(pending).with_timeout(loop, 10s);
+        expired = std::move(late).with_timeout(loop, 0ms);
+        loop.post(co::priority::low, [&]() { loop.stop(); });
+
+        loop.start();
+    }
+
+    ASSERT_FALSE(in_time.ready());
+    ASSERT_TRUE(expired.has_exception());
+
+    // nothing is left to post to, the result resolves the output right away
+    pending_prom.set_value(3);
+    ASSERT_EQ(in_time.get(), 3);
+
+    // dropped, the state is freed on this thread
+    late_prom.set_value(4);
+}
+
+SIMPLE_TEST(with_timeout_promise_dropped_test)
+{
+    using namespace std::chrono_literals;
+
+    co::ev_loop loop;
+
+    co::future<int> abandoned;
+    co::future<int> expired;
+    {
+        auto [fut, prom]           = co::create_future_promise<int>();
+        auto [late_fut, late_prom] = co::create_future_promise<int>();
+
+        abandoned = std::move(fut).with_timeout(loop, 10s);
+        expired   = std::move(late_fut).with_timeout(loop, 0ms);
+
+        loop.post(co::priority::low, [&loop, late_prom = std::move(late_prom)]() mutable {
+            // the timeout fired already, dropping the promise frees the state
+            co::promise<int> dropped = std::move(late_prom);
+            loop.post(co::priority::low, [&loop]() { loop.stop(); });
+        });
+    }
+
+    loop.start();
+
+    ASSERT_TRUE(abandoned.has_exception());
+    ASSERT_TRUE(expired.has_exception());
+    try {
+        expired.get();
+        ASSERT_TRUE(false);
+    } catch (const co::timeout_error&) {
+    }
+    ASSERT_EQ(loop.pending_timers(), 0);
+}
+
+TEST_MAIN()
@@ -0,0 +1,93 @@
+#include "unittest.hpp"
+
+#include "timer_queue.hpp"
+
+#include <chrono>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+SIMPLE_TEST(timer_queue_order_test)
+{
+    co::timer_queue timers;
+    std::vector<int> fired;
+
+    co::timer_clock::time_point now = co::timer_clock::now();
+
+    timers.add(now + 3ms, [&]() { fired.push_back(3); });
+    timers.add(now + 1ms, [&]() { fired.push_back(1); });
+    timers.add(now + 2ms, [&]() { fired.push_back(2); });
+    timers.add(now + 1ms, [&]() { fired.push_back(4); });
+
+    ASSERT_EQ(timers.size(), 4);
+    ASSERT_TRUE(timers.next_deadline() == now + 1ms);
+    ASSERT_FALSE(timers.pop_expired(now));
+
+    while (co::move_only_function<void> task = timers.pop_expired(now + 3ms)) {
+        task();
+    }
+
+    ASSERT_TRUE(fired == std::vector<int>({ 1, 4, 2, 3 }));
+    ASSERT_TRUE(timers.empty());
+    ASSERT_FALSE(timers.next_deadline().has_value());
+}
+
+SIMPLE_TEST(timer_queue_cancel_test)
+{
+    co::timer_queue timers;
+    std::vector<int> fired;
+
+    co::timer_clock::time_point now = co::timer_clock::now();
+
+    co::timer_id first  = timers.add(now + 1ms, [&]() { fired.push_back(1); });
+    co::timer_id second = timers.add(now + 2ms, [&]() { fired.push_back(2); });
+
+    ASSERT_TRUE(timers.cancel(first));
+    ASSERT_FALSE(timers.cancel(first));
+    ASSERT_EQ(timers.size(), 1);
+    ASSERT_TRUE(timers.next_deadline() == now + 2ms);
+
+    co::timer_id third = timers.add(now + 3ms, [&]() { fired.push_back(3); });
+
+    ASSERT_TRUE(third.slot == first.slot);
+    ASSERT_FALSE(timers.cancel(first));
+
+    while (co::move_only_function<void> task = timers.pop_expired(now + 3ms)) {
+        task();
+    }
+
+    ASSERT_TRUE(fired == std::vector<int>({ 2, 3 }));
+    ASSERT_FALSE(timers.cancel(second));
+}
+
+SIMPLE_TEST(timer_queue_compaction_test)
+{
+    co::timer_queue timers;
+    std::vector<co::timer_id> ids;
+    int fired = 0;
+
+    co::timer_clock::time_point now = co::timer_clock::now();
+
+    for (int i = 0; i < 1000; ++i) {
+        ids.push_back(timers.add(now + std::chrono::microseconds(1000 - i), [&fired]() { fired++; }));
+    }
+
+    for (int i = 0; i < 1000; ++i) {
+        if (i % 10 != 0) {
+            ASSERT_TRUE(timers.cancel(ids[i]));
+        }
+    }
+
+    ASSERT_EQ(timers.size(), 100);
+
+    co::timer_clock::time_point previous = now;
+    while (std::optional<co::timer_clock::time_point> deadline = timers.next_deadline()) {
+        ASSERT_TRUE(*deadline >= previous);
+        previous = *deadline;
+        timers.pop_expired(*deadline)();
+    }
+
+    ASSERT_EQ(fired, 100);
+}
+
+TEST_MAIN()
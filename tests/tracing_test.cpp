@@ -0,0 +1,137 @@
+#include "unittest.hpp"
+
+#include "channel.hpp"
+#include "coroutine.hpp"
+#include "event_loop.hpp"
+#include "tracing.hpp"
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <thread>
+
+SIMPLE_TEST(tracing_json_shape_test)
+{
+    std::string trace = co::chrome_trace();
+
+    ASSERT_EQ(trace.rfind("{\"traceEvents\":[", 0), 0);
+    ASSERT_TRUE(trace.find("]}") != std::string::npos);
+    ASSERT_TRUE(trace.find(",]") == std::string::npos);
+}
+
+#if defined(COOPERATIVE_ENABLE_TRACING)
+
+SIMPLE_TEST(tracing_cross_loop_flow_test)
+{
+    co::ev_loop loop_1;
+    co::ev_loop loop_2;
+
+    std::thread thread_2([&loop_2]() { loop_2.start(); });
+
+    loop_1.post([&]() {
+        loop_1.invoke(loop_2, []() { return 1; }).then([&](con::result<int>) {
+            loop_1.stop();
+            return con::unit { };
+        });
+    });
+
+    loop_1.start();
+    loop_2.stop();
+    thread_2.join();
+
+    std::string trace = co::chrome_trace();
+
+    ASSERT_TRUE(trace.find("\"name\":\"ev_loop.task\",\"ph\":\"B\"") != std::string::npos);
+    ASSERT_TRUE(trace.find("\"name\":\"future.then\",\"ph\":\"E\"") != std::string::npos);
+    ASSERT_TRUE(trace.find("\"ph\":\"s\"") != std::string::npos);
+    ASSERT_TRUE(trace.find("\"ph\":\"f\"") != std::string::npos);
+    ASSERT_TRUE(trace.find("\"tid\":2") != std::string::npos);
+    ASSERT_TRUE(trace.find(",]") == std::string::npos);
+}
+
+unsigned long thread_of(const std::string& trace, const std::string& name)
+{
+    size_t event = trace.find("\"name\":\"" + name + "\"");
+    size_t tid   = trace.find("\"tid\":", event);
+    return std::stoul(trace.substr(tid + 6));
+}
+
+SIMPLE_TEST(tracing_reused_ring_test)
+{
+    // the second thread takes over the ring of the first one, which has exited
+    std::thread first([]() { co::detail::trace_slice slice("trace.first"); });
+    first.join();
+    std::thread second([]() { co::detail::trace_slice slice("trace.second"); });
+    second.join();
+
+    std::string trace = co::chrome_trace();
+
+    ASSERT_TRUE(trace.find("trace.first") != std::string::npos);
+    ASSERT_TRUE(trace.find("trace.second") != std::string::npos);
+    ASSERT_TRUE(thread_of(trace, "trace.first") != thread_of(trace, "trace.second"));
+}
+
+size_t count_of(const std::string& trace, const std::string& name)
+{
+    std::string begin = "\"name\":\"" + name + "\",\"ph\":\"B\"";
+
+    size_t count = 0;
+    for (size_t at = trace.find(begin); at != std::string::npos; at = trace.find(begin, at + 1)) {
+        ++count;
+    }
+    return count;
+}
+
+co::coroutine<void> sleep_then_receive(co::ev_loop& loop, co::channel<int>& channel, std::optional<int>& item)
+{
+    using namespace std::chrono_literals;
+
+    co_await loop.sleep_for(1ms);
+    item = co_await channel.receive();
+}
+
+SIMPLE_TEST(tracing_coroutine_resume_test)
+{
+    using namespace std::chrono_literals;
+
+    co::ev_loop loop;
+    co::channel<int> channel(1);
+    std::optional<int> item;
+    co::coroutine<void> coro { };
+
+    size_t before = count_of(co::chrome_trace(), "coroutine.resume");
+
+    loop.post([&]() { coro = sleep_then_receive(loop, channel, item); });
+    loop.post_after(5ms, [&]() {
+        channel.try_send(1);
+        loop.stop();
+    });
+
+    loop.start();
+
+    // one resume by the sleep timer, one by the channel
+    ASSERT_EQ(item, 1);
+    ASSERT_EQ(count_of(co::chrome_trace(), "coroutine.resume"), before + 2);
+}
+
+SIMPLE_TEST(tracing_ring_wraps_test)
+{
+    co::ev_loop loop;
+
+    size_t tasks = co::detail::trace_ring::capacity;
+    for (size_t i = 0; i < tasks; ++i) {
+        loop.post([]() { });
+    }
+    loop.post([&]() { loop.stop(); });
+
+    loop.start();
+
+    std::string trace = co::chrome_trace();
+
+    ASSERT_TRUE(trace.find("\"ph\":\"E\"") != std::string::npos);
+    ASSERT_TRUE(trace.find(",]") == std::string::npos);
+}
+
+#endif
+
+TEST_MAIN()
@@ -0,0 +1,89 @@
+#include "unittest.hpp"
+
+#include "work_stealing_deque.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+SIMPLE_TEST(work_stealing_deque_lifo_test)
+{
+    co::work_stealing_deque<int> deque(2);
+
+    for (int i = 0; i < 10; ++i) {
+        deque.push(i);
+    }
+
+    int value = 0;
+
+    for (int i = 9; i >= 0; --i) {
+        ASSERT_TRUE(deque.pop(value));
+        ASSERT_EQ(value, i);
+    }
+
+    ASSERT_FALSE(deque.pop(value));
+    ASSERT_TRUE(deque.empty());
+}
+
+SIMPLE_TEST(work_stealing_deque_steal_fifo_test)
+{
+    co::work_stealing_deque<int> deque;
+
+    for (int i = 0; i < 10; ++i) {
+        deque.push(i);
+    }
+
+    int value = 0;
+
+    ASSERT_TRUE(deque.steal(value));
+    ASSERT_EQ(value, 0);
+    ASSERT_TRUE(deque.pop(value));
+    ASSERT_EQ(value, 9);
+}
+
+SIMPLE_TEST(work_stealing_deque_concurrent_test)
+{
+    constexpr int items   = 100000;
+    constexpr int thieves = 3;
+
+    co::work_stealing_deque<int> deque(16);
+    std::vector<std::atomic<int>> seen(items);
+    std::atomic<int> taken { 0 };
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < thieves; ++t) {
+        threads.emplace_back([&]() {
+            int value = 0;
+            while (taken.load() < items) {
+                if (deque.steal(value)) {
+                    seen[value]++;
+                    taken++;
+                }
+            }
+        });
+    }
+
+    int value = 0;
+    for (int i = 0; i < items; ++i) {
+        deque.push(i);
+        if (i % 3 == 0 && deque.pop(value)) {
+            seen[value]++;
+            taken++;
+        }
+    }
+    while (deque.pop(value)) {
+        seen[value]++;
+        taken++;
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_EQ(taken.load(), items);
+    for (int i = 0; i < items; ++i) {
+        ASSERT_EQ(seen[i].load(), 1);
+    }
+}
+
+TEST_MAIN()